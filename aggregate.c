@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Aggregation of a list of networks into the minimal set of networks
+ * covering the same addresses. The networks are kept as address ranges
+ * which are radix sorted on their first address, merged in a single pass
+ * when they overlap or are adjacent, and printed by deaggregating each
+ * of the merged ranges.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "ipcalc.h"
+#include "ipv6.h"
+#include "range.h"
+
+static void aggregate_ipv4(unsigned *jsonchain, struct ipv4_range *r, size_t n)
+{
+	size_t i;
+
+	n = range_merge_ipv4(r, n);
+	for (i = 0; i < n; i++)
+		deaggregate_ipv4_range(jsonchain, r[i].start, r[i].end);
+}
+
+static void aggregate_ipv6(unsigned *jsonchain, struct ipv6_range *r, size_t n)
+{
+	size_t i;
+
+	n = range_merge_ipv6(r, n);
+	for (i = 0; i < n; i++)
+		deaggregate_ipv6_range(jsonchain, &r[i].start, &r[i].end);
+}
+
+/*!
+  \fn int aggregate(FILE *fp, unsigned flags)
+  \brief prints the minimal set of networks covering the networks read from fp
+
+  Every line of the input is expected to contain a network in the
+  ADDRESS[/PREFIX] format; IPv4 and IPv6 networks may be mixed, and the
+  IPv4 networks are printed first. Empty lines and lines starting with
+  '#' are ignored. Invalid lines are reported on standard error and
+  skipped.
+
+  \param fp the input stream.
+  \param flags the output flags.
+
+  \return 0 if all lines were processed, or 1 if any errors were found.
+*/
+int aggregate(FILE *fp, unsigned flags)
+{
+	struct range_list v4 = {NULL, 0, 0}, v6 = {NULL, 0, 0};
+	unsigned jsonchain;
+	int ret;
+
+	ret = range_read(fp, flags, &v4, &v6);
+
+	output_start(&jsonchain);
+	array_start(&jsonchain, "Aggregated networks", "AGGREGATEDNETWORK");
+
+	aggregate_ipv4(&jsonchain, v4.data, v4.count);
+	aggregate_ipv6(&jsonchain, v6.data, v6.count);
+
+	array_stop(&jsonchain);
+	output_stop(&jsonchain);
+
+	range_free(&v4);
+	range_free(&v6);
+
+	return ret;
+}
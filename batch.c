@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE		/* getline */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+
+#include "ipcalc.h"
+
+static void show_batch_error(const char *str, unsigned flags)
+{
+	char buf[256];
+	unsigned jsonchain;
+
+	if (!(flags & FLAG_JSON))
+		return;
+
+	output_start(&jsonchain);
+	json_printf(&jsonchain, "INPUT", "%s", json_escape(buf, sizeof(buf), str));
+	json_printf(&jsonchain, "ERROR", "%s", "invalid address");
+	output_stop(&jsonchain);
+}
+
+/* Whether the human readable records must be separated with an empty line */
+static unsigned separate_records(unsigned flags)
+{
+	return (flags & FLAG_SHOW_MODERN_INFO) && !(flags & (FLAG_JSON|FLAG_NO_DECORATE));
+}
+
+/* Processes a single line of input, printing to the current output
+ * stream. Returns 1 if a record was printed, 0 if the line was skipped
+ * and -1 if it contains an invalid address. */
+static int batch_line(char *line, unsigned flags, unsigned check_only, unsigned records)
+{
+	unsigned line_flags = flags;
+	ip_info_st info;
+	char *str, *prefixStr, *space, *slash;
+	uint64_t t;
+
+	str = trim(line);
+	if (str[0] == 0 || str[0] == '#')
+		return 0;
+
+	if ((line_flags & FLAG_IPV4) == 0 && strchr(str, ':') != NULL)
+		line_flags |= FLAG_IPV6;
+
+	/* validation does not need any of the information */
+	if (check_only)
+		line_flags &= ~(FLAG_SHOW_MODERN_INFO|FLAG_SHOW_ALL_INFO|ENV_INFO_FLAGS);
+
+	/* allow the ADDRESS NETMASK form as in the command line */
+	prefixStr = NULL;
+	space = strpbrk(str, " \t");
+	if (space) {
+		*space = 0;
+		prefixStr = trim(space + 1);
+	}
+
+	slash = strchr(str, '/');
+	if (get_info(str, prefixStr, &info, &line_flags) < 0) {
+		if (slash)
+			*slash = '/';
+		if (space)
+			*space = ' ';
+		show_batch_error(str, line_flags);
+		return -1;
+	}
+
+	if (check_only)
+		return 0;
+
+	t = stats_start();
+	if (records > 0 && separate_records(line_flags))
+		output_puts("\n");
+
+	show_info(&info, NULL, line_flags);
+	stats_lap(STATS_OUTPUT, &t);
+	return 1;
+}
+
+/* Number of lines given to a worker at once */
+#define CHUNK_LINES 256
+
+struct batch_chunk {
+	/* the getline() buffers, kept across refills of the chunk */
+	char *lines[CHUNK_LINES];
+	size_t line_size[CHUNK_LINES];
+	unsigned nlines;
+
+	/* the output of the chunk, valid once done is set; the memory of
+	 * the buffer is kept across refills as well */
+	struct output_buf out;
+	unsigned records;
+	int ret;
+	unsigned done;
+};
+
+/* The chunks form a ring used as the reorder buffer: the reader fills
+ * chunk number 'read', the workers process them starting from 'work'
+ * and the results are written in order starting from 'written'. */
+struct batch_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct batch_chunk *chunks;
+	unsigned nchunks;
+	unsigned long read, work, written;
+	unsigned eof;
+
+	unsigned flags;
+	unsigned check_only;
+};
+
+/* Queues the reverse DNS queries of the chunk, so that they are in
+ * flight by the time its lines are processed */
+static void prefetch_hostnames(struct batch_chunk *chunk, unsigned flags)
+{
+	char str[INET6_ADDRSTRLEN];
+	unsigned char addr[sizeof(struct in6_addr)];
+	unsigned i;
+
+	if (!(flags & FLAG_RESOLVE_HOST))
+		return;
+
+	for (i = 0; i < chunk->nlines; i++) {
+		const char *p = chunk->lines[i];
+		size_t len;
+
+		p += strspn(p, " \t");
+		len = strcspn(p, "/ \t\r\n");
+		if (len == 0 || len >= sizeof(str))
+			continue;
+		memcpy(str, p, len);
+		str[len] = 0;
+
+		if ((flags & FLAG_IPV4) == 0 && strchr(str, ':') != NULL) {
+			if (inet_pton(AF_INET6, str, addr) > 0)
+				resolver_submit(AF_INET6, addr);
+		} else if ((flags & FLAG_IPV6) == 0) {
+			if (inet_pton(AF_INET, str, addr) > 0)
+				resolver_submit(AF_INET, addr);
+		}
+	}
+}
+
+static void process_chunk(struct batch_chunk *chunk, unsigned flags, unsigned check_only)
+{
+	unsigned i;
+
+	chunk->records = 0;
+	chunk->ret = 0;
+
+	chunk->out.len = 0;
+	output_set(&chunk->out);
+
+	for (i = 0; i < chunk->nlines; i++) {
+		int r = batch_line(chunk->lines[i], flags, check_only, chunk->records);
+
+		if (r < 0)
+			chunk->ret = 1;
+		else
+			chunk->records += r;
+	}
+
+	output_set(NULL);
+}
+
+static void *batch_worker(void *arg)
+{
+	struct batch_pool *pool = arg;
+	struct batch_chunk *chunk;
+
+	pthread_mutex_lock(&pool->lock);
+	while (1) {
+		while (pool->work == pool->read && !pool->eof)
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		if (pool->work == pool->read)
+			break;
+
+		chunk = &pool->chunks[pool->work++ % pool->nchunks];
+		pthread_mutex_unlock(&pool->lock);
+
+		process_chunk(chunk, pool->flags, pool->check_only);
+
+		pthread_mutex_lock(&pool->lock);
+		chunk->done = 1;
+		pthread_cond_broadcast(&pool->cond);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	stats_merge();
+	return NULL;
+}
+
+/* Reads up to CHUNK_LINES lines into the buffers of the chunk; returns
+ * 0 on end of input */
+static unsigned read_chunk(FILE *fp, struct batch_chunk *chunk)
+{
+	unsigned i;
+
+	chunk->nlines = 0;
+	chunk->done = 0;
+	while (chunk->nlines < CHUNK_LINES) {
+		i = chunk->nlines;
+		if (getline(&chunk->lines[i], &chunk->line_size[i], fp) == -1)
+			return 0;
+		chunk->nlines++;
+	}
+
+	return 1;
+}
+
+static void free_chunk(struct batch_chunk *chunk)
+{
+	unsigned i;
+
+	for (i = 0; i < CHUNK_LINES; i++)
+		free(chunk->lines[i]);
+	free(chunk->out.data);
+}
+
+static int show_batch_threaded(FILE *fp, unsigned flags, unsigned check_only, unsigned jobs)
+{
+	struct batch_pool pool;
+	pthread_t *threads;
+	unsigned long records = 0;
+	unsigned i, more = 1;
+	uint64_t t;
+	int ret = 0;
+
+	memset(&pool, 0, sizeof(pool));
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+	pool.flags = flags;
+	pool.check_only = check_only;
+	pool.nchunks = 2 * jobs;
+	pool.chunks = calloc(pool.nchunks, sizeof(pool.chunks[0]));
+	threads = calloc(jobs, sizeof(threads[0]));
+	if (pool.chunks == NULL || threads == NULL) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: memory error\n");
+		exit(1);
+	}
+	for (i = 0; i < pool.nchunks; i++)
+		output_init(&pool.chunks[i].out, NULL);
+
+	for (i = 0; i < jobs; i++) {
+		if (pthread_create(&threads[i], NULL, batch_worker, &pool) != 0) {
+			if (!beSilent)
+				fprintf(stderr, "ipcalc: could not create thread\n");
+			exit(1);
+		}
+	}
+
+	while (1) {
+		struct batch_chunk *chunk;
+
+		/* Only the reader modifies 'read' so the free slots can be
+		 * filled without holding the lock. */
+		while (more && pool.read - pool.written < pool.nchunks) {
+			chunk = &pool.chunks[pool.read % pool.nchunks];
+			more = read_chunk(fp, chunk);
+			prefetch_hostnames(chunk, flags);
+
+			pthread_mutex_lock(&pool.lock);
+			if (chunk->nlines > 0)
+				pool.read++;
+			if (!more)
+				pool.eof = 1;
+			pthread_cond_broadcast(&pool.cond);
+			pthread_mutex_unlock(&pool.lock);
+		}
+
+		if (pool.written == pool.read)
+			break;
+
+		chunk = &pool.chunks[pool.written % pool.nchunks];
+		pthread_mutex_lock(&pool.lock);
+		while (!chunk->done)
+			pthread_cond_wait(&pool.cond, &pool.lock);
+		pthread_mutex_unlock(&pool.lock);
+
+		t = stats_start();
+		if (chunk->records > 0 && records > 0 && separate_records(flags))
+			output_puts("\n");
+		output_write(chunk->out.data, chunk->out.len);
+		stats_lap(STATS_OUTPUT, &t);
+		records += chunk->records;
+		ret |= chunk->ret;
+
+		pthread_mutex_lock(&pool.lock);
+		pool.written++;
+		pthread_mutex_unlock(&pool.lock);
+	}
+
+	for (i = 0; i < jobs; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.lock);
+	for (i = 0; i < pool.nchunks; i++)
+		free_chunk(&pool.chunks[i]);
+	free(pool.chunks);
+	free(threads);
+
+	return ret;
+}
+
+/*!
+  \fn int show_batch(FILE *fp, unsigned flags, unsigned check_only, unsigned jobs)
+  \brief prints the information of every address read from fp
+
+  Every line of the input is expected to contain an address in the
+  ADDRESS[/PREFIX] format; empty lines and lines starting with '#' are
+  ignored. Processing continues past invalid lines; these are reported
+  on standard error, or as an error record in JSON mode.
+
+  When jobs is more than one, the lines are processed in chunks by that
+  many threads and the output is printed in the order of the input.
+
+  \param fp the input stream.
+  \param flags the flags specifying the information to print.
+  \param check_only when non-zero only validate the addresses.
+  \param jobs the number of threads to use.
+
+  \return 0 if all lines were processed, or 1 if any errors were found.
+*/
+int show_batch(FILE *fp, unsigned flags, unsigned check_only, unsigned jobs)
+{
+	struct batch_chunk chunk;
+	unsigned records = 0;
+	unsigned i, more = 1;
+	int ret = 0;
+
+	if (jobs > 1) {
+		ret = show_batch_threaded(fp, flags, check_only, jobs);
+	} else {
+		memset(&chunk, 0, sizeof(chunk));
+		while (more) {
+			more = read_chunk(fp, &chunk);
+			prefetch_hostnames(&chunk, flags);
+
+			for (i = 0; i < chunk.nlines; i++) {
+				int r = batch_line(chunk.lines[i], flags, check_only, records);
+
+				if (r < 0)
+					ret = 1;
+				else
+					records += r;
+			}
+		}
+		free_chunk(&chunk);
+	}
+
+	if (ferror(fp)) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: error reading input\n");
+		ret = 1;
+	}
+
+	return ret;
+}
@@ -27,34 +27,9 @@
 #include "ipcalc.h"
 #include "ipv6.h"
 
-static void deaggregate_v4(const char *ip1s, const char *ip2s, unsigned flags);
-static void deaggregate_v6(const char *ip1s, const char *ip2s, unsigned flags);
+static int deaggregate_range(int family, const char *ip1s, const char *ip2s, unsigned flags);
 
-static char *trim(char *str)
-{
-	int len, i;
-	char *out;
-
-	len = strlen(str);
-	for (i=len-1;i>=0;i--) {
-		if (isspace(str[i]))
-			str[i] = 0;
-		else
-			break;
-	}
-
-	out = str;
-	for (i=0;i<len;i++) {
-		if (isspace(str[i]))
-			out++;
-		else
-			break;
-	}
-
-	return out;
-}
-
-void deaggregate(char *str, unsigned flags)
+int deaggregate(char *str, unsigned flags)
 {
 	char *d1Str = NULL, *d2Str = NULL;
 
@@ -63,7 +38,7 @@ void deaggregate(char *str, unsigned flags)
 		if (!beSilent)
 			fprintf(stderr,
 				"ipcalc: bad deaggregation string: %s\n", str);
-		exit(1);
+		return -1;
 	}
 	d1Str = trim(d1Str);
 
@@ -73,161 +48,95 @@ void deaggregate(char *str, unsigned flags)
 		if (!beSilent)
 			fprintf(stderr,
 				"ipcalc: bad deaggregation string: %s\n", str);
-		exit(1);
+		return -1;
 	}
 	d2Str = trim(d2Str);
 
-	if (flags & FLAG_IPV6)
-		deaggregate_v6(d1Str, d2Str, flags);
-	else
-		deaggregate_v4(d1Str, d2Str, flags);
+	return deaggregate_range((flags & FLAG_IPV6) ? AF_INET6 : AF_INET, d1Str, d2Str, flags);
 }
 
-static void print_ipv4_net(unsigned *jsonchain, uint32_t ip, unsigned prefix, unsigned flags)
-{
-	char namebuf[INET_ADDRSTRLEN + 1] = {0};
-	struct in_addr s;
-
-	s.s_addr = htonl(ip);
-
-	if (inet_ntop(AF_INET, &s, namebuf, INET_ADDRSTRLEN) == NULL) {
-		fprintf(stderr, "inet_ntop failure at line %d\n",
-			__LINE__);
-		exit(1);
-	}
-
-	default_printf(jsonchain, "Network:\t", NULL, "%s/%u", namebuf, prefix);
-}
+/*!
+  \fn void deaggregate_ipv4_range(unsigned *jsonchain, uint32_t base, uint32_t end)
+  \brief prints the minimal set of networks covering the range
 
-void deaggregate_v4(const char *ip1s, const char *ip2s, unsigned flags)
+  \param jsonchain the JSON state of the output.
+  \param base the first address of the range, in host byte order.
+  \param end the last address of the range, in host byte order.
+*/
+void deaggregate_ipv4_range(unsigned *jsonchain, uint32_t base, uint32_t end)
 {
-	struct in_addr ip1, ip2;
-	unsigned step;
-	uint32_t base, end;
-	unsigned jsonchain;
-
-	if (inet_pton(AF_INET, ip1s, &ip1) <= 0) {
-		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad IPv4 address: %s\n",
-				ip1s);
-		exit(1);
-	}
-
-	if (inet_pton(AF_INET, ip2s, &ip2) <= 0) {
-		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad IPv4 address: %s\n",
-				ip2s);
-		exit(1);
-	}
-
-	base = ntohl(ip1.s_addr);
-	end = ntohl(ip2.s_addr);
-
-	if (base > end) {
-		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad range\n");
-		exit(1);
-	}
+	struct in_addr first, last;
+	ipcalc_deagg_st it;
 
-	output_start(&jsonchain);
-	array_start(&jsonchain, "Deaggregated networks", "DEAGGREGATEDNETWORK");
-
-	while (base <= end) {
-		step = 0;
-		while ((base | (1 << step)) != base) {
-			if ((base | (UINT32_MAX >> (31-step))) > end)
-				break;
-			step++;
-		}
-
-		print_ipv4_net(&jsonchain, base, 32-step, flags);
-		base += (1 << step);
-	}
-
-	array_stop(&jsonchain);
-	output_stop(&jsonchain);
-
-	return;
+	first.s_addr = htonl(base);
+	last.s_addr = htonl(end);
+	if (ipcalc_deagg_init(&it, AF_INET, &first, &last) == IPCALC_OK)
+		ipcalc_deagg_foreach(&it, output_network, jsonchain);
 }
 
-static void print_ipv6_net(unsigned *jsonchain, struct in6_addr *ip, unsigned prefix, unsigned flags)
-{
-	char namebuf[INET6_ADDRSTRLEN + 1] = {0};
-
-	if (inet_ntop(AF_INET6, ip, namebuf, sizeof(namebuf)) == NULL) {
-		fprintf(stderr, "inet_ntop failure at line %d\n",
-			__LINE__);
-		exit(1);
-	}
-
-	default_printf(jsonchain, "Network:\t", NULL, "%s/%u", namebuf, prefix);
-}
+/*!
+  \fn void deaggregate_ipv6_range(unsigned *jsonchain, const struct ipv6_num *first, const struct ipv6_num *end)
+  \brief prints the minimal set of networks covering the range
 
-static unsigned ipv6_base_ok(struct in6_addr *base, unsigned step)
+  \param jsonchain the JSON state of the output.
+  \param first the first address of the range.
+  \param end the last address of the range.
+*/
+void deaggregate_ipv6_range(unsigned *jsonchain, const struct ipv6_num *first, const struct ipv6_num *end)
 {
-	struct in6_addr b2;
-	memcpy(&b2, base, sizeof(b2));
-
-	ipv6_or1(&b2, step);
+	struct in6_addr ip1, ip2;
+	ipcalc_deagg_st it;
 
-	return memcmp(base->s6_addr, &b2.s6_addr, 16);
+	ipv6_store(&ip1, *first);
+	ipv6_store(&ip2, *end);
+	if (ipcalc_deagg_init(&it, AF_INET6, &ip1, &ip2) == IPCALC_OK)
+		ipcalc_deagg_foreach(&it, output_network, jsonchain);
 }
 
-void deaggregate_v6(const char *ip1s, const char *ip2s, unsigned flags)
+static int deaggregate_range(int family, const char *ip1s, const char *ip2s, unsigned flags)
 {
-	struct in6_addr ip1, ip2;
-	unsigned step;
-	struct in6_addr base, end;
-	struct in6_addr tmp;
+	const char *name = (family == AF_INET6) ? "IPv6" : "IPv4";
+	ipcalc_addr_un ip1, ip2;
+	ipcalc_deagg_st it;
 	unsigned jsonchain;
+	uint64_t t;
 
-	if (inet_pton(AF_INET6, ip1s, &ip1) <= 0) {
+	if (inet_pton(family, ip1s, &ip1) <= 0) {
 		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad IPv6 address: %s\n",
-				ip1s);
-		exit(1);
+			fprintf(stderr, "ipcalc: bad %s address: %s\n",
+				name, ip1s);
+		return -1;
 	}
 
-	if (inet_pton(AF_INET6, ip2s, &ip2) <= 0) {
+	if (inet_pton(family, ip2s, &ip2) <= 0) {
 		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad IPv6 address: %s\n",
-				ip2s);
-		exit(1);
+			fprintf(stderr, "ipcalc: bad %s address: %s\n",
+				name, ip2s);
+		return -1;
 	}
 
-	memcpy(&base, &ip1, sizeof(base));
-	memcpy(&end, &ip2, sizeof(end));
-
-	if (ipv6_cmp(&base, &end) > 0) {
+	if (ipcalc_deagg_init(&it, family, &ip1, &ip2) < 0) {
 		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad IPv6 range\n");
-		exit(1);
+			fprintf(stderr, "ipcalc: bad %srange\n",
+				(family == AF_INET6) ? "IPv6 " : "");
+		return -1;
 	}
 
 	output_start(&jsonchain);
-	array_start(&jsonchain, "Deaggregated networks", "DEAGGREGATEDNETWORK");
-
-
-	while (ipv6_cmp(&base, &end) <= 0) {
-		step = 0;
-		while (ipv6_base_ok(&base, step)) {
-			memcpy(&tmp, &base, sizeof(tmp));
-			ipv6_orm(&tmp, step+1);
-			if (ipv6_cmp(&tmp, &end) > 0)
-				break;
-			step++;
-		}
 
-		print_ipv6_net(&jsonchain, &base, 128-step, flags);
-		memset(&tmp, 0, sizeof(tmp));
-		ipv6_or1(&tmp, step);
-
-		/* v6add */
-		ipv6_add(&base, &tmp);
+	if (flags & FLAG_COUNT) {
+		default_printf(&jsonchain, "Total:  \t", "NETS", "%d", ipcalc_deagg_count(&it));
+		output_stop(&jsonchain);
+		return 0;
 	}
 
+	array_start(&jsonchain, "Deaggregated networks", "DEAGGREGATEDNETWORK");
+	t = stats_start();
+	ipcalc_deagg_foreach(&it, output_network, &jsonchain);
+	stats_lap(STATS_OUTPUT, &t);
+
 	array_stop(&jsonchain);
 	output_stop(&jsonchain);
 
-	return;
+	return 0;
 }
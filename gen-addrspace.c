@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Build time generator of the address type tables used by
+ * ipv4_net_to_type() and ipv6_net_to_type(). It reads the registry
+ * files (ipv4-address-space.txt and ipv6-address-space.txt) and prints
+ * a C header with the entries grouped by the first byte of the address.
+ * Within each group the entries are sorted from the longest prefix to
+ * the shortest, so the first match is the most specific one.
+ *
+ * Usage: gen-addrspace IPV4_FILE IPV6_FILE > addrspace.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <arpa/inet.h>
+
+#define MAX_ENTRIES 256
+
+struct entry {
+	unsigned char addr[16];
+	unsigned len;
+	unsigned any;
+	char name[128];
+};
+
+static void fail(const char *file, unsigned line, const char *msg)
+{
+	fprintf(stderr, "gen-addrspace: %s:%u: %s\n", file, line, msg);
+	exit(1);
+}
+
+static int read_entries(const char *file, int family, struct entry *entries)
+{
+	char line[512];
+	unsigned lineno = 0;
+	unsigned bits = (family == AF_INET) ? 32 : 128;
+	int n = 0;
+	FILE *fp;
+
+	fp = fopen(file, "r");
+	if (fp == NULL) {
+		perror(file);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *str = line, *prefix, *match, *name, *p;
+		struct entry *e;
+		unsigned i;
+		long len;
+
+		lineno++;
+		while (isspace((unsigned char)*str))
+			str++;
+		if (*str == 0 || *str == '#')
+			continue;
+
+		prefix = strtok(str, " \t\n");
+		match = strtok(NULL, " \t\n");
+		name = strtok(NULL, "\n");
+		if (prefix == NULL || match == NULL || name == NULL)
+			fail(file, lineno, "expected PREFIX MATCH DESCRIPTION");
+
+		while (isspace((unsigned char)*name))
+			name++;
+		p = name + strlen(name);
+		while (p > name && isspace((unsigned char)p[-1]))
+			*--p = 0;
+		if (*name == 0 || strlen(name) >= sizeof(e->name) || strpbrk(name, "\"\\"))
+			fail(file, lineno, "invalid description");
+
+		if (n == MAX_ENTRIES)
+			fail(file, lineno, "too many entries");
+		e = &entries[n++];
+		memset(e, 0, sizeof(*e));
+		strcpy(e->name, name);
+
+		if (strcmp(match, "any") == 0)
+			e->any = 1;
+		else if (strcmp(match, "net") != 0)
+			fail(file, lineno, "the match type must be 'any' or 'net'");
+
+		p = strchr(prefix, '/');
+		if (p == NULL)
+			fail(file, lineno, "missing prefix length");
+		*p++ = 0;
+		len = strtol(p, &p, 10);
+		if (*p != 0 || len < 0 || len > bits)
+			fail(file, lineno, "invalid prefix length");
+		e->len = len;
+
+		if (inet_pton(family, prefix, e->addr) <= 0)
+			fail(file, lineno, "invalid address");
+
+		for (i = e->len; i < bits; i++) {
+			if (e->addr[i / 8] & (0x80 >> (i % 8)))
+				fail(file, lineno, "the address has host bits set");
+		}
+	}
+
+	fclose(fp);
+	return n;
+}
+
+/* longest prefix first; entries of the same length do not overlap */
+static int cmp_entries(const void *a, const void *b)
+{
+	const struct entry *e1 = a;
+	const struct entry *e2 = b;
+
+	if (e1->len != e2->len)
+		return (e1->len > e2->len) ? -1 : 1;
+	return memcmp(e1->addr, e2->addr, sizeof(e1->addr));
+}
+
+/* whether the entry contains addresses whose first byte is b */
+static int in_bucket(const struct entry *e, unsigned b)
+{
+	unsigned bits = e->len >= 8 ? 8 : e->len;
+	unsigned mask = (0xff00 >> bits) & 0xff;
+
+	return (b & mask) == e->addr[0];
+}
+
+static void print_table(const char *fam, int family, struct entry *entries, int n)
+{
+	unsigned index[257];
+	unsigned b, count = 0;
+	int i, j;
+
+	qsort(entries, n, sizeof(entries[0]), cmp_entries);
+
+	printf("static const struct %s_type_entry %s_types[] = {\n", fam, fam);
+	for (b = 0; b < 256; b++) {
+		index[b] = count;
+		for (i = 0; i < n; i++) {
+			struct entry *e = &entries[i];
+
+			if (!in_bucket(e, b))
+				continue;
+
+			count++;
+			if (family == AF_INET) {
+				printf("\t{0x%.2x%.2x%.2x%.2x, %u, %u, \"%s\"},\n",
+				       e->addr[0], e->addr[1], e->addr[2], e->addr[3],
+				       e->len, e->any, e->name);
+			} else {
+				printf("\t{{");
+				for (j = 0; j < 16; j++)
+					printf("%s0x%.2x", j ? "," : "", e->addr[j]);
+				printf("}, %u, %u, \"%s\"},\n", e->len, e->any, e->name);
+			}
+		}
+	}
+	index[256] = count;
+	if (count == 0)
+		printf("\t{0}\n");
+	printf("};\n\n");
+
+	printf("static const uint16_t %s_types_index[257] = {", fam);
+	for (b = 0; b < 257; b++)
+		printf("%s%u", b == 0 ? "\n\t" : (b % 16) ? ", " : ",\n\t", index[b]);
+	printf("\n};\n\n");
+}
+
+int main(int argc, char **argv)
+{
+	static struct entry entries[MAX_ENTRIES];
+	int n;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: gen-addrspace IPV4_FILE IPV6_FILE\n");
+		return 1;
+	}
+
+	printf("/* Generated by gen-addrspace; do not edit */\n\n");
+	printf("#ifndef _ADDRSPACE_H\n#define _ADDRSPACE_H\n\n");
+	printf("#include <stdint.h>\n\n");
+	printf("/* net is in host byte order; any is set when the entry applies\n"
+	       " * regardless of the network prefix, otherwise the prefix must be\n"
+	       " * at least len */\n");
+	printf("struct ipv4_type_entry {\n\tuint32_t net;\n\tuint8_t len;\n\tuint8_t any;\n\tconst char *name;\n};\n\n");
+	printf("struct ipv6_type_entry {\n\tuint8_t net[16];\n\tuint8_t len;\n\tuint8_t any;\n\tconst char *name;\n};\n\n");
+
+	n = read_entries(argv[1], AF_INET, entries);
+	print_table("ipv4", AF_INET, entries, n);
+
+	n = read_entries(argv[2], AF_INET6, entries);
+	print_table("ipv6", AF_INET6, entries, n);
+
+	printf("#endif\n");
+	return 0;
+}
@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * ipcalc-bench: measures the speed of the calculations of ipcalc.
+ *
+ * Every benchmark runs a number of operations on pseudo-random input
+ * which is the same in every run, so that the results of different
+ * versions can be compared. Only the operations are timed, not the
+ * generation of their input. The results are printed one per line as
+ * tab separated fields: the name of the benchmark, the number of
+ * operations, the nanoseconds per operation and the operations per
+ * second. Lines starting with '#' are comments.
+ */
+
+#define _GNU_SOURCE		/* getline, fmemopen */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "ipcalc.h"
+
+int beSilent = 1;
+
+/* The networks produced by a split or deaggregation at a time */
+#define BATCH_SIZE 256
+
+/* The distinct inputs of a benchmark, reused cyclically */
+#define INPUT_SIZE 4096
+
+struct bench_st {
+	const char *name;
+	const char *desc;
+	uint64_t ops;		/* the default number of operations */
+	/* runs about n operations; returns the number run, or 0 if the
+	 * benchmark is not available */
+	uint64_t (*run)(uint64_t n);
+};
+
+static struct timespec timer_begin;
+static double timer_elapsed;
+
+/* Keeps the compiler from dropping the computations */
+static volatile uint64_t sink;
+
+static void timer_start(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &timer_begin);
+}
+
+static void timer_stop(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timer_elapsed = (now.tv_sec - timer_begin.tv_sec) +
+			(now.tv_nsec - timer_begin.tv_nsec) / 1e9;
+}
+
+/* xorshift64*; the seed is fixed so that every run has the same input */
+static uint64_t rand_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t rand64(void)
+{
+	rand_state ^= rand_state >> 12;
+	rand_state ^= rand_state << 25;
+	rand_state ^= rand_state >> 27;
+	return rand_state * 0x2545f4914f6cdd1dULL;
+}
+
+static void rand_net(ipcalc_net_st *net, int family)
+{
+	uint64_t r = rand64();
+
+	net->family = family;
+	if (family == AF_INET) {
+		net->prefix = r % 33;
+		net->addr.v4.s_addr = (uint32_t)(r >> 32);
+	} else {
+		net->prefix = r % 129;
+		memcpy(&net->addr.v6.s6_addr[0], &r, 8);
+		r = rand64();
+		memcpy(&net->addr.v6.s6_addr[8], &r, 8);
+	}
+}
+
+static ipcalc_net_st *rand_nets(int family)
+{
+	ipcalc_net_st *nets = malloc(INPUT_SIZE * sizeof(*nets));
+	unsigned i;
+
+	if (nets == NULL) {
+		fprintf(stderr, "ipcalc-bench: memory error\n");
+		exit(1);
+	}
+	for (i = 0; i < INPUT_SIZE; i++)
+		rand_net(&nets[i], family);
+	return nets;
+}
+
+static uint64_t run_info(uint64_t n, int family)
+{
+	ipcalc_net_st *nets = rand_nets(family);
+	ipcalc_info_st info;
+	uint64_t i, sum = 0;
+
+	timer_start();
+	for (i = 0; i < n; i++) {
+		ipcalc_info(&nets[i % INPUT_SIZE], &info);
+		sum += info.maxaddr.v4.s_addr;
+	}
+	timer_stop();
+
+	sink = sum;
+	free(nets);
+	return n;
+}
+
+static uint64_t bench_info_ipv4(uint64_t n)
+{
+	return run_info(n, AF_INET);
+}
+
+static uint64_t bench_info_ipv6(uint64_t n)
+{
+	return run_info(n, AF_INET6);
+}
+
+/* Splits net to the prefix, or the first n networks of it */
+static uint64_t run_split(const char *str, unsigned prefix, uint64_t n, unsigned format)
+{
+	ipcalc_net_st net, nets[BATCH_SIZE];
+	char buf[IPCALC_NET_SIZE];
+	ipcalc_split_st it;
+	uint64_t count = 0, sum = 0;
+	size_t i, k;
+
+	if (ipcalc_parse_net(str, NULL, &net) < 0 ||
+	    ipcalc_split_init(&it, &net, prefix) < 0 ||
+	    ipcalc_split_slice(&it, 0, n) < 0)
+		return 0;
+
+	timer_start();
+	while ((k = ipcalc_split_fill(&it, nets, BATCH_SIZE)) > 0) {
+		for (i = 0; i < k; i++) {
+			if (format)
+				sum += ipcalc_format_net(&nets[i], buf, sizeof(buf));
+			else
+				sum += nets[i].addr.v4.s_addr;
+		}
+		count += k;
+	}
+	timer_stop();
+
+	sink = sum;
+	return count;
+}
+
+static uint64_t bench_split_ipv4(uint64_t n)
+{
+	return run_split("10.0.0.0/8", 32, n, 0);
+}
+
+static uint64_t bench_split_ipv6(uint64_t n)
+{
+	return run_split("2001:db8::/32", 64, n, 0);
+}
+
+static uint64_t bench_split_format_ipv4(uint64_t n)
+{
+	return run_split("10.0.0.0/8", 32, n, 1);
+}
+
+static uint64_t bench_split_format_ipv6(uint64_t n)
+{
+	return run_split("2001:db8::/32", 64, n, 1);
+}
+
+/* Deaggregates random ranges until about n networks are produced */
+static uint64_t run_deagg(uint64_t n, int family)
+{
+	ipcalc_net_st *first = rand_nets(family), *last = rand_nets(family);
+	ipcalc_net_st nets[BATCH_SIZE];
+	ipcalc_deagg_st it;
+	uint64_t count = 0, sum = 0;
+	size_t k;
+	unsigned i;
+
+	/* the generated ranges are valid when the first address is the
+	 * smaller one */
+	for (i = 0; i < INPUT_SIZE; i++) {
+		if (memcmp(&first[i].addr, &last[i].addr, sizeof(first[i].addr)) > 0) {
+			ipcalc_net_st tmp = first[i];
+
+			first[i] = last[i];
+			last[i] = tmp;
+		}
+	}
+
+	timer_start();
+	for (i = 0; count < n; i = (i + 1) % INPUT_SIZE) {
+		if (ipcalc_deagg_init(&it, family, &first[i].addr, &last[i].addr) < 0)
+			continue;
+		while ((k = ipcalc_deagg_fill(&it, nets, BATCH_SIZE)) > 0) {
+			sum += nets[k - 1].prefix;
+			count += k;
+		}
+	}
+	timer_stop();
+
+	sink = sum;
+	free(first);
+	free(last);
+	return count;
+}
+
+static uint64_t bench_deagg_ipv4(uint64_t n)
+{
+	return run_deagg(n, AF_INET);
+}
+
+static uint64_t bench_deagg_ipv6(uint64_t n)
+{
+	return run_deagg(n, AF_INET6);
+}
+
+static uint64_t run_classify(uint64_t n, int family)
+{
+	ipcalc_net_st *nets = rand_nets(family);
+	const char *s;
+	uint64_t i, sum = 0;
+
+	timer_start();
+	for (i = 0; i < n; i++) {
+		const ipcalc_net_st *net = &nets[i % INPUT_SIZE];
+
+		s = ipcalc_addrspace(net);
+		sum += (uintptr_t)s;
+		if (family == AF_INET) {
+			s = ipcalc_class(net);
+			sum += (uintptr_t)s;
+		}
+	}
+	timer_stop();
+
+	sink = sum;
+	free(nets);
+	return n;
+}
+
+static uint64_t bench_classify_ipv4(uint64_t n)
+{
+	return run_classify(n, AF_INET);
+}
+
+static uint64_t bench_classify_ipv6(uint64_t n)
+{
+	return run_classify(n, AF_INET6);
+}
+
+static uint64_t bench_geoip(uint64_t n)
+{
+#if defined(USE_GEOIP) || defined(USE_MAXMIND)
+	static char addrs[INPUT_SIZE][INET6_ADDRSTRLEN];
+	struct ip_info_st info;
+	struct in_addr ip;
+	uint64_t i, sum = 0;
+
+	if (geo_setup() != 0)
+		return 0;
+
+	for (i = 0; i < INPUT_SIZE; i++) {
+		ip.s_addr = (uint32_t)rand64();
+		inet_ntop(AF_INET, &ip, addrs[i], sizeof(addrs[i]));
+	}
+
+	timer_start();
+	for (i = 0; i < n; i++) {
+		memset(&info, 0, sizeof(info));
+		geo_ip_lookup(addrs[i % INPUT_SIZE], &info);
+		sum += info.geoip_ccode[0];
+	}
+	timer_stop();
+
+	sink = sum;
+	return n;
+#else
+	return 0;
+#endif
+}
+
+/* Reads and parses a stream of lines as --batch does */
+static uint64_t bench_parse(uint64_t n)
+{
+	const ipcalc_opts_st opts = { IPCALC_OPT_CLASS_PREFIX };
+	char *text, *line = NULL, *p;
+	size_t size = 0, len = 0;
+	ipcalc_net_st net;
+	uint64_t i, count, sum = 0;
+	FILE *fp;
+
+	/* a mix of addresses and networks of both families */
+	text = malloc(INPUT_SIZE * (IPCALC_NET_SIZE + 1));
+	if (text == NULL) {
+		fprintf(stderr, "ipcalc-bench: memory error\n");
+		exit(1);
+	}
+	for (i = 0; i < INPUT_SIZE; i++) {
+		rand_net(&net, (i % 4 == 3) ? AF_INET6 : AF_INET);
+		p = text + len;
+		if (i % 2)
+			len += ipcalc_format_net(&net, p, IPCALC_NET_SIZE);
+		else
+			len += ipcalc_format_addr(net.family, &net.addr, p, IPCALC_NET_SIZE);
+		text[len++] = '\n';
+	}
+
+	timer_start();
+	for (count = 0; count < n; count += INPUT_SIZE) {
+		fp = fmemopen(text, len, "r");
+		if (fp == NULL)
+			break;
+		while (getline(&line, &size, fp) != -1) {
+			line[strcspn(line, "\n")] = 0;
+			if (ipcalc_parse_net(line, &opts, &net) == IPCALC_OK)
+				sum += net.prefix;
+		}
+		fclose(fp);
+	}
+	timer_stop();
+
+	sink = sum;
+	free(line);
+	free(text);
+	return count;
+}
+
+static const struct bench_st benchmarks[] = {
+	{"info-ipv4", "ipcalc_info() of IPv4 networks", 8000000, bench_info_ipv4},
+	{"info-ipv6", "ipcalc_info() of IPv6 networks", 8000000, bench_info_ipv6},
+	{"split-ipv4", "split of 10.0.0.0/8 to /32", 1ULL << 24, bench_split_ipv4},
+	{"split-ipv6", "split of 2001:db8::/32 to /64, the first 2^24 networks", 1ULL << 24, bench_split_ipv6},
+	{"split-format-ipv4", "split of 10.0.0.0/8 to /32, formatted", 1ULL << 24, bench_split_format_ipv4},
+	{"split-format-ipv6", "split of 2001:db8::/32 to /64, formatted, the first 2^22 networks", 1ULL << 22, bench_split_format_ipv6},
+	{"deaggregate-ipv4", "deaggregation of random IPv4 ranges, per network", 8000000, bench_deagg_ipv4},
+	{"deaggregate-ipv6", "deaggregation of random IPv6 ranges, per network", 8000000, bench_deagg_ipv6},
+	{"classify-ipv4", "address space and class of IPv4 addresses", 8000000, bench_classify_ipv4},
+	{"classify-ipv6", "address space of IPv6 addresses", 8000000, bench_classify_ipv6},
+	{"geoip", "GeoIP lookup of IPv4 addresses", 200000, bench_geoip},
+	{"parse-batch", "reading and parsing of --batch lines", 2000000, bench_parse},
+	{NULL, NULL, 0, NULL}
+};
+
+static void run_bench(const struct bench_st *b, unsigned divisor)
+{
+	uint64_t ops;
+
+	timer_elapsed = 0;
+	ops = b->run(b->ops / divisor ? b->ops / divisor : 1);
+	if (ops == 0) {
+		printf("# %s: not available\n", b->name);
+		return;
+	}
+	if (timer_elapsed <= 0)
+		timer_elapsed = 1e-9;
+
+	printf("%s\t%" PRIu64 "\t%.2f\t%.0f\n", b->name, ops,
+	       timer_elapsed * 1e9 / ops, ops / timer_elapsed);
+	fflush(stdout);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: ipcalc-bench [--quick] [--list] [BENCHMARK...]\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option long_options[] = {
+		{"quick", 0, NULL, 'q'},
+		{"list", 0, NULL, 'l'},
+		{"help", 0, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	const struct bench_st *b;
+	unsigned divisor = 1;
+	int c, i, ret = 0;
+
+	while ((c = getopt_long(argc, argv, "qlh", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'q':
+			/* for a check that the benchmarks work */
+			divisor = 64;
+			break;
+		case 'l':
+			for (b = benchmarks; b->name; b++)
+				printf("%s\t%s\n", b->name, b->desc);
+			return 0;
+		case 'h':
+			usage();
+			return 0;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	printf("# benchmark\tops\tns/op\tops/s\n");
+
+	if (optind == argc) {
+		for (b = benchmarks; b->name; b++)
+			run_bench(b, divisor);
+		return 0;
+	}
+
+	for (i = optind; i < argc; i++) {
+		for (b = benchmarks; b->name; b++) {
+			if (strcmp(b->name, argv[i]) == 0)
+				break;
+		}
+		if (b->name == NULL) {
+			fprintf(stderr, "ipcalc-bench: unknown benchmark: %s\n", argv[i]);
+			ret = 1;
+			continue;
+		}
+		run_bench(b, divisor);
+	}
+
+	return ret;
+}
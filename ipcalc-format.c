@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Address formatters for the output of large splits and deaggregations.
+ * They produce the same text as inet_ntop(), without its overhead.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include "ipcalc.h"
+#include "ipv6.h"
+
+static const struct {
+	char str[3];
+	unsigned char len;
+} octet_str[256] = {
+	{"0", 1}, {"1", 1}, {"2", 1}, {"3", 1}, {"4", 1}, {"5", 1}, {"6", 1}, {"7", 1},
+	{"8", 1}, {"9", 1}, {"10", 2}, {"11", 2}, {"12", 2}, {"13", 2}, {"14", 2}, {"15", 2},
+	{"16", 2}, {"17", 2}, {"18", 2}, {"19", 2}, {"20", 2}, {"21", 2}, {"22", 2}, {"23", 2},
+	{"24", 2}, {"25", 2}, {"26", 2}, {"27", 2}, {"28", 2}, {"29", 2}, {"30", 2}, {"31", 2},
+	{"32", 2}, {"33", 2}, {"34", 2}, {"35", 2}, {"36", 2}, {"37", 2}, {"38", 2}, {"39", 2},
+	{"40", 2}, {"41", 2}, {"42", 2}, {"43", 2}, {"44", 2}, {"45", 2}, {"46", 2}, {"47", 2},
+	{"48", 2}, {"49", 2}, {"50", 2}, {"51", 2}, {"52", 2}, {"53", 2}, {"54", 2}, {"55", 2},
+	{"56", 2}, {"57", 2}, {"58", 2}, {"59", 2}, {"60", 2}, {"61", 2}, {"62", 2}, {"63", 2},
+	{"64", 2}, {"65", 2}, {"66", 2}, {"67", 2}, {"68", 2}, {"69", 2}, {"70", 2}, {"71", 2},
+	{"72", 2}, {"73", 2}, {"74", 2}, {"75", 2}, {"76", 2}, {"77", 2}, {"78", 2}, {"79", 2},
+	{"80", 2}, {"81", 2}, {"82", 2}, {"83", 2}, {"84", 2}, {"85", 2}, {"86", 2}, {"87", 2},
+	{"88", 2}, {"89", 2}, {"90", 2}, {"91", 2}, {"92", 2}, {"93", 2}, {"94", 2}, {"95", 2},
+	{"96", 2}, {"97", 2}, {"98", 2}, {"99", 2}, {"100", 3}, {"101", 3}, {"102", 3}, {"103", 3},
+	{"104", 3}, {"105", 3}, {"106", 3}, {"107", 3}, {"108", 3}, {"109", 3}, {"110", 3}, {"111", 3},
+	{"112", 3}, {"113", 3}, {"114", 3}, {"115", 3}, {"116", 3}, {"117", 3}, {"118", 3}, {"119", 3},
+	{"120", 3}, {"121", 3}, {"122", 3}, {"123", 3}, {"124", 3}, {"125", 3}, {"126", 3}, {"127", 3},
+	{"128", 3}, {"129", 3}, {"130", 3}, {"131", 3}, {"132", 3}, {"133", 3}, {"134", 3}, {"135", 3},
+	{"136", 3}, {"137", 3}, {"138", 3}, {"139", 3}, {"140", 3}, {"141", 3}, {"142", 3}, {"143", 3},
+	{"144", 3}, {"145", 3}, {"146", 3}, {"147", 3}, {"148", 3}, {"149", 3}, {"150", 3}, {"151", 3},
+	{"152", 3}, {"153", 3}, {"154", 3}, {"155", 3}, {"156", 3}, {"157", 3}, {"158", 3}, {"159", 3},
+	{"160", 3}, {"161", 3}, {"162", 3}, {"163", 3}, {"164", 3}, {"165", 3}, {"166", 3}, {"167", 3},
+	{"168", 3}, {"169", 3}, {"170", 3}, {"171", 3}, {"172", 3}, {"173", 3}, {"174", 3}, {"175", 3},
+	{"176", 3}, {"177", 3}, {"178", 3}, {"179", 3}, {"180", 3}, {"181", 3}, {"182", 3}, {"183", 3},
+	{"184", 3}, {"185", 3}, {"186", 3}, {"187", 3}, {"188", 3}, {"189", 3}, {"190", 3}, {"191", 3},
+	{"192", 3}, {"193", 3}, {"194", 3}, {"195", 3}, {"196", 3}, {"197", 3}, {"198", 3}, {"199", 3},
+	{"200", 3}, {"201", 3}, {"202", 3}, {"203", 3}, {"204", 3}, {"205", 3}, {"206", 3}, {"207", 3},
+	{"208", 3}, {"209", 3}, {"210", 3}, {"211", 3}, {"212", 3}, {"213", 3}, {"214", 3}, {"215", 3},
+	{"216", 3}, {"217", 3}, {"218", 3}, {"219", 3}, {"220", 3}, {"221", 3}, {"222", 3}, {"223", 3},
+	{"224", 3}, {"225", 3}, {"226", 3}, {"227", 3}, {"228", 3}, {"229", 3}, {"230", 3}, {"231", 3},
+	{"232", 3}, {"233", 3}, {"234", 3}, {"235", 3}, {"236", 3}, {"237", 3}, {"238", 3}, {"239", 3},
+	{"240", 3}, {"241", 3}, {"242", 3}, {"243", 3}, {"244", 3}, {"245", 3}, {"246", 3}, {"247", 3},
+	{"248", 3}, {"249", 3}, {"250", 3}, {"251", 3}, {"252", 3}, {"253", 3}, {"254", 3}, {"255", 3},
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/*!
+  \fn unsigned format_octet(char *buf, unsigned octet)
+  \brief formats a number from 0 to 255 in decimal
+
+  \param buf the output buffer, at least 3 bytes.
+  \param octet the number.
+
+  \return the length of the number, which is not null terminated.
+*/
+unsigned format_octet(char *buf, unsigned octet)
+{
+	memcpy(buf, octet_str[octet].str, 3);
+	return octet_str[octet].len;
+}
+
+/*!
+  \fn unsigned format_ipv4(char *buf, uint32_t addr)
+  \brief formats an IPv4 address as a dotted quad
+
+  \param buf the output buffer, at least INET_ADDRSTRLEN bytes.
+  \param addr the address in host byte order.
+
+  \return the length of the null terminated string.
+*/
+unsigned format_ipv4(char *buf, uint32_t addr)
+{
+	unsigned len;
+
+	len = format_octet(buf, addr >> 24);
+	buf[len++] = '.';
+	len += format_octet(buf + len, (addr >> 16) & 0xff);
+	buf[len++] = '.';
+	len += format_octet(buf + len, (addr >> 8) & 0xff);
+	buf[len++] = '.';
+	len += format_octet(buf + len, addr & 0xff);
+	buf[len] = 0;
+
+	return len;
+}
+
+static unsigned format_hex16(char *buf, unsigned word)
+{
+	unsigned len = 0;
+
+	if (word >= 0x1000)
+		buf[len++] = hex_digits[word >> 12];
+	if (word >= 0x100)
+		buf[len++] = hex_digits[(word >> 8) & 0xf];
+	if (word >= 0x10)
+		buf[len++] = hex_digits[(word >> 4) & 0xf];
+	buf[len++] = hex_digits[word & 0xf];
+
+	return len;
+}
+
+/*!
+  \fn unsigned format_ipv6(char *buf, const struct in6_addr *addr)
+  \brief formats an IPv6 address in the compressed form
+
+  The longest run of two or more zero words is replaced by "::", and
+  the IPv4-mapped and IPv4-compatible addresses end with a dotted quad,
+  as with inet_ntop().
+
+  \param buf the output buffer, at least INET6_ADDRSTRLEN bytes.
+  \param addr the address.
+
+  \return the length of the null terminated string.
+*/
+unsigned format_ipv6(char *buf, const struct in6_addr *addr)
+{
+	const uint8_t *b = addr->s6_addr;
+	unsigned words[8];
+	int best_base = -1, best_len = 0, cur_base = -1, cur_len = 0;
+	unsigned i, len = 0;
+
+	/* find the longest zero run in a single pass */
+	for (i = 0; i < 8; i++) {
+		words[i] = (b[2 * i] << 8) | b[2 * i + 1];
+		if (words[i] == 0) {
+			if (cur_base < 0)
+				cur_base = i;
+			if (++cur_len > best_len) {
+				best_base = cur_base;
+				best_len = cur_len;
+			}
+		} else {
+			cur_base = -1;
+			cur_len = 0;
+		}
+	}
+	if (best_len < 2)
+		best_base = -1;
+
+	for (i = 0; i < 8; i++) {
+		if (best_base >= 0 && (int)i >= best_base && (int)i < best_base + best_len) {
+			if ((int)i == best_base)
+				buf[len++] = ':';
+			continue;
+		}
+
+		if (i > 0)
+			buf[len++] = ':';
+
+		if (i == 6 && best_base == 0 &&
+		    (best_len == 6 || (best_len == 5 && words[5] == 0xffff))) {
+			len += format_ipv4(buf + len, ((uint32_t)b[12] << 24) | (b[13] << 16) | (b[14] << 8) | b[15]);
+			return len;
+		}
+
+		len += format_hex16(buf + len, words[i]);
+	}
+
+	if (best_base >= 0 && best_base + best_len == 8)
+		buf[len++] = ':';
+	buf[len] = 0;
+
+	return len;
+}
+
+/*!
+  \fn unsigned format_prefix(char *buf, unsigned prefix)
+  \brief appends "/prefix" to an address
+
+  \param buf the end of the address, with room for at least 5 bytes.
+  \param prefix the prefix length, up to 128.
+
+  \return the length of the null terminated string.
+*/
+unsigned format_prefix(char *buf, unsigned prefix)
+{
+	unsigned len = 0;
+
+	buf[len++] = '/';
+	if (prefix >= 100) {
+		buf[len++] = '1';
+		prefix -= 100;
+		buf[len++] = '0' + prefix / 10;
+	} else if (prefix >= 10) {
+		buf[len++] = '0' + prefix / 10;
+	}
+	buf[len++] = '0' + prefix % 10;
+	buf[len] = 0;
+
+	return len;
+}
+
+/*!
+  \fn unsigned format_uint128(char *buf, const struct ipv6_num *n)
+  \brief formats a 128-bit number in decimal
+
+  \param buf the output buffer, at least 40 bytes.
+  \param n the number.
+
+  \return the length of the null terminated string.
+*/
+unsigned format_uint128(char *buf, const struct ipv6_num *n)
+{
+	uint32_t limbs[4] = {n->hi >> 32, n->hi & UINT32_MAX, n->lo >> 32, n->lo & UINT32_MAX};
+	char digits[40];
+	unsigned len = 0, i, nonzero;
+
+	/* divide by ten until the number is zero, most significant limb first */
+	do {
+		uint64_t rem = 0;
+
+		nonzero = 0;
+		for (i = 0; i < 4; i++) {
+			uint64_t cur = (rem << 32) | limbs[i];
+
+			limbs[i] = cur / 10;
+			rem = cur % 10;
+			nonzero |= limbs[i];
+		}
+		digits[len++] = '0' + rem;
+	} while (nonzero);
+
+	for (i = 0; i < len; i++)
+		buf[i] = digits[len - 1 - i];
+	buf[len] = 0;
+
+	return len;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A cache of the GeoIP results, keyed by the network of the database
+ * record that covers the address; every address of that network has the
+ * same result, so one lookup serves all of them. Every thread has its
+ * own cache, a hash table of GEO_CACHE_SIZE entries in which a new
+ * network replaces the one it collides with.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "ipcalc.h"
+
+#if defined(USE_GEOIP) || defined(USE_MAXMIND)
+
+/* The entries of the cache of every thread; a power of two */
+#define GEO_CACHE_SIZE 4096
+
+struct geo_entry {
+	unsigned used;
+	int family;
+	unsigned prefix;
+	unsigned char net[16];
+	char country[GEO_INFO_SIZE];
+	char ccode[GEO_INFO_SIZE];
+	char city[GEO_INFO_SIZE];
+	char coord[GEO_INFO_SIZE];
+};
+
+struct geo_cache {
+	unsigned generation;
+	/* the number of entries of every prefix length, by family */
+	unsigned prefixes[2][129];
+	struct geo_entry entries[GEO_CACHE_SIZE];
+};
+
+/* Incremented when the databases change; the cache of a thread is
+ * emptied when it was filled under an older value */
+static unsigned geo_cache_generation;
+
+static pthread_key_t geo_cache_key;
+static pthread_once_t geo_cache_once = PTHREAD_ONCE_INIT;
+
+static void geo_cache_key_init(void)
+{
+	pthread_key_create(&geo_cache_key, free);
+}
+
+static struct geo_cache *get_cache(void)
+{
+	struct geo_cache *c;
+
+	pthread_once(&geo_cache_once, geo_cache_key_init);
+
+	c = pthread_getspecific(geo_cache_key);
+	if (c == NULL) {
+		c = calloc(1, sizeof(*c));
+		if (c != NULL && pthread_setspecific(geo_cache_key, c) != 0) {
+			free(c);
+			c = NULL;
+		}
+		if (c == NULL)
+			return NULL;
+		c->generation = __atomic_load_n(&geo_cache_generation, __ATOMIC_ACQUIRE);
+	} else if (c->generation != __atomic_load_n(&geo_cache_generation, __ATOMIC_ACQUIRE)) {
+		memset(c, 0, sizeof(*c));
+		c->generation = __atomic_load_n(&geo_cache_generation, __ATOMIC_ACQUIRE);
+	}
+	return c;
+}
+
+/*!
+  \fn void geo_cache_invalidate(void)
+  \brief drops the cached results of all the threads
+*/
+void geo_cache_invalidate(void)
+{
+	__atomic_add_fetch(&geo_cache_generation, 1, __ATOMIC_RELEASE);
+}
+
+/* Stores the network of the given prefix length of addr in net */
+static void mask_addr(unsigned char *net, const unsigned char *addr, unsigned size, unsigned prefix)
+{
+	unsigned i;
+
+	for (i = 0; i < size; i++, prefix = prefix > 8 ? prefix - 8 : 0)
+		net[i] = prefix >= 8 ? addr[i] : addr[i] & (0xff00 >> prefix);
+}
+
+static struct geo_entry *find_entry(struct geo_cache *c, int family, unsigned prefix,
+				    const unsigned char *net, unsigned size)
+{
+	uint32_t h = 2166136261u ^ prefix;
+	unsigned i;
+
+	for (i = 0; i < size; i++)
+		h = (h ^ net[i]) * 16777619u;
+
+	return &c->entries[(h ^ (h >> 16)) & (GEO_CACHE_SIZE - 1)];
+}
+
+/*!
+  \fn void geo_cache_lookup(const char *ip, int family, const void *addr, struct ip_info_st *info)
+  \brief fills in the GeoIP information of the address, from the cache if possible
+
+  \param ip the address as a string.
+  \param family the address family, either AF_INET or AF_INET6.
+  \param addr a pointer to a struct in_addr or a struct in6_addr.
+  \param info the information to fill in.
+*/
+void geo_cache_lookup(const char *ip, int family, const void *addr, struct ip_info_st *info)
+{
+	unsigned fi = (family == AF_INET6), bits = fi ? 128 : 32, size = bits / 8;
+	struct geo_cache *c = get_cache();
+	struct geo_entry *e;
+	unsigned char net[16];
+	int prefix;
+
+	if (c == NULL) {
+		geo_ip_lookup(ip, info);
+		return;
+	}
+
+	/* probe the networks of the prefix lengths in the cache, the longest first */
+	for (prefix = bits; prefix >= 0; prefix--) {
+		if (c->prefixes[fi][prefix] == 0)
+			continue;
+
+		mask_addr(net, addr, size, prefix);
+		e = find_entry(c, family, prefix, net, size);
+		if (e->used && e->family == family && e->prefix == (unsigned)prefix &&
+		    memcmp(e->net, net, size) == 0) {
+			strcpy(info->geoip_country, e->country);
+			strcpy(info->geoip_ccode, e->ccode);
+			strcpy(info->geoip_city, e->city);
+			strcpy(info->geoip_coord, e->coord);
+			stats.geoip_hits++;
+			return;
+		}
+	}
+
+	prefix = geo_ip_lookup(ip, info);
+	if (prefix < 0 || prefix > (int)bits)
+		return;
+
+	mask_addr(net, addr, size, prefix);
+	e = find_entry(c, family, prefix, net, size);
+	if (e->used)
+		c->prefixes[e->family == AF_INET6][e->prefix]--;
+
+	e->used = 1;
+	e->family = family;
+	e->prefix = prefix;
+	memcpy(e->net, net, size);
+	strcpy(e->country, info->geoip_country);
+	strcpy(e->ccode, info->geoip_ccode);
+	strcpy(e->city, info->geoip_city);
+	strcpy(e->coord, info->geoip_coord);
+	c->prefixes[fi][prefix]++;
+}
+
+#endif
@@ -28,6 +28,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <stdarg.h>
+#include <pthread.h>
 #include "ipcalc.h"
 
 #ifdef USE_GEOIP
@@ -49,6 +50,7 @@ typedef int (*GeoIP_id_by_ipnum_func)(GeoIP * gi, unsigned long ipnum);
 typedef int (*GeoIP_id_by_ipnum_v6_func)(GeoIP * gi, geoipv6_t ipnum);
 typedef GeoIPRecord *(*GeoIP_record_by_ipnum_v6_func)(GeoIP * gi, geoipv6_t ipnum);
 typedef const char *(*GeoIP_code_by_id_func)(int id);
+typedef void (*GeoIPRecord_delete_func)(GeoIPRecord * gir);
 
 static _GeoIP_setup_dbfilename_func p_GeoIP_setup_dbfilename;
 static GeoIP_open_type_func pGeoIP_open_type;
@@ -59,6 +61,7 @@ static GeoIP_record_by_ipnum_func pGeoIP_record_by_ipnum;
 static GeoIP_id_by_ipnum_func pGeoIP_id_by_ipnum;
 static GeoIP_id_by_ipnum_v6_func pGeoIP_id_by_ipnum_v6;
 static GeoIP_record_by_ipnum_v6_func pGeoIP_record_by_ipnum_v6;
+static GeoIPRecord_delete_func pGeoIPRecord_delete;
 
 #define LIBNAME LIBPATH"/libGeoIP.so.1"
 
@@ -92,11 +95,12 @@ int geo_setup(void)
 	pGeoIP_id_by_ipnum_v6 = dlsym(ld, "GeoIP_id_by_ipnum_v6");
 	pGeoIP_record_by_ipnum_v6 = dlsym(ld, "GeoIP_record_by_ipnum_v6");
 	pGeoIP_code_by_id = dlsym(ld, "GeoIP_code_by_id");
+	pGeoIPRecord_delete = dlsym(ld, "GeoIPRecord_delete");
 
 	if (pGeoIP_open_type == NULL || pGeoIP_country_name_by_id == NULL ||
 	    pGeoIP_delete == NULL || pGeoIP_record_by_ipnum == NULL ||
 	    pGeoIP_id_by_ipnum == NULL || pGeoIP_id_by_ipnum_v6 == NULL ||
-	    pGeoIP_record_by_ipnum_v6 == NULL) {
+	    pGeoIP_record_by_ipnum_v6 == NULL || pGeoIPRecord_delete == NULL) {
 		snprintf(err, sizeof(err), "ipcalc: could not find symbols in libGeoIP\n");
 	    	ret = -1;
 	    	goto exit;
@@ -119,148 +123,168 @@ extern void _GeoIP_setup_dbfilename(void);
 #  define pGeoIP_id_by_ipnum_v6 GeoIP_id_by_ipnum_v6
 #  define pGeoIP_record_by_ipnum_v6 GeoIP_record_by_ipnum_v6
 #  define pGeoIP_code_by_id GeoIP_code_by_id
+#  define pGeoIPRecord_delete GeoIPRecord_delete
 # endif
 
-static void geo_ipv4_lookup(struct in_addr ip, char **country, char **ccode, char **city, char **coord)
+/* The databases are opened on the first lookup, or by geo_init(), and
+ * kept open until geo_reload(); the handles are only read after that,
+ * so they are shared by the batch threads. */
+static struct {
+	GeoIP *country;
+	GeoIP *city;
+	GeoIP *country_v6;
+	GeoIP *city_v6;
+} geo_db;
+
+static GeoIP *geo_open(int type, int fallback_type)
 {
 	GeoIP *gi;
-	GeoIPRecord *gir;
-	int country_id;
-	const char *p;
 
-	if (geo_setup() != 0)
-		return;
+	gi = pGeoIP_open_type(type, GEOIP_MMAP_CACHE | GEOIP_SILENCE);
+	if (gi == NULL && fallback_type >= 0)
+		gi = pGeoIP_open_type(fallback_type, GEOIP_MMAP_CACHE | GEOIP_SILENCE);
+	if (gi != NULL)
+		gi->charset = GEOIP_CHARSET_UTF8;
 
-	ip.s_addr = ntohl(ip.s_addr);
+	return gi;
+}
 
+static void geo_open_databases_once(void)
+{
 	p_GeoIP_setup_dbfilename();
 
-	gi = pGeoIP_open_type(GEOIP_COUNTRY_EDITION, GEOIP_STANDARD | GEOIP_SILENCE);
-	if (gi != NULL) {
-		gi->charset = GEOIP_CHARSET_UTF8;
+	geo_db.country = geo_open(GEOIP_COUNTRY_EDITION, -1);
+	geo_db.city = geo_open(GEOIP_CITY_EDITION_REV1, GEOIP_CITY_EDITION_REV0);
+	geo_db.country_v6 = geo_open(GEOIP_COUNTRY_EDITION_V6, -1);
+	geo_db.city_v6 = geo_open(GEOIP_CITY_EDITION_REV1_V6, GEOIP_CITY_EDITION_REV0_V6);
+}
 
-		country_id = pGeoIP_id_by_ipnum(gi, ip.s_addr);
-		if (country_id < 0) {
-			return;
-		}
-		p = pGeoIP_country_name_by_id(gi, country_id);
-		if (p)
-			*country = safe_strdup(p);
+/*!
+  \fn int geo_init(void)
+  \brief opens the databases now rather than on the first lookup
+
+  \return 0 on success, or -1 if the library is not available.
+*/
+int geo_init(void)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
 
-		p = pGeoIP_code_by_id(country_id);
-		if (p)
-			*ccode = safe_strdup(p);
+	if (geo_setup() != 0)
+		return -1;
+
+	pthread_once(&once, geo_open_databases_once);
+	return 0;
+}
 
+static void geo_close(GeoIP *gi)
+{
+	if (gi != NULL)
 		pGeoIP_delete(gi);
-	}
+}
 
-	gi = pGeoIP_open_type(GEOIP_CITY_EDITION_REV1, GEOIP_STANDARD | GEOIP_SILENCE);
-	if (gi != NULL) {
-		gi->charset = GEOIP_CHARSET_UTF8;
+/*!
+  \fn void geo_reload(void)
+  \brief opens the databases again, so that updated files are used
 
-		gir = pGeoIP_record_by_ipnum(gi, ip.s_addr);
+  No lookup may be in progress while the databases are reopened.
+*/
+void geo_reload(void)
+{
+	if (geo_init() != 0)
+		return;
 
-		if (gir && gir->city)
-			*city = safe_strdup(gir->city);
+	geo_close(geo_db.country);
+	geo_close(geo_db.city);
+	geo_close(geo_db.country_v6);
+	geo_close(geo_db.city_v6);
 
-		if (gir && gir->longitude != 0 && gir->longitude != 0)
-			safe_asprintf(coord, "%f,%f", gir->latitude, gir->longitude);
+	geo_open_databases_once();
+	geo_cache_invalidate();
+}
 
-		pGeoIP_delete(gi);
-	} else {
-		gi = pGeoIP_open_type(GEOIP_CITY_EDITION_REV0, GEOIP_STANDARD | GEOIP_SILENCE);
-		if (gi != NULL) {
-			gi->charset = GEOIP_CHARSET_UTF8;
+static void geo_country(GeoIP *gi, int country_id, struct ip_info_st *info)
+{
+	const char *p;
 
-			gir = pGeoIP_record_by_ipnum(gi, ip.s_addr);
+	p = pGeoIP_country_name_by_id(gi, country_id);
+	if (p)
+		snprintf(info->geoip_country, sizeof(info->geoip_country), "%s", p);
 
-			if (gir && gir->city)
-				*city = safe_strdup(gir->city);
+	p = pGeoIP_code_by_id(country_id);
+	if (p)
+		snprintf(info->geoip_ccode, sizeof(info->geoip_ccode), "%s", p);
+}
 
-			if (gir && gir->longitude != 0 && gir->longitude != 0)
-				safe_asprintf(coord, "%f,%f", gir->latitude, gir->longitude);
+static void geo_city(GeoIPRecord *gir, struct ip_info_st *info)
+{
+	if (gir == NULL)
+		return;
 
-			pGeoIP_delete(gi);
-		}
-	}
+	if (gir->city)
+		snprintf(info->geoip_city, sizeof(info->geoip_city), "%s", gir->city);
 
-	return;
+	if (gir->latitude != 0 && gir->longitude != 0)
+		snprintf(info->geoip_coord, sizeof(info->geoip_coord), "%f,%f", gir->latitude, gir->longitude);
+
+	pGeoIPRecord_delete(gir);
 }
 
-static void geo_ipv6_lookup(struct in6_addr *ip, char **country, char **ccode, char **city, char **coord)
+static void geo_ipv4_lookup(struct in_addr ip, struct ip_info_st *info)
 {
-	GeoIP *gi;
-	GeoIPRecord *gir;
 	int country_id;
-	const char *p;
 
-	if (geo_setup() != 0)
+	if (geo_init() != 0)
 		return;
 
-	p_GeoIP_setup_dbfilename();
-
-	gi = pGeoIP_open_type(GEOIP_COUNTRY_EDITION_V6, GEOIP_STANDARD | GEOIP_SILENCE);
-	if (gi != NULL) {
-		gi->charset = GEOIP_CHARSET_UTF8;
+	ip.s_addr = ntohl(ip.s_addr);
 
-		country_id = pGeoIP_id_by_ipnum_v6(gi, (geoipv6_t)*ip);
+	if (geo_db.country != NULL) {
+		country_id = pGeoIP_id_by_ipnum(geo_db.country, ip.s_addr);
 		if (country_id < 0) {
 			return;
 		}
-		p = pGeoIP_country_name_by_id(gi, country_id);
-		if (p)
-			*country = safe_strdup(p);
-
-		p = pGeoIP_code_by_id(country_id);
-		if (p)
-			*ccode = safe_strdup(p);
-
-		pGeoIP_delete(gi);
+		geo_country(geo_db.country, country_id, info);
 	}
 
-	gi = pGeoIP_open_type(GEOIP_CITY_EDITION_REV1_V6, GEOIP_STANDARD | GEOIP_SILENCE);
-	if (gi != NULL) {
-		gi->charset = GEOIP_CHARSET_UTF8;
-
-		gir = pGeoIP_record_by_ipnum_v6(gi, (geoipv6_t)*ip);
-
-		if (gir && gir->city)
-			*city = safe_strdup(gir->city);
-
-		if (gir && gir->longitude != 0 && gir->longitude != 0)
-			safe_asprintf(coord, "%f,%f", gir->latitude, gir->longitude);
+	if (geo_db.city != NULL)
+		geo_city(pGeoIP_record_by_ipnum(geo_db.city, ip.s_addr), info);
 
-		pGeoIP_delete(gi);
-	} else {
-		gi = pGeoIP_open_type(GEOIP_CITY_EDITION_REV0_V6, GEOIP_STANDARD | GEOIP_SILENCE);
-		if (gi != NULL) {
-			gi->charset = GEOIP_CHARSET_UTF8;
-
-			gir = pGeoIP_record_by_ipnum_v6(gi, (geoipv6_t)*ip);
+	return;
+}
 
-			if (gir && gir->city)
-				*city = safe_strdup(gir->city);
+static void geo_ipv6_lookup(struct in6_addr *ip, struct ip_info_st *info)
+{
+	int country_id;
 
-			if (gir && gir->longitude != 0 && gir->longitude != 0)
-				safe_asprintf(coord, "%f,%f", gir->latitude, gir->longitude);
+	if (geo_init() != 0)
+		return;
 
-			pGeoIP_delete(gi);
+	if (geo_db.country_v6 != NULL) {
+		country_id = pGeoIP_id_by_ipnum_v6(geo_db.country_v6, (geoipv6_t)*ip);
+		if (country_id < 0) {
+			return;
 		}
+		geo_country(geo_db.country_v6, country_id, info);
 	}
 
+	if (geo_db.city_v6 != NULL)
+		geo_city(pGeoIP_record_by_ipnum_v6(geo_db.city_v6, (geoipv6_t)*ip), info);
+
 	return;
 }
 
-void geo_ip_lookup(const char *ip, char **country, char **ccode, char **city, char **coord)
+/* The legacy databases do not tell the network of a record, so the
+ * results are not cached */
+int geo_ip_lookup(const char *ip, struct ip_info_st *info)
 {
         struct in_addr ipv4;
         struct in6_addr ipv6;
         if (inet_pton(AF_INET, ip, &ipv4) == 1) {
-              geo_ipv4_lookup(ipv4, country, ccode, city, coord);
+              geo_ipv4_lookup(ipv4, info);
         } else if (inet_pton(AF_INET6, ip, &ipv6) == 1) {
-              geo_ipv6_lookup(&ipv6, country, ccode, city, coord);
+              geo_ipv6_lookup(&ipv6, info);
         }
-        return;
+        return -1;
 }
 
 #endif
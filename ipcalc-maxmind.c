@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <netinet/in.h>
+#include <pthread.h>
 
 #include "ipcalc.h"
 
@@ -108,61 +109,135 @@ int geo_setup(void)
 #define pMMDB_open          MMDB_open
 #endif
 
-void process_result_from_mmdb_lookup(MMDB_entry_data_s *entry_data, int status, char **output)
+void process_result_from_mmdb_lookup(MMDB_entry_data_s *entry_data, int status, char *output, unsigned output_size)
 {
     if (MMDB_SUCCESS == status) {
         if (entry_data->has_data) {
             if (entry_data->type == MMDB_DATA_TYPE_UTF8_STRING) {
-                *output = (char *) calloc(entry_data->data_size + 1, sizeof(char));
-                if (NULL != *output) {
-                    memcpy(*output, entry_data->utf8_string, entry_data->data_size);
-                } else {
-                    fprintf(stderr, "Memory allocation failure line %d\n", __LINE__);
-                }
+                unsigned size = entry_data->data_size;
+
+                /* Truncate the string if it does not fit */
+                if (size >= output_size)
+                    size = output_size - 1;
+                memcpy(output, entry_data->utf8_string, size);
+                output[size] = 0;
             }
         }
     }
     /* Else fail silently */
 }
 
-void geo_ip_lookup(const char *ip, char **country, char **ccode, char **city, char **coord)
+/* The databases are opened on the first lookup, or by geo_init(), and
+ * kept open until geo_reload(); MMDB_lookup_string() only reads the
+ * handles, so they are shared by the batch threads. */
+static struct {
+    int country_status;
+    int city_status;
+    MMDB_s country;
+    MMDB_s city;
+} geo_db;
+
+static void geo_open_databases_once(void)
+{
+    /* Open the system maxmind database with countries */
+    geo_db.country_status = pMMDB_open(MAXMINDDB_LOCATION_COUNTRY, MMDB_MODE_MMAP, &geo_db.country);
+    /* Open the system maxmind database with cities - which actually does not contain names of the cities */
+    geo_db.city_status = pMMDB_open(MAXMINDDB_LOCATION_CITY, MMDB_MODE_MMAP, &geo_db.city);
+}
+
+/*!
+  \fn int geo_init(void)
+  \brief opens the databases now rather than on the first lookup
+
+  \return 0 on success, or -1 if the library is not available.
+*/
+int geo_init(void)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+    if (geo_setup() != 0)
+        return -1;
+
+    pthread_once(&once, geo_open_databases_once);
+    return 0;
+}
+
+/*!
+  \fn void geo_reload(void)
+  \brief opens the databases again, so that updated files are used
+
+  No lookup may be in progress while the databases are reopened.
+*/
+void geo_reload(void)
+{
+    if (geo_init() != 0)
+        return;
+
+    if (MMDB_SUCCESS == geo_db.country_status)
+        pMMDB_close(&geo_db.country);
+    if (MMDB_SUCCESS == geo_db.city_status)
+        pMMDB_close(&geo_db.city);
+
+    geo_open_databases_once();
+    geo_cache_invalidate();
+}
+
+/* The prefix length of the network of a record; the netmask of an IPv4
+ * address in an IPv6 database counts the 96 bits of the IPv4 subtree */
+static int result_prefix(const char *ip, const MMDB_lookup_result_s *result)
+{
+    if (strchr(ip, ':') != NULL)
+        return result->netmask;
+    if (result->netmask >= 96)
+        return result->netmask - 96;
+    return result->netmask > 32 ? 0 : result->netmask;
+}
+
+/* Returns the prefix length of the network that has the same result as
+ * the address, or -1 if it is not known */
+int geo_ip_lookup(const char *ip, struct ip_info_st *info)
 {
-    MMDB_s mmdb;
     MMDB_entry_data_s entry_data;
     int gai_error, mmdb_error, status, coordinates=0;
+    int prefix = -1, failed = 0, p;
     double latitude = 0, longitude = 0;
 
-    if (geo_setup() != 0)
-        return;
+    if (geo_init() != 0)
+        return -1;
 
-    /* Open the system maxmind database with countries */
-    status = pMMDB_open(MAXMINDDB_LOCATION_COUNTRY, MMDB_MODE_MMAP, &mmdb);
-    if (MMDB_SUCCESS == status) {
+    if (MMDB_SUCCESS == geo_db.country_status) {
         /* Lookup IP address in the database */
-        MMDB_lookup_result_s result = pMMDB_lookup_string(&mmdb, ip, &gai_error, &mmdb_error);
+        MMDB_lookup_result_s result = pMMDB_lookup_string(&geo_db.country, ip, &gai_error, &mmdb_error);
+        if (gai_error != 0 || MMDB_SUCCESS != mmdb_error)
+            failed = 1;
         if (MMDB_SUCCESS == mmdb_error) { 
+            prefix = result_prefix(ip, &result);
             /* If the lookup was successfull and an entry was found */
             if (result.found_entry) {
                 memset(&entry_data, 0, sizeof(MMDB_entry_data_s));
                 /* Travel the path in the tree like structure of the MMDB and store the value if found */
                 status = pMMDB_get_value(&result.entry, &entry_data, "country", "names", "en", NULL);
-                process_result_from_mmdb_lookup(&entry_data, status, country);
+                process_result_from_mmdb_lookup(&entry_data, status, info->geoip_country, sizeof(info->geoip_country));
                 memset(&entry_data, 0, sizeof(MMDB_entry_data_s));
                 status = pMMDB_get_value(&result.entry, &entry_data, "country", "iso_code", NULL);
-                process_result_from_mmdb_lookup(&entry_data, status, ccode);
+                process_result_from_mmdb_lookup(&entry_data, status, info->geoip_ccode, sizeof(info->geoip_ccode));
             }
         }
         /* Else fail silently */
-        pMMDB_close(&mmdb);
     }
     /* Else fail silently */
 
-    /* Open the system maxmind database with cities - which actually does not contain names of the cities */
-    status = pMMDB_open(MAXMINDDB_LOCATION_CITY, MMDB_MODE_MMAP, &mmdb);
-    if (MMDB_SUCCESS == status) {
+    if (MMDB_SUCCESS == geo_db.city_status) {
         /* Lookup IP address in the database */
-        MMDB_lookup_result_s result = pMMDB_lookup_string(&mmdb, ip, &gai_error, &mmdb_error);
+        MMDB_lookup_result_s result = pMMDB_lookup_string(&geo_db.city, ip, &gai_error, &mmdb_error);
+        if (gai_error != 0 || MMDB_SUCCESS != mmdb_error)
+            failed = 1;
         if (MMDB_SUCCESS == mmdb_error) { 
+            /* the networks of both databases cover the address, so the
+             * longer one is within the other */
+            p = result_prefix(ip, &result);
+            if (p > prefix)
+                prefix = p;
             /* If the lookup was successfull and an entry was found */
             if (result.found_entry) {
                 memset(&entry_data, 0, sizeof(MMDB_entry_data_s));
@@ -188,14 +263,15 @@ void geo_ip_lookup(const char *ip, char **country, char **ccode, char **city, ch
                     }
                 }
                 if (coordinates == 2) {
-                    safe_asprintf(coord, "%f,%f", latitude, longitude);
+                    snprintf(info->geoip_coord, sizeof(info->geoip_coord), "%f,%f", latitude, longitude);
                 }
             }
         }
         /* Else fail silently */
-        pMMDB_close(&mmdb);
     }
     /* Else fail silently */
+
+    return failed ? -1 : prefix;
 }
 
 #endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Address parser for the batch input. It accepts the same dotted quads
+ * as inet_pton(), reads an optional prefix in the same pass, and expands
+ * the abbreviated forms such as 172.16/12 without copying the string.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ipcalc.h"
+
+#define DIGIT(c) ((unsigned)(unsigned char)(c) - '0')
+
+/*!
+  \fn const char *parse_ipv4(const char *str, uint32_t *addr, int *prefix, unsigned abbrev)
+  \brief parses an IPv4 address, optionally followed by a prefix
+
+  The address must be a dotted quad without leading zeros, as accepted by
+  inet_pton(). An abbreviated address with less than four octets, such as
+  172.16, is accepted when abbrev is set or when it is followed by a
+  prefix, and the missing octets are zero.
+
+  When prefix is not NULL a following /PREFIX is parsed as well, if it
+  is a decimal number of up to 32 without leading zeros; any other
+  prefix, such as a netmask, is left to the caller and the returned
+  pointer is at the '/'. The prefix is set to -1 when none was parsed.
+
+  \param str the string to parse.
+  \param addr where to store the address, in host byte order.
+  \param prefix where to store the prefix, or NULL to not parse it.
+  \param abbrev whether the abbreviated forms are always accepted.
+
+  \return a pointer to the first character after the parsed text, or
+  NULL if str does not start with an address.
+*/
+const char *parse_ipv4(const char *str, uint32_t *addr, int *prefix, unsigned abbrev)
+{
+	const char *p = str;
+	uint32_t a = 0;
+	unsigned octets = 0, v, d;
+
+	while (1) {
+		v = DIGIT(p[0]);
+		if (v > 9)
+			return NULL;
+		p++;
+
+		if ((d = DIGIT(p[0])) <= 9) {
+			if (v == 0)
+				return NULL;	/* leading zero */
+			v = v * 10 + d;
+			p++;
+
+			if ((d = DIGIT(p[0])) <= 9) {
+				v = v * 10 + d;
+				p++;
+				if (v > 255 || DIGIT(p[0]) <= 9)
+					return NULL;
+			}
+		}
+
+		a = (a << 8) | v;
+		if (++octets == 4 || p[0] != '.')
+			break;
+		p++;
+	}
+
+	if (prefix) {
+		*prefix = -1;
+
+		if (p[0] == '/' && (v = DIGIT(p[1])) <= 9) {
+			const char *q = p + 2;
+
+			if (v != 0 && (d = DIGIT(q[0])) <= 9) {
+				v = v * 10 + d;
+				q++;
+			}
+
+			if (v <= 32 && DIGIT(q[0]) > 9) {
+				*prefix = v;
+				p = q;
+			}
+		}
+	}
+
+	if (octets < 4) {
+		if (!abbrev && p[0] != '/' && (prefix == NULL || *prefix < 0))
+			return NULL;
+		a <<= 8 * (4 - octets);
+	}
+
+	*addr = a;
+	return p;
+}
@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Concurrent reverse DNS resolution. A pool of resolver threads runs
+ * the getnameinfo() queries, so that many of them can be in flight
+ * while the addresses are processed in order. The results are kept in a
+ * hash table, so that an address is only queried again once its result
+ * is older than the cache TTL. The completed queries form an LRU list,
+ * and the least recently used ones are dropped beyond RESOLVER_CACHE_SIZE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+
+#include "ipcalc.h"
+
+#define RESOLVER_BUCKETS 16384
+
+/* The completed queries kept */
+#define RESOLVER_CACHE_SIZE 65536
+
+enum {
+	QUERY_QUEUED,
+	QUERY_RUNNING,
+	QUERY_DONE,
+	QUERY_FAILED
+};
+
+struct query {
+	struct query *next;	/* in the hash bucket */
+	struct query *queue_next;
+	struct query *lru_prev, *lru_next;	/* once completed */
+	int family;
+	unsigned char addr[16];
+	unsigned state;
+	unsigned used;	/* the result was returned already */
+	unsigned waiters;	/* the callers waiting for the result */
+	int herr;	/* h_errno of the query, for herror() */
+	struct timespec deadline;	/* set once the query is running */
+	time_t expires;	/* set once the query is completed */
+	char *hostname;
+};
+
+static struct {
+	unsigned active;
+	unsigned timeout;
+	unsigned ttl;
+	pthread_mutex_t lock;
+	pthread_cond_t queued;	/* a query was added to the queue */
+	pthread_cond_t done;	/* a query was started or completed */
+	struct query *queue_head, *queue_tail;
+	struct query *lru_head, *lru_tail;	/* the most recently used first */
+	unsigned cached;	/* the number of queries in the LRU list */
+	struct query *buckets[RESOLVER_BUCKETS];
+} resolver = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.queued = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER
+};
+
+static unsigned addr_size(int family)
+{
+	return (family == AF_INET) ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+}
+
+/* FNV-1a */
+static unsigned addr_hash(int family, const void *addr)
+{
+	const unsigned char *p = addr;
+	uint32_t h = 2166136261U;
+	unsigned i;
+
+	for (i = 0; i < addr_size(family); i++) {
+		h ^= p[i];
+		h *= 16777619U;
+	}
+
+	return h % RESOLVER_BUCKETS;
+}
+
+/*!
+  \fn char *lookup_hostname(int family, const void *addr, char *hostname, unsigned hostname_size)
+  \brief returns the hostname associated with the specified IP address
+
+  This performs a blocking getnameinfo() query.
+
+  \param family the address family, either AF_INET or AF_INET6.
+  \param addr a pointer to a struct in_addr or a struct in6_addr.
+  \param hostname the buffer to store the hostname.
+  \param hostname_size the size of the buffer.
+
+  \return the hostname, or NULL if one cannot be determined.
+*/
+char *lookup_hostname(int family, const void *addr, char *hostname, unsigned hostname_size)
+{
+	int ret = -1;
+	struct sockaddr_in addr4;
+	struct sockaddr_in6 addr6;
+
+	if (family == AF_INET) {
+		memset(&addr4, 0, sizeof(addr4));
+		addr4.sin_family = AF_INET;
+		memcpy(&addr4.sin_addr, addr, sizeof(struct in_addr));
+		ret = getnameinfo((struct sockaddr*)&addr4, sizeof(addr4), hostname, hostname_size, NULL, 0, 0);
+	} else if (family == AF_INET6) {
+		memset(&addr6, 0, sizeof(addr6));
+		addr6.sin6_family = AF_INET6;
+		memcpy(&addr6.sin6_addr, addr, sizeof(struct in6_addr));
+		ret = getnameinfo((struct sockaddr*)&addr6, sizeof(addr6), hostname, hostname_size, NULL, 0, 0);
+	}
+
+	if (ret != 0)
+		return NULL;
+
+	return hostname;
+}
+
+static time_t now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+/* The LRU list functions must be called with the lock held */
+static void lru_remove(struct query *q)
+{
+	if (q->lru_prev)
+		q->lru_prev->lru_next = q->lru_next;
+	else
+		resolver.lru_head = q->lru_next;
+	if (q->lru_next)
+		q->lru_next->lru_prev = q->lru_prev;
+	else
+		resolver.lru_tail = q->lru_prev;
+	q->lru_prev = q->lru_next = NULL;
+	resolver.cached--;
+}
+
+static void lru_push(struct query *q)
+{
+	q->lru_prev = NULL;
+	q->lru_next = resolver.lru_head;
+	if (resolver.lru_head)
+		resolver.lru_head->lru_prev = q;
+	else
+		resolver.lru_tail = q;
+	resolver.lru_head = q;
+	resolver.cached++;
+}
+
+/* Drops the least recently used completed query that no caller still
+ * waits to read; returns 0 if there is none */
+static unsigned lru_evict(void)
+{
+	struct query *q, **p;
+
+	for (q = resolver.lru_tail; q != NULL && q->waiters; q = q->lru_prev)
+		;
+	if (q == NULL)
+		return 0;
+
+	lru_remove(q);
+	for (p = &resolver.buckets[addr_hash(q->family, q->addr)]; *p != q; p = &(*p)->next)
+		;
+	*p = q->next;
+
+	free(q->hostname);
+	free(q);
+	return 1;
+}
+
+/* Drops the least recently used queries beyond RESOLVER_CACHE_SIZE */
+static void lru_trim(void)
+{
+	while (resolver.cached > RESOLVER_CACHE_SIZE && lru_evict())
+		;
+}
+
+static void queue_push(struct query *q)
+{
+	q->state = QUERY_QUEUED;
+	q->queue_next = NULL;
+	if (resolver.queue_tail)
+		resolver.queue_tail->queue_next = q;
+	else
+		resolver.queue_head = q;
+	resolver.queue_tail = q;
+	pthread_cond_signal(&resolver.queued);
+}
+
+static void *resolver_thread(void *arg)
+{
+	struct query *q;
+	char hostname[NI_MAXHOST];
+	char *ret;
+
+	pthread_mutex_lock(&resolver.lock);
+	while (1) {
+		while (resolver.queue_head == NULL)
+			pthread_cond_wait(&resolver.queued, &resolver.lock);
+
+		q = resolver.queue_head;
+		resolver.queue_head = q->queue_next;
+		if (resolver.queue_head == NULL)
+			resolver.queue_tail = NULL;
+
+		q->state = QUERY_RUNNING;
+		clock_gettime(CLOCK_REALTIME, &q->deadline);
+		q->deadline.tv_sec += resolver.timeout;
+		pthread_cond_broadcast(&resolver.done);
+		pthread_mutex_unlock(&resolver.lock);
+
+		ret = lookup_hostname(q->family, q->addr, hostname, sizeof(hostname));
+
+		pthread_mutex_lock(&resolver.lock);
+		q->herr = h_errno;
+		free(q->hostname);
+		q->hostname = ret ? strdup(hostname) : NULL;
+		q->state = q->hostname ? QUERY_DONE : QUERY_FAILED;
+		q->expires = now_seconds() + resolver.ttl;
+
+		lru_push(q);
+		lru_trim();
+		pthread_cond_broadcast(&resolver.done);
+	}
+
+	return NULL;
+}
+
+/* Must be called with the lock held */
+static struct query *find_query(int family, const void *addr, unsigned create)
+{
+	unsigned h = addr_hash(family, addr);
+	struct query *q;
+
+	for (q = resolver.buckets[h]; q != NULL; q = q->next) {
+		if (q->family == family && memcmp(q->addr, addr, addr_size(family)) == 0)
+			break;
+	}
+
+	if (q != NULL) {
+		if (q->state != QUERY_DONE && q->state != QUERY_FAILED)
+			return q;
+
+		lru_remove(q);
+		if (q->expires > now_seconds()) {
+			lru_push(q);
+			return q;
+		}
+
+		/* the result is stale; query it again */
+		q->used = 0;
+		queue_push(q);
+		return q;
+	}
+
+	if (!create)
+		return NULL;
+
+	q = calloc(1, sizeof(*q));
+	if (q == NULL)
+		return NULL;
+
+	q->family = family;
+	memcpy(q->addr, addr, addr_size(family));
+
+	q->next = resolver.buckets[h];
+	resolver.buckets[h] = q;
+	queue_push(q);
+
+	return q;
+}
+
+/*!
+  \fn int resolver_init(unsigned queries, unsigned timeout, unsigned ttl)
+  \brief starts the resolver threads
+
+  After this call \ref resolver_get_hostname no longer blocks on a single
+  query; the queries run concurrently in the resolver threads.
+
+  \param queries the maximum number of queries in flight.
+  \param timeout the time in seconds to wait for every query, or zero
+  to wait until the resolver gives up.
+  \param ttl the time in seconds for which a result is reused.
+
+  \return 0 on success, or -1 on error.
+*/
+int resolver_init(unsigned queries, unsigned timeout, unsigned ttl)
+{
+	pthread_attr_t attr;
+	pthread_t thread;
+	unsigned i;
+
+	if (resolver.active)
+		return 0;
+
+	resolver.timeout = timeout;
+	resolver.ttl = ttl;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	for (i = 0; i < queries; i++) {
+		if (pthread_create(&thread, &attr, resolver_thread, NULL) != 0)
+			break;
+	}
+	pthread_attr_destroy(&attr);
+
+	if (i == 0) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: could not create thread\n");
+		return -1;
+	}
+
+	resolver.active = 1;
+	return 0;
+}
+
+/*!
+  \fn void resolver_submit(int family, const void *addr)
+  \brief queues a reverse lookup of the address if it was not requested already
+
+  \param family the address family, either AF_INET or AF_INET6.
+  \param addr a pointer to a struct in_addr or a struct in6_addr.
+*/
+void resolver_submit(int family, const void *addr)
+{
+	if (!resolver.active)
+		return;
+
+	pthread_mutex_lock(&resolver.lock);
+	find_query(family, addr, 1);
+	pthread_mutex_unlock(&resolver.lock);
+}
+
+/*!
+  \fn char *resolver_get_hostname(int family, const void *addr, char *hostname, unsigned hostname_size)
+  \brief returns the hostname associated with the specified IP address
+
+  If \ref resolver_init was called the result of the queued query is
+  used, waiting up to the configured timeout once it is running;
+  otherwise this is the same as \ref lookup_hostname.
+
+  \param family the address family, either AF_INET or AF_INET6.
+  \param addr a pointer to a struct in_addr or a struct in6_addr.
+  \param hostname the buffer to store the hostname.
+  \param hostname_size the size of the buffer.
+
+  \return the hostname, or NULL if one cannot be determined.
+*/
+char *resolver_get_hostname(int family, const void *addr, char *hostname, unsigned hostname_size)
+{
+	struct query *q;
+	char *ret = NULL;
+
+	if (!resolver.active)
+		return lookup_hostname(family, addr, hostname, hostname_size);
+
+	pthread_mutex_lock(&resolver.lock);
+	q = find_query(family, addr, 1);
+	if (q == NULL) {
+		pthread_mutex_unlock(&resolver.lock);
+		return NULL;
+	}
+
+	if (q->used)
+		stats.dns_hits++;
+	q->used = 1;
+
+	q->waiters++;
+	while (q->state == QUERY_QUEUED || q->state == QUERY_RUNNING) {
+		if (resolver.timeout == 0 || q->state == QUERY_QUEUED) {
+			pthread_cond_wait(&resolver.done, &resolver.lock);
+		} else if (pthread_cond_timedwait(&resolver.done, &resolver.lock, &q->deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+	q->waiters--;
+
+	if (q->state == QUERY_DONE && strlen(q->hostname) < hostname_size) {
+		strcpy(hostname, q->hostname);
+		ret = hostname;
+	} else {
+		h_errno = (q->state == QUERY_RUNNING) ? TRY_AGAIN : q->herr;
+	}
+
+	/* the queries kept while waited for may be dropped now */
+	lru_trim();
+	pthread_mutex_unlock(&resolver.lock);
+
+	return ret;
+}
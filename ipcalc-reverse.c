@@ -18,7 +18,6 @@
  *   Nikos Mavrogiannopoulos <nmav@redhat.com>
  */
 
-#define _GNU_SOURCE		/* asprintf */
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -34,9 +33,8 @@
  */
 #undef USE_RFC2317_STYLE
 
-char *calc_reverse_dns4(struct in_addr ip, unsigned prefix, struct in_addr network, struct in_addr broadcast)
+char *calc_reverse_dns4(char *str, unsigned str_size, struct in_addr ip, unsigned prefix, struct in_addr network, struct in_addr broadcast)
 {
-	char *str = NULL;
 	int ret = -1;
 
 	unsigned byte1 = (ntohl(ip.s_addr) >> 24) & 0xff;
@@ -46,45 +44,45 @@ char *calc_reverse_dns4(struct in_addr ip, unsigned prefix, struct in_addr netwo
 
 #ifdef USE_RFC2317_STYLE
 	if (prefix == 32) {
-		ret = asprintf(&str, "%u.%u.%u.%u.in-addr.arpa.", byte4, byte3, byte2, byte1);
+		ret = snprintf(str, str_size, "%u.%u.%u.%u.in-addr.arpa.", byte4, byte3, byte2, byte1);
 	} else if (prefix == 24) {
-		ret = asprintf(&str, "%u.%u.%u.in-addr.arpa.", byte3, byte2, byte1);
+		ret = snprintf(str, str_size, "%u.%u.%u.in-addr.arpa.", byte3, byte2, byte1);
 	} else if (prefix == 16) {
-		ret = asprintf(&str, "%u.%u.in-addr.arpa.", byte2, byte1);
+		ret = snprintf(str, str_size, "%u.%u.in-addr.arpa.", byte2, byte1);
 	} else if (prefix == 8) {
-		ret = asprintf(&str, "%u.in-addr.arpa.", byte1);
+		ret = snprintf(str, str_size, "%u.in-addr.arpa.", byte1);
 	} else if (prefix > 24) {
-		ret = asprintf(&str, "%u/%u.%u.%u.%u.in-addr.arpa.", byte4, prefix, byte3, byte2, byte1);
+		ret = snprintf(str, str_size, "%u/%u.%u.%u.%u.in-addr.arpa.", byte4, prefix, byte3, byte2, byte1);
 	} else if (prefix > 16) {
-		ret = asprintf(&str, "%u/%u.%u.%u.in-addr.arpa.", byte3, prefix, byte2, byte1);
+		ret = snprintf(str, str_size, "%u/%u.%u.%u.in-addr.arpa.", byte3, prefix, byte2, byte1);
 	} else if (prefix > 8) {
-		ret = asprintf(&str, "%u/%u.%u.in-addr.arpa.", byte2, prefix, byte1);
+		ret = snprintf(str, str_size, "%u/%u.%u.in-addr.arpa.", byte2, prefix, byte1);
 	}
 #else
 	if (prefix == 32) {
-		ret = asprintf(&str, "%u.%u.%u.%u.in-addr.arpa.", byte4, byte3, byte2, byte1);
+		ret = snprintf(str, str_size, "%u.%u.%u.%u.in-addr.arpa.", byte4, byte3, byte2, byte1);
 	} else if (prefix == 24) {
-		ret = asprintf(&str, "%u.%u.%u.in-addr.arpa.", byte3, byte2, byte1);
+		ret = snprintf(str, str_size, "%u.%u.%u.in-addr.arpa.", byte3, byte2, byte1);
 	} else if (prefix == 16) {
-		ret = asprintf(&str, "%u.%u.in-addr.arpa.", byte2, byte1);
+		ret = snprintf(str, str_size, "%u.%u.in-addr.arpa.", byte2, byte1);
 	} else if (prefix == 8) {
-		ret = asprintf(&str, "%u.in-addr.arpa.", byte1);
+		ret = snprintf(str, str_size, "%u.in-addr.arpa.", byte1);
 	} else if (prefix > 24) {
 		unsigned min = (ntohl(network.s_addr)) & 0xff;
 		unsigned max = (ntohl(broadcast.s_addr)) & 0xff;
-		ret = asprintf(&str, "%u-%u.%u.%u.%u.in-addr.arpa.", min, max, byte3, byte2, byte1);
+		ret = snprintf(str, str_size, "%u-%u.%u.%u.%u.in-addr.arpa.", min, max, byte3, byte2, byte1);
 	} else if (prefix > 16) {
 		unsigned min = (ntohl(network.s_addr) >> 8) & 0xff;
 		unsigned max = (ntohl(broadcast.s_addr) >> 8) & 0xff;
-		ret = asprintf(&str, "%u-%u.%u.%u.in-addr.arpa.", min, max, byte2, byte1);
+		ret = snprintf(str, str_size, "%u-%u.%u.%u.in-addr.arpa.", min, max, byte2, byte1);
 	} else if (prefix > 8) {
 		unsigned min = (ntohl(network.s_addr) >> 16) & 0xff;
 		unsigned max = (ntohl(broadcast.s_addr) >> 16) & 0xff;
-		ret = asprintf(&str, "%u-%u.%u.in-addr.arpa.", min, max, byte1);
+		ret = snprintf(str, str_size, "%u-%u.%u.in-addr.arpa.", min, max, byte1);
 	}
 #endif
 
-	if (ret == -1)
+	if (ret < 0 || ret >= str_size)
 	    return NULL;
 	return str;
 }
@@ -98,13 +96,13 @@ static char hexchar(unsigned int val)
 	abort();
 }
 
-char *calc_reverse_dns6(struct in6_addr *ip, unsigned prefix)
+char *calc_reverse_dns6(char *str, unsigned str_size, struct in6_addr *ip, unsigned prefix)
 {
 	unsigned i, j = 0;
-	char str[256];
 	unsigned max = prefix/8;
 
-	if (prefix % 4 != 0)
+	/* each nibble takes two characters */
+	if (prefix % 4 != 0 || (prefix / 4) * 2 + sizeof("ip6.arpa.") > str_size)
 		return NULL;
 
 	if (prefix % 8 == 4) {
@@ -123,5 +121,5 @@ char *calc_reverse_dns6(struct in6_addr *ip, unsigned prefix)
 
 	strcpy(&str[j], "ip6.arpa.");
 
-	return strdup(str);
+	return str;
 }
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The counters and phase timings of --stats. Every thread counts into
+ * its own copy of the counters, which it adds to the totals once with
+ * stats_merge(); the totals are printed when the program exits.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "ipcalc.h"
+
+unsigned stats_enabled = 0;
+__thread struct stats_st stats;
+
+static struct stats_st stats_total;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned stats_flags;
+
+static const struct {
+	const char *title;
+	const char *jsontitle;
+} stats_phases[STATS_PHASES] = {
+	[STATS_PARSE] = {"Parse time:\t", "PARSETIME"},
+	[STATS_COMPUTE] = {"Compute time:\t", "COMPUTETIME"},
+	[STATS_DNS] = {"DNS time:\t", "DNSTIME"},
+	[STATS_GEOIP] = {"GeoIP time:\t", "GEOIPTIME"},
+	[STATS_OUTPUT] = {"Output time:\t", "OUTPUTTIME"},
+	[STATS_WRITE] = {"Write time:\t", "WRITETIME"}
+};
+
+uint64_t stats_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*!
+  \fn void stats_merge(void)
+  \brief adds the counters of the calling thread to the totals and resets them
+*/
+void stats_merge(void)
+{
+	unsigned i;
+
+	if (!stats_enabled)
+		return;
+
+	pthread_mutex_lock(&stats_lock);
+	stats_total.records += stats.records;
+	stats_total.failures += stats.failures;
+	stats_total.networks += stats.networks;
+	stats_total.dns_lookups += stats.dns_lookups;
+	stats_total.dns_hits += stats.dns_hits;
+	stats_total.geoip_lookups += stats.geoip_lookups;
+	stats_total.geoip_hits += stats.geoip_hits;
+	for (i = 0; i < STATS_PHASES; i++)
+		stats_total.time[i] += stats.time[i];
+	pthread_mutex_unlock(&stats_lock);
+
+	memset(&stats, 0, sizeof(stats));
+}
+
+static double percent(uint64_t part, uint64_t total)
+{
+	return total ? 100.0 * part / total : 0;
+}
+
+static void stats_show(void)
+{
+	const struct stats_st *s = &stats_total;
+	struct rusage usage;
+	unsigned jsonchain, i;
+	long rss = 0;
+
+	/* in text mode the output is written out first, so that the write
+	 * time covers all of it */
+	if (!(stats_flags & FLAG_JSON))
+		output_flush();
+	stats_merge();
+
+	/* in kilobytes on Linux */
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		rss = usage.ru_maxrss;
+
+	if (stats_flags & FLAG_JSON) {
+		output_start(&jsonchain);
+		json_printf(&jsonchain, "RECORDS", "%" PRIu64, s->records);
+		json_printf(&jsonchain, "PARSEFAILURES", "%" PRIu64, s->failures);
+		json_printf(&jsonchain, "NETWORKS", "%" PRIu64, s->networks);
+		for (i = 0; i < STATS_PHASES; i++)
+			json_printf(&jsonchain, stats_phases[i].jsontitle, "%.6f", s->time[i] / 1e9);
+		json_printf(&jsonchain, "DNSLOOKUPS", "%" PRIu64, s->dns_lookups);
+		json_printf(&jsonchain, "DNSCACHEHITS", "%" PRIu64, s->dns_hits);
+		json_printf(&jsonchain, "GEOIPLOOKUPS", "%" PRIu64, s->geoip_lookups);
+		json_printf(&jsonchain, "GEOIPCACHEHITS", "%" PRIu64, s->geoip_hits);
+		json_printf(&jsonchain, "PEAKRSS", "%ld", rss);
+		output_stop(&jsonchain);
+		return;
+	}
+
+	fprintf(stderr, "Records:\t%" PRIu64 "\n", s->records);
+	fprintf(stderr, "Parse failures:\t%" PRIu64 "\n", s->failures);
+	fprintf(stderr, "Networks:\t%" PRIu64 "\n", s->networks);
+	for (i = 0; i < STATS_PHASES; i++)
+		fprintf(stderr, "%s%.6f s\n", stats_phases[i].title, s->time[i] / 1e9);
+	fprintf(stderr, "DNS lookups:\t%" PRIu64 " (%" PRIu64 " cached, %.1f%%)\n",
+		s->dns_lookups, s->dns_hits, percent(s->dns_hits, s->dns_lookups));
+	fprintf(stderr, "GeoIP lookups:\t%" PRIu64 " (%" PRIu64 " cached, %.1f%%)\n",
+		s->geoip_lookups, s->geoip_hits, percent(s->geoip_hits, s->geoip_lookups));
+	fprintf(stderr, "Peak RSS:\t%ld kB\n", rss);
+}
+
+/*!
+  \fn void stats_init(unsigned flags)
+  \brief starts counting, and prints the statistics when the program exits
+
+  The statistics are printed to standard error, or in JSON output as an
+  additional last object of the output.
+
+  \param flags the output flags.
+*/
+void stats_init(unsigned flags)
+{
+	stats_flags = flags;
+	stats_enabled = 1;
+	atexit(stats_show);
+}
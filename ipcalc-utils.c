@@ -23,6 +23,11 @@
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <ctype.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "ipcalc.h"
 
 int __attribute__((__format__(printf, 2, 3))) safe_asprintf(char **strp, const char *fmt, ...)
 {
@@ -57,6 +62,37 @@ int safe_atoi(const char *s, int *ret_i)
 	return 0;
 }
 
+/*!
+  \fn int safe_atou64(const char *s, uint64_t *ret)
+  \brief converts a string to an unsigned 64-bit number
+
+  Unlike strtoull(3) a negative number is rejected.
+
+  \param s the string, in decimal or in hexadecimal with a 0x prefix.
+  \param ret where to store the number.
+
+  \return 0 on success, or a negative error code.
+*/
+int safe_atou64(const char *s, uint64_t *ret)
+{
+	char *x = NULL;
+	unsigned long long l;
+
+	while (isspace((unsigned char)*s))
+		s++;
+	if (*s == '-')
+		return -EINVAL;
+
+	errno = 0;
+	l = strtoull(s, &x, 0);
+
+	if (!x || x == s || *x || errno)
+		return errno > 0 ? -errno : -EINVAL;
+
+	*ret = l;
+	return 0;
+}
+
 /*!
   \fn char safe_strdup(const char *s)
   \brief strdup(3) that checks memory allocation or fail
@@ -81,3 +117,122 @@ extern char __attribute__((warn_unused_result)) *safe_strdup(const char *str)
 	}
 	return ret;
 }
+
+/*!
+  \fn void *safe_realloc(void *p, size_t size)
+  \brief realloc(3) that checks memory allocation or fail
+
+  This function does the same as realloc(3) with additional memory allocation
+  check; with a NULL p it allocates as malloc(3).  When check fails the
+  function will cause program to exit.
+
+  \param p the memory to resize, or NULL
+  \param size the new size
+  \return the resized memory
+*/
+void __attribute__((warn_unused_result)) *safe_realloc(void *p, size_t size)
+{
+	p = realloc(p, size);
+	if (p == NULL) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: memory error\n");
+		exit(1);
+	}
+	return p;
+}
+
+/* Removes leading and trailing whitespace, modifying str in place */
+char *trim(char *str)
+{
+	int len, i;
+	char *out;
+
+	len = strlen(str);
+	for (i=len-1;i>=0;i--) {
+		if (isspace(str[i]))
+			str[i] = 0;
+		else
+			break;
+	}
+
+	out = str;
+	for (i=0;i<len;i++) {
+		if (isspace(str[i]))
+			out++;
+		else
+			break;
+	}
+
+	return out;
+}
+
+/*!
+  \fn const char *json_escape(char *buf, unsigned buf_size, const char *str)
+  \brief copies str to buf, escaping the characters that cannot be part of a JSON string
+
+  The output is truncated if buf is too small.
+
+  \param buf the output buffer.
+  \param buf_size the size of the buffer.
+  \param str the string to escape.
+
+  \return buf.
+*/
+const char *json_escape(char *buf, unsigned buf_size, const char *str)
+{
+	unsigned i = 0;
+
+	for (; *str && i + 7 < buf_size; str++) {
+		unsigned char c = *str;
+
+		if (c == '"' || c == '\\') {
+			buf[i++] = '\\';
+			buf[i++] = c;
+		} else if (c < 0x20) {
+			i += snprintf(&buf[i], buf_size - i, "\\u%.4x", c);
+		} else {
+			buf[i++] = c;
+		}
+	}
+	buf[i] = 0;
+
+	return buf;
+}
+
+/*!
+  \fn int parse_network(const char *str, unsigned flags, void *addr, unsigned *prefix)
+  \brief parses a network in the ADDRESS[/PREFIX] form
+
+  The address is IPv6 when FLAG_IPV6 is set, or when it contains a ':'
+  and FLAG_IPV4 is not set. The prefix may also be given as a netmask,
+  and it is the full length of the address when omitted. An IPv4 address
+  followed by a prefix may be abbreviated, as in 172.16/12. The host bits
+  of the address are kept. See ipcalc_parse_net().
+
+  \param str the network.
+  \param flags the flags to use.
+  \param addr where to store the address, a struct in_addr or a struct in6_addr.
+  \param prefix where to store the prefix.
+
+  \return AF_INET or AF_INET6, or -1 on error.
+*/
+int parse_network(const char *str, unsigned flags, void *addr, unsigned *prefix)
+{
+	ipcalc_opts_st opts = { 0 };
+	ipcalc_net_st net;
+
+	if (flags & FLAG_IPV6)
+		opts.flags |= IPCALC_OPT_IPV6;
+	if (flags & FLAG_IPV4)
+		opts.flags |= IPCALC_OPT_IPV4;
+
+	if (ipcalc_parse_net(str, &opts, &net) < 0)
+		return -1;
+
+	if (net.family == AF_INET6)
+		memcpy(addr, &net.addr.v6, sizeof(net.addr.v6));
+	else
+		memcpy(addr, &net.addr.v4, sizeof(net.addr.v4));
+	*prefix = net.prefix;
+	return net.family;
+}
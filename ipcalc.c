@@ -30,16 +30,20 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/stat.h>		/* open */
-#include <fcntl.h>		/* open */
 #include <unistd.h>		/* read */
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
-#include <time.h>		/* clock_gettime */
 #include "ipcalc.h"
 
 int beSilent = 0;
 static unsigned colors = 0;
+
+/* The buffer the output functions print to; NULL means the standard
+ * output buffer. It is per thread so that the batch workers can print
+ * their records into separate buffers. */
+static __thread struct output_buf *output_cur = NULL;
+static struct output_buf output_stdout;
 static unsigned flags = 0;
 
 /*!
@@ -51,7 +55,7 @@ static unsigned flags = 0;
   address/netmask/network address/prefix/etc.
 
   Functionality can be accessed from other languages from the library
-  interface, documented here.  To use ipcalc from the shell, read the
+  interface, libipcalc, declared in libipcalc.h.  To use ipcalc from the shell, read the
   ipcalc(1) manual page.
 
   When passing parameters to the various functions, take note of whether they
@@ -59,138 +63,74 @@ static unsigned flags = 0;
   return host byte order, but there are some exceptions.
 */
 
-/*!
-  \fn uint32_t prefix2mask(int bits)
-  \brief creates a netmask from a specified number of bits
-
-  This function converts a prefix length to a netmask.  As CIDR (classless
-  internet domain internet domain routing) has taken off, more an more IP
-  addresses are being specified in the format address/prefix
-  (i.e. 192.168.2.3/24, with a corresponding netmask 255.255.255.0).  If you
-  need to see what netmask corresponds to the prefix part of the address, this
-  is the function.  See also \ref mask2prefix.
-
-  \param prefix is the number of bits to create a mask for.
-  \return a network mask, in network byte order.
-*/
-uint32_t prefix2mask(int prefix)
-{
-	struct in_addr mask;
-	memset(&mask, 0, sizeof(mask));
-	if (prefix) {
-		return htonl(~((1 << (32 - prefix)) - 1));
-	} else {
-		return htonl(0);
-	}
-}
-
-/*!
-  \fn struct in_addr calc_broadcast(struct in_addr addr, int prefix)
-
-  \brief calculate broadcast address given an IP address and a prefix length.
-
-  \param addr an IP address in network byte order.
-  \param prefix a prefix length.
-
-  \return the calculated broadcast address for the network, in network byte
-  order.
-*/
-static struct in_addr calc_broadcast(struct in_addr addr, int prefix)
-{
-	struct in_addr mask;
-	struct in_addr broadcast;
-
-	mask.s_addr = prefix2mask(prefix);
-
-	memset(&broadcast, 0, sizeof(broadcast));
-
-	/* Follow RFC3021 and set the limited broadcast address on /31 */
-	if (prefix == 31)
-		broadcast.s_addr = htonl(0xFFFFFFFF);
-	else
-		broadcast.s_addr = (addr.s_addr & mask.s_addr) | ~mask.s_addr;
-
-	return broadcast;
-}
-
-/*!
-  \fn struct in_addr calc_network(struct in_addr addr, int prefix)
-  \brief calculates the network address for a specified address and prefix.
-
-  \param addr an IP address, in network byte order
-  \param prefix the network prefix
-  \return the base address of the network that addr is associated with, in
-  network byte order.
-*/
-struct in_addr calc_network(struct in_addr addr, int prefix)
+#ifdef HAVE_GETADDRINFO_A
+/* Runs getaddrinfo() asynchronously, giving up after timeout seconds. On
+ * timeout the request cannot be released as it may still be in use. */
+static int getaddrinfo_timeout(const char *host, const struct addrinfo *hints,
+			       struct addrinfo **res, unsigned timeout)
 {
-	struct in_addr mask;
-	struct in_addr network;
-
-	mask.s_addr = prefix2mask(prefix);
-
-	memset(&network, 0, sizeof(network));
-	network.s_addr = addr.s_addr & mask.s_addr;
-	return network;
-}
+	struct gaicb *req, *reqs[1];
+	struct timespec ts = { timeout, 0 };
+	int err;
 
-/*!
-  \fn const char *get_hostname(int family, void *addr)
-  \brief returns the hostname associated with the specified IP address
+	req = calloc(1, sizeof(*req));
+	if (req == NULL)
+		return EAI_MEMORY;
 
-  \param family the address family, either AF_INET or AF_INET6.
-  \param addr an IP address to find a hostname for, in network byte order,
-  should either be a pointer to a struct in_addr or a struct in6_addr.
+	req->ar_name = host;
+	req->ar_request = hints;
+	reqs[0] = req;
 
-  \return a hostname, or NULL if one cannot be determined.  Hostname is stored
-  in an allocated buffer.
-*/
-static char *get_hostname(int family, void *addr)
-{
-	static char hostname[NI_MAXHOST];
-	int ret = -1;
-	struct sockaddr_in addr4;
-	struct sockaddr_in6 addr6;
-
-	if (family == AF_INET) {
-		memset(&addr4, 0, sizeof(addr4));
-		addr4.sin_family = AF_INET;
-		memcpy(&addr4.sin_addr, addr, sizeof(struct in_addr));
-		ret = getnameinfo((struct sockaddr*)&addr4, sizeof(addr4), hostname, sizeof(hostname), NULL, 0, 0);
-	} else if (family == AF_INET6) {
-		memset(&addr6, 0, sizeof(addr6));
-		addr6.sin6_family = AF_INET6;
-		memcpy(&addr6.sin6_addr, addr, sizeof(struct in6_addr));
-		ret = getnameinfo((struct sockaddr*)&addr6, sizeof(addr6), hostname, sizeof(hostname), NULL, 0, 0);
+	err = getaddrinfo_a(GAI_NOWAIT, reqs, 1, NULL);
+	if (err != 0) {
+		free(req);
+		return err;
 	}
 
-	if (ret != 0)
-		return NULL;
+	while ((err = gai_error(req)) == EAI_INPROGRESS) {
+		if (gai_suspend((const struct gaicb * const *)reqs, 1, &ts) == EAI_AGAIN) {
+			if (gai_cancel(req) != EAI_CANCELED)
+				return EAI_AGAIN;
+			err = EAI_AGAIN;
+			break;
+		}
+	}
 
-	return safe_strdup(hostname);
+	*res = req->ar_result;
+	free(req);
+	return err;
 }
+#endif
 
 /*!
-  \fn const char *get_ip_address(int family, void *addr)
+  \fn const char *get_ip_address(int family, const char *host, unsigned timeout)
   \brief returns the IP address associated with the specified hostname
 
   \param family the requested address family or AF_UNSPEC for any
   \param host a hostname
+  \param timeout the time in seconds to wait for the answer, or zero to
+  wait until the resolver gives up. It is only effective when built with
+  getaddrinfo_a().
 
   \return an IP address, or NULL if one cannot be determined.  The IP is stored
   in an allocated buffer.
 */
-static char *get_ip_address(int family, const char *host)
+static char *get_ip_address(int family, const char *host, unsigned timeout)
 {
 	struct addrinfo *res, *rp;
 	struct addrinfo hints;
 	int err;
-	static char ipname[64];
+	char ipname[64];
 	void *addr;
 
 	memset(&hints, 0, sizeof(hints));
 	hints.ai_family = family;
 
+#ifdef HAVE_GETADDRINFO_A
+	if (timeout > 0)
+		err = getaddrinfo_timeout(host, &hints, &res, timeout);
+	else
+#endif
 	err = getaddrinfo(host, NULL, &hints, &res);
 	if (err != 0)
 		return NULL;
@@ -211,367 +151,17 @@ static char *get_ip_address(int family, const char *host)
 	return NULL;
 }
 
-static int bit_count(uint32_t i)
-{
-	int c = 0;
-
-	while (i > 0) {
-		if (i & 1)
-			c++;
-		i >>= 1;
-	}
-
-	return c;
-}
-
-/*!
-  \fn int mask2prefix(struct in_addr mask)
-  \brief calculates the number of bits masked off by a netmask.
-
-  This function calculates the significant bits in an IP address as specified by
-  a netmask.  See also \ref prefix2mask.
-
-  \param mask is the netmask, specified as an struct in_addr in network byte order.
-  \return the number of significant bits.  */
-static int mask2prefix(struct in_addr mask)
-{
-	int c = 0;
-	unsigned int seen_one = 0;
-	uint32_t i = ntohl(mask.s_addr);
-
-	while (i > 0) {
-		if (i & 1) {
-			seen_one = 1;
-			c++;
-		} else {
-			if (seen_one) {
-				return -1;
-			}
-		}
-		i >>= 1;
-	}
-
-	return c;
-}
-
-static
-int ipv4_mask_to_int(const char *prefix)
-{
-	int ret;
-	struct in_addr in;
-
-	ret = inet_pton(AF_INET, prefix, &in);
-	if (ret == 0)
-		return -1;
-
-	return mask2prefix(in);
-}
-
-/* Returns powers of two in textual format */
-static const char *p2_table(unsigned pow)
-{
-	static const char *pow2[] = {
-		"1",
-		"2",
-		"4",
-		"8",
-		"16",
-		"32",
-		"64",
-		"128",
-		"256",
-		"512",
-		"1024",
-		"2048",
-		"4096",
-		"8192",
-		"16384",
-		"32768",
-		"65536",
-		"131072",
-		"262144",
-		"524288",
-		"1048576",
-		"2097152",
-		"4194304",
-		"8388608",
-		"16777216",
-		"33554432",
-		"67108864",
-		"134217728",
-		"268435456",
-		"536870912",
-		"1073741824",
-		"2147483648",
-		"4294967296",
-		"8589934592",
-		"17179869184",
-		"34359738368",
-		"68719476736",
-		"137438953472",
-		"274877906944",
-		"549755813888",
-		"1099511627776",
-		"2199023255552",
-		"4398046511104",
-		"8796093022208",
-		"17592186044416",
-		"35184372088832",
-		"70368744177664",
-		"140737488355328",
-		"281474976710656",
-		"562949953421312",
-		"1125899906842624",
-		"2251799813685248",
-		"4503599627370496",
-		"9007199254740992",
-		"18014398509481984",
-		"36028797018963968",
-		"72057594037927936",
-		"144115188075855872",
-		"288230376151711744",
-		"576460752303423488",
-		"1152921504606846976",
-		"2305843009213693952",
-		"4611686018427387904",
-		"9223372036854775808",
-		"18446744073709551616",
-		"36893488147419103232",
-		"73786976294838206464",
-		"147573952589676412928",
-		"295147905179352825856",
-		"590295810358705651712",
-		"1180591620717411303424",
-		"2361183241434822606848",
-		"4722366482869645213696",
-		"9444732965739290427392",
-		"18889465931478580854784",
-		"37778931862957161709568",
-		"75557863725914323419136",
-		"151115727451828646838272",
-		"302231454903657293676544",
-		"604462909807314587353088",
-		"1208925819614629174706176",
-		"2417851639229258349412352",
-		"4835703278458516698824704",
-		"9671406556917033397649408",
-		"19342813113834066795298816",
-		"38685626227668133590597632",
-		"77371252455336267181195264",
-		"154742504910672534362390528",
-		"309485009821345068724781056",
-		"618970019642690137449562112",
-		"1237940039285380274899124224",
-		"2475880078570760549798248448",
-		"4951760157141521099596496896",
-		"9903520314283042199192993792",
-		"19807040628566084398385987584",
-		"39614081257132168796771975168",
-		"79228162514264337593543950336",
-		"158456325028528675187087900672",
-		"316912650057057350374175801344",
-		"633825300114114700748351602688",
-		"1267650600228229401496703205376",
-		"2535301200456458802993406410752",
-		"5070602400912917605986812821504",
-		"10141204801825835211973625643008",
-		"20282409603651670423947251286016",
-		"40564819207303340847894502572032",
-		"81129638414606681695789005144064",
-		"162259276829213363391578010288128",
-		"324518553658426726783156020576256",
-		"649037107316853453566312041152512",
-		"1298074214633706907132624082305024",
-		"2596148429267413814265248164610048",
-		"5192296858534827628530496329220096",
-		"10384593717069655257060992658440192",
-		"20769187434139310514121985316880384",
-		"41538374868278621028243970633760768",
-		"83076749736557242056487941267521536",
-		"166153499473114484112975882535043072",
-		"332306998946228968225951765070086144",
-		"664613997892457936451903530140172288",
-		"1329227995784915872903807060280344576",
-		"2658455991569831745807614120560689152",
-		"5316911983139663491615228241121378304",
-		"10633823966279326983230456482242756608",
-		"21267647932558653966460912964485513216",
-		"42535295865117307932921825928971026432",
-		"85070591730234615865843651857942052864",
-		"170141183460469231731687303715884105728",
-	};
-	if (pow <= 127)
-		return pow2[pow];
-	return "";
-}
-
-static const char *ipv4_net_to_type(struct in_addr net)
-{
-	unsigned byte1 = (ntohl(net.s_addr) >> 24) & 0xff;
-	unsigned byte2 = (ntohl(net.s_addr) >> 16) & 0xff;
-	unsigned byte3 = (ntohl(net.s_addr) >> 8) & 0xff;
-	unsigned byte4 = (ntohl(net.s_addr)) & 0xff;
-
-	/* based on IANA's iana-ipv4-special-registry and ipv4-address-space
-	 * Updated: 2020-04-06
-	 */
-	if (byte1 == 0) {
-		return "This host on this network";
-	}
-
-	if (byte1 == 10) {
-		return "Private Use";
-	}
-
-	if (byte1 == 100 && (byte2 & 0xc0) == 64) {
-		return "Shared Address Space";
-	}
-
-	if (byte1 == 127) {
-		return "Loopback";
-	}
-
-	if (byte1 == 169 && byte2 == 254) {
-		return "Link Local";
-	}
-
-	if (byte1 == 172 && (byte2 & 0xf0) == 16) {
-		return "Private Use";
-	}
-
-	if (byte1 == 192 && byte2 == 0 && byte3 == 0 && byte4 <= 7) {
-		return "IPv4 Service Continuity Prefix";
-	}
-
-	if (byte1 == 192 && byte2 == 0 && byte3 == 0 && byte4 == 8) {
-		return "IPv4 dummy address";
-	}
-
-	if (byte1 == 192 && byte2 == 0 && byte3 == 0 && byte4 == 9) {
-		return "Port Control Protocol Anycast";
-	}
-
-	if (byte1 == 192 && byte2 == 0 && byte3 == 0 && byte4 == 10) {
-		return "Traversal Using Relays around NAT Anycast";
-	}
-
-	if (byte1 == 192 && byte2 == 0 && byte3 == 0 && (byte4 == 170 || byte4 == 171)) {
-		return "NAT64/DNS64 Discovery";
-	}
-
-	if (byte1 == 192 && byte2 == 0 && byte3 == 0) {
-		return "IETF Protocol Assignments";
-	}
-
-	if (byte1 == 192 && byte2 == 0 && byte3 == 2) {
-		return "Documentation (TEST-NET-1)";
-	}
-
-	if (byte1 == 198 && byte2 == 51 && byte3 == 100) {
-		return "Documentation (TEST-NET-2)";
-	}
-
-	if (byte1 == 203 && byte2 == 0 && byte3 == 113) {
-		return "Documentation (TEST-NET-3)";
-	}
-
-	if (byte1 == 192 && byte2 == 88 && byte3 == 99) {
-		return "6 to 4 Relay Anycast (Deprecated)";
-	}
-
-	if (byte1 == 192 && byte2 == 31 && byte3 == 196) {
-		return "AS112-v4";
-	}
-
-	if (byte1 == 192 && byte2 == 52 && byte3 == 193) {
-		return "AMT";
-	}
-
-	if (byte1 == 192 && byte2 == 168) {
-		return "Private Use";
-	}
-
-	if (byte1 == 192 && byte2 == 175 && byte3 == 48) {
-		return "Direct Delegation AS112 Service";
-	}
-
-	if (byte1 == 255 && byte2 == 255 && byte3 == 255 && byte4 == 255) {
-		return "Limited Broadcast";
-	}
-
-	if (byte1 == 198 && (byte2 & 0xfe) == 18) {
-		return "Benchmarking";
-	}
-
-	if (byte1 >= 224 && byte1 <= 239) {
-		return "Multicast";
-	}
-
-	if ((byte1 & 0xf0) == 240) {
-		return "Reserved";
-	}
-
-	return "Internet";
-}
-
-static
-const char *ipv4_net_to_class(struct in_addr net)
-{
-	unsigned byte1 = (ntohl(net.s_addr) >> 24) & 0xff;
-
-	if (byte1 < 128) {
-		return "Class A";
-	}
-
-	if (byte1 >= 128 && byte1 < 192) {
-		return "Class B";
-	}
-
-	if (byte1 >= 192 && byte1 < 224) {
-		return "Class C";
-	}
-
-	if (byte1 >= 224 && byte1 < 239) {
-		return "Class D";
-	}
-
-	return "Class E";
-}
-
-static
-unsigned default_ipv4_prefix(struct in_addr net)
-{
-	unsigned byte1 = (ntohl(net.s_addr) >> 24) & 0xff;
-
-	if (byte1 < 128) {
-		return 8;
-	}
-
-	if (byte1 >= 128 && byte1 < 192) {
-		return 16;
-	}
-
-	if (byte1 >= 192 && byte1 < 224) {
-		return 24;
-	}
-
-	return 24;
-}
-
 char *ipv4_prefix_to_hosts(char *hosts, unsigned hosts_size, unsigned prefix)
 {
-	if (prefix >= 31) {
-		snprintf(hosts, hosts_size, "%s", p2_table(32 - prefix));
-	} else {
-		unsigned tmp = (1 << (32 - prefix)) - 2;
-		snprintf(hosts, hosts_size, "%u", tmp);
-	}
+	if (ipcalc_hosts(AF_INET, prefix, hosts, hosts_size) < 0 && hosts_size > 0)
+		hosts[0] = 0;
 	return hosts;
 }
 
 char *ipv6_prefix_to_hosts(char *hosts, unsigned hosts_size, unsigned prefix)
 {
-	snprintf(hosts, hosts_size, "%s", p2_table(128 - prefix));
+	if (ipcalc_hosts(AF_INET6, prefix, hosts, hosts_size) < 0 && hosts_size > 0)
+		hosts[0] = 0;
 	return hosts;
 }
 
@@ -580,45 +170,30 @@ static
 int get_ipv4_info(const char *ipStr, int prefix, ip_info_st * info,
 		  unsigned flags)
 {
-	struct in_addr ip, netmask, network, broadcast, minhost, maxhost;
-	char namebuf[INET_ADDRSTRLEN + 1];
+	ipcalc_net_st net;
+	ipcalc_info_st res;
+	const char *end;
+	uint32_t addr;
 	char errBuf[250];
+	uint64_t t = stats_start();
 
 	memset(info, 0, sizeof(*info));
 
-	if (inet_pton(AF_INET, ipStr, &ip) <= 0) {
+	/* CIDR entries such as 172/8 are accepted when a prefix is given */
+	end = parse_ipv4(ipStr, &addr, NULL, prefix >= 0);
+	if (end == NULL || *end != 0) {
 		if (!beSilent)
 			fprintf(stderr, "ipcalc: bad IPv4 address: %s\n",
 				ipStr);
+		stats.failures++;
 		return -1;
 	}
+	net.family = AF_INET;
+	net.addr.v4.s_addr = htonl(addr);
 
-	/* Handle CIDR entries such as 172/8 */
-	if (prefix >= 0) {
-		char *tmp = (char *)ipStr;
-		int i;
-
-		for (i = 3; i > 0; i--) {
-			tmp = strchr(tmp, '.');
-			if (!tmp)
-				break;
-			else
-				tmp++;
-		}
-
-		tmp = NULL;
-		for (; i > 0; i--) {
-			if (asprintf(&tmp, "%s.0", ipStr) == -1) {
-				fprintf(stderr,
-					"Memory allocation failure line %d\n",
-					__LINE__);
-				abort();
-			}
-			ipStr = tmp;
-		}
-	} else { /* assume good old days classful Internet */
+	if (prefix < 0) { /* assume good old days classful Internet */
 		if (flags & FLAG_ASSUME_CLASS_PREFIX)
-			prefix = default_ipv4_prefix(ip);
+			prefix = ipcalc_class_prefix(net.addr.v4);
 		else
 			prefix = 32;
 	}
@@ -626,96 +201,68 @@ int get_ipv4_info(const char *ipStr, int prefix, ip_info_st * info,
 	if (prefix > 32) {
 		if (!beSilent)
 			fprintf(stderr, "ipcalc: bad IPv4 prefix %d\n", prefix);
+		stats.failures++;
 		return -1;
 	}
+	stats_lap(STATS_PARSE, &t);
 
-	if (inet_ntop(AF_INET, &ip, namebuf, sizeof(namebuf)) == 0) {
-		if (!beSilent)
-			fprintf(stderr,
-				"ipcalc: error calculating the IPv4 network\n");
-		return -1;
-	}
-	info->ip = safe_strdup(namebuf);
-
-	netmask.s_addr = prefix2mask(prefix);
-	memset(namebuf, '\0', sizeof(namebuf));
+	info->prefix = net.prefix = prefix;
+	ipcalc_info(&net, &res);
 
-	if (inet_ntop(AF_INET, &netmask, namebuf, INET_ADDRSTRLEN) == NULL) {
-		fprintf(stderr, "inet_ntop failure at line %d\n",
-			__LINE__);
-		exit(1);
-	}
-	info->netmask = safe_strdup(namebuf);
-	info->prefix = prefix;
-
-	broadcast = calc_broadcast(ip, prefix);
-
-	memset(namebuf, '\0', sizeof(namebuf));
-	if (inet_ntop(AF_INET, &broadcast, namebuf, INET_ADDRSTRLEN) == NULL) {
-		fprintf(stderr, "inet_ntop failure at line %d\n",
-			__LINE__);
-		exit(1);
-	}
-	info->broadcast = safe_strdup(namebuf);
+	if (NEED_INFO(flags, FLAG_SHOW_ADDRESS))
+		ipcalc_format_addr(AF_INET, &res.address, info->ip, sizeof(info->ip));
 
-	network = calc_network(ip, prefix);
+	if (NEED_INFO(flags, FLAG_SHOW_NETMASK))
+		ipcalc_format_addr(AF_INET, &res.netmask, info->netmask, sizeof(info->netmask));
 
-	info->reverse_dns = calc_reverse_dns4(network, prefix, network, broadcast);
+	if (NEED_INFO(flags, FLAG_SHOW_BROADCAST))
+		ipcalc_format_addr(AF_INET, &res.broadcast, info->broadcast, sizeof(info->broadcast));
 
-	memset(namebuf, '\0', sizeof(namebuf));
-	if (inet_ntop(AF_INET, &network, namebuf, INET_ADDRSTRLEN) == NULL) {
-		fprintf(stderr, "inet_ntop failure at line %d\n",
-			__LINE__);
-		exit(1);
+	if (flags & (FLAG_SHOW_ALL_INFO|FLAG_SHOW_REVERSE)) {
+		if (ipcalc_reverse_dns(&net, info->reverse_dns, sizeof(info->reverse_dns)) < 0) {
+			info->reverse_dns[0] = 0;
+			if (flags & FLAG_SHOW_REVERSE) {
+				if (!beSilent)
+					fprintf(stderr, "ipcalc: no reverse DNS zone for IPv4 prefix %d\n", prefix);
+				stats.failures++;
+				return -1;
+			}
+		}
 	}
 
-	info->network = safe_strdup(namebuf);
+	if (NEED_INFO(flags, FLAG_SHOW_NETWORK))
+		ipcalc_format_addr(AF_INET, &res.network, info->network, sizeof(info->network));
 
-	info->type = ipv4_net_to_type(network);
-	info->class = ipv4_net_to_class(network);
+	if (NEED_INFO(flags, FLAG_SHOW_ADDRSPACE))
+		info->type = ipcalc_addrspace(&net);
+	if (flags & FLAG_SHOW_ALL_INFO)
+		info->class = ipcalc_class(&net);
 
-	if (prefix < 32) {
-		memcpy(&minhost, &network, sizeof(minhost));
+	if (NEED_INFO(flags, FLAG_SHOW_MINADDR))
+		ipcalc_format_addr(AF_INET, &res.minaddr, info->hostmin, sizeof(info->hostmin));
 
-		if (prefix <= 30)
-			minhost.s_addr = htonl(ntohl(minhost.s_addr) | 1);
-		if (inet_ntop(AF_INET, &minhost, namebuf, INET_ADDRSTRLEN) ==
-		    NULL) {
-			fprintf(stderr, "inet_ntop failure at line %d\n",
-				__LINE__);
-			exit(1);
-		}
-		info->hostmin = safe_strdup(namebuf);
-
-		memcpy(&maxhost, &network, sizeof(minhost));
-		maxhost.s_addr |= ~netmask.s_addr;
-		if (prefix <= 30) {
-			maxhost.s_addr = htonl(ntohl(maxhost.s_addr) - 1);
-		}
-		if (inet_ntop(AF_INET, &maxhost, namebuf, sizeof(namebuf)) == 0) {
-			if (!beSilent)
-				fprintf(stderr,
-					"ipcalc: error calculating the IPv4 network\n");
-			return -1;
-		}
+	if (NEED_INFO(flags, FLAG_SHOW_MAXADDR))
+		ipcalc_format_addr(AF_INET, &res.maxaddr, info->hostmax, sizeof(info->hostmax));
 
-		info->hostmax = safe_strdup(namebuf);
-	} else {
-		info->hostmin = info->network;
-		info->hostmax = info->network;
-	}
+	if (NEED_INFO(flags, FLAG_SHOW_ADDRESSES))
+		ipcalc_hosts(AF_INET, prefix, info->hosts, sizeof(info->hosts));
 
-	ipv4_prefix_to_hosts(info->hosts, sizeof(info->hosts), prefix);
+	stats_lap(STATS_COMPUTE, &t);
 
 #if defined(USE_GEOIP) || defined(USE_MAXMIND)
 	if (flags & FLAG_GET_GEOIP) {
-		geo_ip_lookup(ipStr, &info->geoip_country, &info->geoip_ccode, &info->geoip_city, &info->geoip_coord);
+		geo_cache_lookup(ipStr, AF_INET, &net.addr.v4, info);
+		stats.geoip_lookups++;
+		stats_lap(STATS_GEOIP, &t);
 	}
 #endif
 
 	if (flags & FLAG_RESOLVE_HOST) {
-		info->hostname = get_hostname(AF_INET, &ip);
-		if (info->hostname == NULL) {
+		char *ret = resolver_get_hostname(AF_INET, &net.addr.v4, info->hostname, sizeof(info->hostname));
+
+		stats.dns_lookups++;
+		stats_lap(STATS_DNS, &t);
+		if (ret == NULL) {
 			if (!beSilent) {
 				sprintf(errBuf,
 					"ipcalc: cannot find hostname for %s",
@@ -728,146 +275,11 @@ int get_ipv4_info(const char *ipStr, int prefix, ip_info_st * info,
 	return 0;
 }
 
-int ipv6_prefix_to_mask(unsigned prefix, struct in6_addr *mask)
-{
-	struct in6_addr in6;
-	int i, j;
-
-	if (prefix > 128)
-		return -1;
-
-	memset(&in6, 0x0, sizeof(in6));
-	for (i = prefix, j = 0; i > 0; i -= 8, j++) {
-		if (i >= 8) {
-			in6.s6_addr[j] = 0xff;
-		} else {
-			in6.s6_addr[j] = (unsigned long)(0xffU << (8 - i));
-		}
-	}
-
-	memcpy(mask, &in6, sizeof(*mask));
-	return 0;
-}
-
-static char *ipv6_mask_to_str(const struct in6_addr *mask)
-{
-	char buf[128];
-
-	if (inet_ntop(AF_INET6, mask, buf, sizeof(buf)) == NULL)
-		return NULL;
-
-	return safe_strdup(buf);
-}
-
-static const char *ipv6_net_to_type(struct in6_addr *net, int prefix)
-{
-	uint16_t word1 = net->s6_addr[0] << 8 | net->s6_addr[1];
-	uint16_t word2 = net->s6_addr[2] << 8 | net->s6_addr[3];
-
-	/* based on IANA's iana-ipv6-special-registry and ipv6-address-space
-	 * Updated: 2019-09-13
-	 */
-	if (prefix == 128 && memcmp
-	    (net->s6_addr,
-	     "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01",
-	     16) == 0)
-		return "Loopback Address";
-
-	if (prefix == 128 && memcmp
-	    (net->s6_addr,
-	     "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
-	     16) == 0)
-		return "Unspecified Address";
-
-	if (prefix >= 96 && memcmp
-	    (net->s6_addr, "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\xff\xff",
-	     12) == 0)
-		return "IPv4-mapped Address";
-
-	if (prefix >= 96 && memcmp
-	    (net->s6_addr, "\x00\x64\xff\x9b\x00\x00\x00\x00\x00\x00\x00\x00",
-	     12) == 0)
-		return "IPv4-IPv6 Translat.";
-
-	if (prefix >= 48 && memcmp
-	    (net->s6_addr, "\x00\x64\xff\x9b\x00\x01",
-	     6) == 0)
-		return "IPv4-IPv6 Translat.";
-
-	if (prefix >= 96 && memcmp
-	    (net->s6_addr, "\x10\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
-	     12) == 0)
-		return "Discard-Only Address Block";
-
-	if (prefix >= 32 && word1 == 0x2001 && word2 == 0)
-		return "TEREDO";
-
-	if (prefix == 128 && memcmp
-	    (net->s6_addr, "\x20\x01\x00\x01\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01",
-	     16) == 0)
-		return "Port Control Protocol Anycast";
-
-	if (prefix == 128 && memcmp
-	    (net->s6_addr, "\x20\x01\x00\x01\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x02",
-	     16) == 0)
-		return "Traversal Using Relays around NAT Anycast";
-
-	if (prefix >= 48 && memcmp
-	    (net->s6_addr, "\x20\x01\x00\x02\x00\x00",
-	     6) == 0)
-		return "Benchmarking";
-
-	if (prefix >= 32 && word1 == 0x2001 && word2 == 0x3)
-		return "AMT";
-
-	if (prefix >= 48 && memcmp
-	    (net->s6_addr, "\x20\x01\x00\x04\x01\x12",
-	     6) == 0)
-		return "AS112-v6";
-
-	if (prefix >= 28 && word1 == 0x2001 && (word2 & 0xfff0) == 0x10)
-		return "Deprecated (previously ORCHID)";
-
-	if (prefix >= 28 && word1 == 0x2001 && (word2 & 0xfff0) == 0x20)
-		return "ORCHIDv2";
-
-	if (prefix >= 23 && word1 == 0x2001 && (word2 & 0xff00) <= 0x100)
-		return "IETF Protocol Assignments";
-
-	if (prefix >= 32 && word1 == 0x2001 && word2 == 0xdb8)
-		return "Documentation";
-
-	if (word1 == 0x2002)
-		return "6to4";
-
-	if (prefix >= 48 && memcmp
-	    (net->s6_addr, "\x26\x20\x00\x4f\x80\x00",
-	     6) == 0)
-		return "Direct Delegation AS112 Service";
-
-	if ((word1 & 0xe000) == 0x2000) {
-		return "Global Unicast";
-	}
-
-	if (((net->s6_addr[0] & 0xfe) == 0xfc)) {
-		return "Unique Local Unicast";
-	}
-
-	if ((word1 & 0xffc0) == 0xfe80) {
-		return "Link-Scoped Unicast";
-	}
-
-	if ((net->s6_addr[0] & 0xff) == 0xff) {
-		return "Multicast";
-	}
-
-	return "Reserved";
-}
-
+/* Prints the IPv6 address with all the zeros present; buf must be
+ * at least INET6_ADDRSTRLEN bytes */
 static
-char *expand_ipv6(struct in6_addr *ip6)
+char *expand_ipv6(struct in6_addr *ip6, char *buf)
 {
-	char buf[128];
 	char *p;
 	unsigned i;
 
@@ -882,105 +294,98 @@ char *expand_ipv6(struct in6_addr *ip6)
 	}
 	*p = 0;
 
-	return safe_strdup(buf);
+	return buf;
 }
 
 static
 int get_ipv6_info(const char *ipStr, int prefix, ip_info_st * info,
 		  unsigned flags)
 {
-	struct in6_addr ip6, mask, network;
+	ipcalc_net_st net;
+	ipcalc_info_st res;
 	char errBuf[250];
-	unsigned i;
+	uint64_t t = stats_start();
 
 	memset(info, 0, sizeof(*info));
 
-	if (inet_pton(AF_INET6, ipStr, &ip6) <= 0) {
+	net.family = AF_INET6;
+	if (inet_pton(AF_INET6, ipStr, &net.addr.v6) <= 0) {
 		if (!beSilent)
 			fprintf(stderr, "ipcalc: bad IPv6 address: %s\n",
 				ipStr);
+		stats.failures++;
 		return -1;
 	}
 
-	/* expand  */
-	info->expanded_ip = expand_ipv6(&ip6);
-
-	if (inet_ntop(AF_INET6, &ip6, errBuf, sizeof(errBuf)) == 0) {
-		if (!beSilent)
-			fprintf(stderr,
-				"ipcalc: error calculating the IPv6 network\n");
-		return -1;
-	}
-
-	info->ip = safe_strdup(errBuf);
-
 	if (prefix > 128) {
 		if (!beSilent)
 			fprintf(stderr, "ipcalc: bad IPv6 prefix: %d\n",
 				prefix);
+		stats.failures++;
 		return -1;
 	} else if (prefix < 0) {
 		prefix = 128;
 	}
+	stats_lap(STATS_PARSE, &t);
 
-	info->prefix = prefix;
-
-	if (ipv6_prefix_to_mask(prefix, &mask) == -1) {
-		if (!beSilent)
-			fprintf(stderr,
-				"ipcalc: error converting IPv6 prefix: %d\n",
-				prefix);
-		return -1;
-	}
+	info->prefix = net.prefix = prefix;
+	ipcalc_info(&net, &res);
 
-	info->netmask = ipv6_mask_to_str(&mask);
+	/* expand  */
+	if (flags & FLAG_SHOW_MODERN_INFO)
+		expand_ipv6(&res.address.v6, info->expanded_ip);
 
-	for (i = 0; i < sizeof(struct in6_addr); i++)
-		network.s6_addr[i] = ip6.s6_addr[i] & mask.s6_addr[i];
+	if (NEED_INFO(flags, FLAG_SHOW_ADDRESS))
+		ipcalc_format_addr(AF_INET6, &res.address, info->ip, sizeof(info->ip));
 
-	if (inet_ntop(AF_INET6, &network, errBuf, sizeof(errBuf)) == 0) {
-		if (!beSilent)
-			fprintf(stderr,
-				"ipcalc: error calculating the IPv6 network\n");
-		return -1;
-	}
+	if (NEED_INFO(flags, FLAG_SHOW_NETMASK))
+		ipcalc_format_addr(AF_INET6, &res.netmask, info->netmask, sizeof(info->netmask));
 
-	info->network = safe_strdup(errBuf);
+	if (NEED_INFO(flags, FLAG_SHOW_NETWORK|FLAG_SHOW_MINADDR|FLAG_SHOW_MAXADDR))
+		ipcalc_format_addr(AF_INET6, &res.network, info->network, sizeof(info->network));
 
-	info->expanded_network = expand_ipv6(&network);
-	info->type = ipv6_net_to_type(&network, prefix);
+	if (flags & FLAG_SHOW_MODERN_INFO)
+		expand_ipv6(&res.network.v6, info->expanded_network);
+	if (NEED_INFO(flags, FLAG_SHOW_ADDRSPACE))
+		info->type = ipcalc_addrspace(&net);
 
-	info->reverse_dns = calc_reverse_dns6(&network, prefix);
+	if (flags & (FLAG_SHOW_ALL_INFO|FLAG_SHOW_REVERSE)) {
+		if (ipcalc_reverse_dns(&net, info->reverse_dns, sizeof(info->reverse_dns)) < 0) {
+			info->reverse_dns[0] = 0;
+			if (flags & FLAG_SHOW_REVERSE) {
+				if (!beSilent)
+					fprintf(stderr, "ipcalc: no reverse DNS zone for IPv6 prefix %d\n", prefix);
+				stats.failures++;
+				return -1;
+			}
+		}
+	}
 
-	if (prefix < 128) {
-		info->hostmin = safe_strdup(errBuf);
+	if (NEED_INFO(flags, FLAG_SHOW_MINADDR))
+		ipcalc_format_addr(AF_INET6, &res.minaddr, info->hostmin, sizeof(info->hostmin));
 
-		for (i = 0; i < sizeof(struct in6_addr); i++)
-			network.s6_addr[i] |= ~mask.s6_addr[i];
-		if (inet_ntop(AF_INET6, &network, errBuf, sizeof(errBuf)) == 0) {
-			if (!beSilent)
-				fprintf(stderr,
-					"ipcalc: error calculating the IPv6 network\n");
-			return -1;
-		}
+	if (NEED_INFO(flags, FLAG_SHOW_MAXADDR))
+		ipcalc_format_addr(AF_INET6, &res.maxaddr, info->hostmax, sizeof(info->hostmax));
 
-		info->hostmax = safe_strdup(errBuf);
-	} else {
-		info->hostmin = info->network;
-		info->hostmax = info->network;
-	}
+	if (NEED_INFO(flags, FLAG_SHOW_ADDRESSES))
+		ipcalc_hosts(AF_INET6, prefix, info->hosts, sizeof(info->hosts));
 
-	ipv6_prefix_to_hosts(info->hosts, sizeof(info->hosts), prefix);
+	stats_lap(STATS_COMPUTE, &t);
 
 #if defined(USE_GEOIP) || defined(USE_MAXMIND)
 	if (flags & FLAG_GET_GEOIP) {
-		geo_ip_lookup(ipStr, &info->geoip_country, &info->geoip_ccode, &info->geoip_city, &info->geoip_coord);
+		geo_cache_lookup(ipStr, AF_INET6, &net.addr.v6, info);
+		stats.geoip_lookups++;
+		stats_lap(STATS_GEOIP, &t);
 	}
 #endif
 
 	if (flags & FLAG_RESOLVE_HOST) {
-		info->hostname = get_hostname(AF_INET6, &ip6);
-		if (info->hostname == NULL) {
+		char *ret = resolver_get_hostname(AF_INET6, &net.addr.v6, info->hostname, sizeof(info->hostname));
+
+		stats.dns_lookups++;
+		stats_lap(STATS_DNS, &t);
+		if (ret == NULL) {
 			if (!beSilent) {
 				sprintf(errBuf,
 					"ipcalc: cannot find hostname for %s",
@@ -993,95 +398,75 @@ int get_ipv6_info(const char *ipStr, int prefix, ip_info_st * info,
 	return 0;
 }
 
-static int randomize(void *ptr, unsigned size)
-{
-	int fd, ret;
+/*!
+  \fn int str_to_prefix(unsigned *flags, const char *prefixStr, unsigned fix)
+  \brief converts a prefix or an IPv4 netmask to a prefix length
 
-	fd = open("/dev/urandom", O_RDONLY);
-	if (fd < 0)
-		return -1;
+  \param flags the flags to use; with fix set, FLAG_IPV6 is set for prefixes over 32.
+  \param prefixStr the prefix or netmask.
+  \param fix whether FLAG_IPV6 may be set.
 
-	ret = read(fd, ptr, size);
-	close(fd);
+  \return the prefix, or -1 on error.
+*/
+int str_to_prefix(unsigned *flags, const char *prefixStr, unsigned fix)
+{
+	int prefix;
 
-	if (ret != size) {
+	if (((*flags) & FLAG_IPV6) || (fix && !strchr(prefixStr, '.')))
+		prefix = ipcalc_parse_prefix(prefixStr, AF_INET6);
+	else	/* the prefix may be a netmask, 255.x.x.x */
+		prefix = ipcalc_parse_prefix(prefixStr, AF_INET);
+	if (prefix < 0)
 		return -1;
-	}
 
-	return 0;
+	if (prefix > 32)
+		*flags |= FLAG_IPV6;
+	return prefix;
 }
 
-static char *generate_ip_network(unsigned prefix, unsigned flags)
-{
-	struct timespec ts;
-	char ipbuf[64];
-	char *p = NULL;
-
-	if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) < 0)
-		return NULL;
+/*!
+  \fn int get_info(char *ipStr, char *prefixStr, ip_info_st *info, unsigned *flags)
+  \brief calculates the information for an address in the ADDRESS[/PREFIX] form
 
-	if (flags & FLAG_IPV6) {
-		struct in6_addr net;
+  The provided string is modified in place to split the prefix, unless
+  a prefix is explicitly given in prefixStr.
 
-		net.s6_addr[0] = 0xfc;
-		net.s6_addr[0] |= ts.tv_nsec & 1;
-		if (randomize(&net.s6_addr[1], 15) < 0)
-			return NULL;
+  \param ipStr the address, optionally followed by a prefix or netmask.
+  \param prefixStr the prefix or netmask, or NULL.
+  \param info where to store the calculated information.
+  \param flags the flags to use; FLAG_IPV6 may be set if the prefix implies it.
 
-		if (inet_ntop(AF_INET6, &net, ipbuf, sizeof(ipbuf)) == NULL)
-			return NULL;
-	} else {
-		struct in_addr net;
-		unsigned c = ts.tv_nsec % 4;
-		uint8_t bytes[4];
-
-		if (randomize(bytes, 4) < 0)
-			return NULL;
-
-		if (prefix >= 16 && c < 2) {
-			if (c == 1) {
-				bytes[0] = 192;
-				bytes[1] = 168;
-			} else {
-				bytes[0] = 172;
-				bytes[1] = 16 | ((ts.tv_nsec >> 4) & 0x0f);
-			}
-		} else {
-			bytes[0] = 10;
-		}
+  \return 0 on success, or -1 on error.
+*/
+int get_info(char *ipStr, char *prefixStr, ip_info_st *info, unsigned *flags)
+{
+	int prefix = -1;
+	uint64_t t = stats_start();
 
-		memcpy(&net.s_addr, bytes, 4);
+	stats.records++;
 
-		if (inet_ntop(AF_INET, &net, ipbuf, sizeof(ipbuf)) == NULL)
-			return NULL;
+	if (prefixStr == NULL && strchr(ipStr, '/') != NULL) {
+		prefixStr = strchr(ipStr, '/');
+		*prefixStr = '\0';	/* fix up ipStr */
+		prefixStr++;
 	}
 
-	if (asprintf(&p, "%s/%u", ipbuf, prefix) == -1)
-		return NULL;
-
-	return p;
-}
-
-static
-int str_to_prefix(unsigned *flags, const char *prefixStr, unsigned fix)
-{
-	int prefix = -1;
-	if (!((*flags) & FLAG_IPV6) && strchr(prefixStr, '.')) {	/* prefix is 255.x.x.x */
-		prefix = ipv4_mask_to_int(prefixStr);
-	} else {
-		int r = safe_atoi(prefixStr, &prefix);
-		if (r != 0) {
+	if (prefixStr != NULL) {
+		prefix = str_to_prefix(flags, prefixStr, 0);
+		if (prefix < 0) {
+			if (!beSilent)
+				fprintf(stderr,
+					"ipcalc: bad %s prefix: %s\n", ((*flags) & FLAG_IPV6)?"IPv6":"IPv4", prefixStr);
+			stats.failures++;
 			return -1;
 		}
 	}
+	stats_lap(STATS_PARSE, &t);
 
-	if (fix && (prefix > 32 && !((*flags) & FLAG_IPV6)))
-		*flags |= FLAG_IPV6;
-
-	if (prefix < 0 || ((((*flags) & FLAG_IPV6) && prefix > 128) || (!((*flags) & FLAG_IPV6) && prefix > 32))) {
-		return -1;
-	}
-	return prefix;
+	if ((*flags) & FLAG_IPV6)
+		return get_ipv6_info(ipStr, prefix, info, *flags);
+	else
+		return get_ipv4_info(ipStr, prefix, info, *flags);
 }
 
 #define OPT_ALLINFO 1
@@ -1093,12 +478,53 @@ int str_to_prefix(unsigned *flags, const char *prefixStr, unsigned fix)
 #define OPT_REVERSE 7
 #define OPT_CLASS_PREFIX 8
 #define OPT_NO_DECORATE 9
+#define OPT_BATCH 10
+#define OPT_JOBS 11
+#define OPT_DNS_QUERIES 12
+#define OPT_DNS_TIMEOUT 13
+#define OPT_AGGREGATE 14
+#define OPT_LPM_TABLE 15
+#define OPT_COMPILE_TABLE 16
+#define OPT_CONTAINS 17
+#define OPT_OVERLAPS 18
+#define OPT_NDJSON 19
+#define OPT_SPLIT_OFFSET 20
+#define OPT_SPLIT_COUNT 21
+#define OPT_SHARD 22
+#define OPT_COUNT 23
+#define OPT_STATS 24
+#define OPT_DNS_CACHE_TTL 25
+#define OPT_UNIQUE 26
+#define OPT_REVERSE_ZONES 27
+#define OPT_PTR_STUBS 28
+#define OPT_SUBTRACT 29
+#define OPT_INTERSECT 30
+#define OPT_UNION 31
+#define OPT_SERVE 32
 
 static const struct option long_options[] = {
 	{"check", 0, 0, 'c'},
 	{"random-private", 1, 0, 'r'},
 	{"split", 1, 0, 'S'},
+	{"split-offset", 1, 0, OPT_SPLIT_OFFSET},
+	{"split-count", 1, 0, OPT_SPLIT_COUNT},
+	{"shard", 1, 0, OPT_SHARD},
+	{"count", 2, 0, OPT_COUNT},
+	{"unique", 0, 0, OPT_UNIQUE},
+	{"reverse-zones", 2, 0, OPT_REVERSE_ZONES},
+	{"ptr-stubs", 0, 0, OPT_PTR_STUBS},
 	{"deaggregate", 1, 0, 'd'},
+	{"aggregate", 0, 0, OPT_AGGREGATE},
+	{"lpm-table", 1, 0, OPT_LPM_TABLE},
+	{"compile-table", 1, 0, OPT_COMPILE_TABLE},
+	{"contains", 1, 0, OPT_CONTAINS},
+	{"overlaps", 1, 0, OPT_OVERLAPS},
+	{"subtract", 1, 0, OPT_SUBTRACT},
+	{"intersect", 1, 0, OPT_INTERSECT},
+	{"union", 1, 0, OPT_UNION},
+	{"batch", 0, 0, OPT_BATCH},
+	{"jobs", 1, 0, OPT_JOBS},
+	{"serve", 1, 0, OPT_SERVE},
 	{"info", 0, 0, 'i'},
 	{"all-info", 0, 0, OPT_ALLINFO},
 	{"ipv4", 0, 0, '4'},
@@ -1108,6 +534,9 @@ static const struct option long_options[] = {
 	{"hostname", 0, 0, 'h'},
 	{"lookup-host", 1, 0, 'o'},
 	{"reverse-dns", 0, 0, OPT_REVERSE},
+	{"dns-queries", 1, 0, OPT_DNS_QUERIES},
+	{"dns-timeout", 1, 0, OPT_DNS_TIMEOUT},
+	{"dns-cache-ttl", 1, 0, OPT_DNS_CACHE_TTL},
 #if defined(USE_GEOIP) || defined(USE_MAXMIND)
 	{"geoinfo", 0, 0, 'g'},
 #endif
@@ -1122,6 +551,8 @@ static const struct option long_options[] = {
 	{"silent", 0, 0, 's'},
 	{"no-decorate", 0, 0, OPT_NO_DECORATE},
 	{"json", 0, 0, 'j'},
+	{"ndjson", 0, 0, OPT_NDJSON},
+	{"stats", 0, 0, OPT_STATS},
 	{"version", 0, 0, 'v'},
 	{"help", 0, 0, '?'},
 	{"usage", 0, 0, OPT_USAGE},
@@ -1136,9 +567,50 @@ void usage(unsigned verbose)
 		fprintf(stderr, "  -c, --check                     Validate IP address\n");
 		fprintf(stderr, "  -r, --random-private=PREFIX     Generate a random private IP network using\n");
 		fprintf(stderr, "                                  the supplied prefix or mask.\n");
+		fprintf(stderr, "      --count=N                   Generate N random networks with -r\n");
+		fprintf(stderr, "      --unique                    Generate every random network at most once\n");
 		fprintf(stderr, "  -S, --split=PREFIX              Split the provided network using the\n");
 		fprintf(stderr, "                                  provided prefix/netmask\n");
+		fprintf(stderr, "      --split-offset=K            Start the split output at the K-th network,\n");
+		fprintf(stderr, "                                  counting from 0\n");
+		fprintf(stderr, "      --split-count=M             Print at most M networks of the split\n");
+		fprintf(stderr, "      --shard=I/N                 Print only the I-th of N equal parts of the\n");
+		fprintf(stderr, "                                  split\n");
 		fprintf(stderr, "  -d, --deaggregate=IP1-IP2       Deaggregate the provided address range\n");
+		fprintf(stderr, "      --count                     Print only the number of networks of --split\n");
+		fprintf(stderr, "                                  or --deaggregate\n");
+		fprintf(stderr, "      --reverse-zones[=PREFIX]    List the reverse DNS zones of the provided\n");
+		fprintf(stderr, "                                  network, of the prefix rounded up to a label\n");
+		fprintf(stderr, "                                  boundary or of PREFIX\n");
+		fprintf(stderr, "      --ptr-stubs                 List the PTR record names of every address\n");
+		fprintf(stderr, "                                  of every zone of --reverse-zones\n");
+		fprintf(stderr, "      --aggregate                 Print the minimal set of networks covering the\n");
+		fprintf(stderr, "                                  networks read from the provided file or\n");
+		fprintf(stderr, "                                  standard input, one per line\n");
+		fprintf(stderr, "      --lpm-table=FILE            Print the longest matching prefix in FILE of\n");
+		fprintf(stderr, "                                  the addresses read from the provided file or\n");
+		fprintf(stderr, "                                  standard input, one per line\n");
+		fprintf(stderr, "      --compile-table=FILE OUT    Write the prefix table in FILE to OUT in a form\n");
+		fprintf(stderr, "                                  that --lpm-table loads without parsing\n");
+		fprintf(stderr, "      --contains=FILE             Print the network in FILE containing each of\n");
+		fprintf(stderr, "                                  the networks read from the provided file or\n");
+		fprintf(stderr, "                                  standard input, one per line\n");
+		fprintf(stderr, "      --overlaps=FILE             Print a network in FILE overlapping each of\n");
+		fprintf(stderr, "                                  the networks read from the provided file or\n");
+		fprintf(stderr, "                                  standard input, one per line\n");
+		fprintf(stderr, "      --subtract=FILE             Print the minimal set of networks covering the\n");
+		fprintf(stderr, "                                  addresses of the networks in FILE which are not\n");
+		fprintf(stderr, "                                  in those read from the provided file or\n");
+		fprintf(stderr, "                                  standard input, one per line\n");
+		fprintf(stderr, "      --intersect=FILE            Likewise, for the addresses in both lists\n");
+		fprintf(stderr, "      --union=FILE                Likewise, for the addresses in either list\n");
+		fprintf(stderr, "      --batch                     Read the addresses to process from the provided\n");
+		fprintf(stderr, "                                  file or standard input, one per line\n");
+		fprintf(stderr, "      --jobs=N                    Process the --batch input or the --serve\n");
+		fprintf(stderr, "                                  requests using N threads\n");
+		fprintf(stderr, "      --serve=PATH                Answer the requests of the clients of the Unix\n");
+		fprintf(stderr, "                                  socket PATH; the tables of --lpm-table and\n");
+		fprintf(stderr, "                                  --contains are loaded once and again on SIGHUP\n");
 		fprintf(stderr, "  -i, --info                      Print information on the provided IP address\n");
 		fprintf(stderr, "                                  (default)\n");
 		fprintf(stderr, "      --all-info                  Print verbose information on the provided IP\n");
@@ -1159,6 +631,10 @@ void usage(unsigned verbose)
 		fprintf(stderr, "                                  resides on\n");
 		fprintf(stderr, "  -h, --hostname                  Show hostname determined via DNS\n");
 		fprintf(stderr, "  -o, --lookup-host=STRING        Show IP as determined via DNS\n");
+		fprintf(stderr, "      --dns-queries=N             Maximum number of concurrent DNS queries with\n");
+		fprintf(stderr, "                                  --batch and --hostname\n");
+		fprintf(stderr, "      --dns-timeout=SECONDS       Give up waiting for a DNS query after SECONDS\n");
+		fprintf(stderr, "      --dns-cache-ttl=SECONDS     Reuse a DNS result for SECONDS with --batch\n");
 #if defined(USE_GEOIP) || defined(USE_MAXMIND)
 		fprintf(stderr, "  -g, --geoinfo                   Show Geographic information about the\n");
 		fprintf(stderr, "                                  provided IP\n");
@@ -1171,6 +647,10 @@ void usage(unsigned verbose)
 		fprintf(stderr, "                                  by the IPv4 address class\n");
 		fprintf(stderr, "      --no-decorate               Print only the requested information\n");
 		fprintf(stderr, "  -j, --json                      JSON output\n");
+		fprintf(stderr, "      --ndjson                    JSON output with an object per line, and a\n");
+		fprintf(stderr, "                                  separate one for every listed network\n");
+		fprintf(stderr, "      --stats                     Print the counters and timings of the run to\n");
+		fprintf(stderr, "                                  standard error, or as a last JSON object\n");
 		fprintf(stderr, "  -s, --silent                    Don't ever display error messages\n");
 		fprintf(stderr, "  -v, --version                   Display program version\n");
 		fprintf(stderr, "  -?, --help                      Show this help message\n");
@@ -1179,17 +659,188 @@ void usage(unsigned verbose)
 		fprintf(stderr, "Usage: ipcalc [-46sv?] [-c|--check] [-r|--random-private=STRING] [-i|--info]\n");
 		fprintf(stderr, "        [--all-info] [-4|--ipv4] [-6|--ipv6] [-a|--address] [-b|--broadcast]\n");
 		fprintf(stderr, "        [-h|--hostname] [-o|--lookup-host=STRING] [-g|--geoinfo]\n");
+		fprintf(stderr, "        [--dns-queries=N] [--dns-timeout=SECONDS] [--dns-cache-ttl=SECONDS]\n");
 		fprintf(stderr, "        [-m|--netmask] [-n|--network] [-p|--prefix] [--minaddr] [--maxaddr]\n");
 		fprintf(stderr, "        [--addresses] [--addrspace] [-j|--json] [-s|--silent] [-v|--version]\n");
-		fprintf(stderr, "        [--reverse-dns] [--class-prefix]\n");
+		fprintf(stderr, "        [--reverse-dns] [--class-prefix] [--batch] [--jobs=N] [--aggregate]\n");
+		fprintf(stderr, "        [--lpm-table=FILE] [--compile-table=FILE] [--contains=FILE]\n");
+		fprintf(stderr, "        [--overlaps=FILE] [--ndjson] [--split-offset=K] [--split-count=M]\n");
+		fprintf(stderr, "        [--shard=I/N] [--count[=N]] [--unique] [--reverse-zones[=PREFIX]]\n");
+		fprintf(stderr, "        [--ptr-stubs] [--subtract=FILE] [--intersect=FILE] [--union=FILE]\n");
+		fprintf(stderr, "        [--stats] [--serve=PATH]\n");
 		fprintf(stderr, "        [-?|--help] [--usage]\n");
 	}
 }
 
+/* In NDJSON mode every JSON object is printed in a single line. An
+ * object is opened by its first field, and every element of an array is
+ * printed as a separate object with the array name as its key, so that
+ * the output can be consumed a line at a time however long it is. */
+#define JSON_NL(str) ((flags & FLAG_NDJSON) ? "" : (str))
+
+/* The name of the array being printed in NDJSON mode */
+static __thread const char *json_array_head = NULL;
+
+/* The output is written out in blocks of this size */
+#define OUTPUT_FLUSH_SIZE (64*1024)
+
+/*!
+  \fn void output_init(struct output_buf *out, FILE *fp)
+  \brief initializes an output buffer
+
+  \param out the buffer.
+  \param fp the stream the buffer is flushed to, or NULL to keep all
+  the output in memory.
+*/
+void output_init(struct output_buf *out, FILE *fp)
+{
+	memset(out, 0, sizeof(*out));
+	out->fp = fp;
+	if (fp)
+		out->line_buffered = isatty(fileno(fp));
+}
+
+/*!
+  \fn void output_set(struct output_buf *out)
+  \brief sets the buffer the output functions of this thread print to
+
+  \param out the buffer, or NULL to print to the standard output.
+*/
+void output_set(struct output_buf *out)
+{
+	output_cur = out;
+}
+
+static struct output_buf *output_get(void)
+{
+	if (output_cur)
+		return output_cur;
+
+	if (output_stdout.fp == NULL)
+		output_init(&output_stdout, stdout);
+	return &output_stdout;
+}
+
+static void output_flush_buf(struct output_buf *out)
+{
+	if (out->fp && out->len > 0) {
+		uint64_t t = stats_start();
+
+		fwrite(out->data, 1, out->len, out->fp);
+		fflush(out->fp);
+		out->len = 0;
+		stats_lap(STATS_WRITE, &t);
+	}
+}
+
+/*!
+  \fn void output_flush(void)
+  \brief writes the buffered output of this thread to its stream
+*/
+void output_flush(void)
+{
+	output_flush_buf(output_get());
+}
+
+/* Makes room for at least n more bytes; returns where to write them */
+static char *output_reserve(struct output_buf *out, size_t n)
+{
+	size_t size;
+
+	if (out->fp && out->len + n > OUTPUT_FLUSH_SIZE)
+		output_flush_buf(out);
+
+	if (out->size - out->len >= n)
+		return out->data + out->len;
+
+	size = out->size ? out->size : OUTPUT_FLUSH_SIZE;
+	while (size - out->len < n)
+		size *= 2;
+
+	out->data = safe_realloc(out->data, size);
+	out->size = size;
+
+	return out->data + out->len;
+}
+
+static void output_commit(struct output_buf *out, size_t n)
+{
+	out->len += n;
+	if (out->line_buffered && memchr(out->data + out->len - n, '\n', n))
+		output_flush_buf(out);
+}
+
+/*!
+  \fn void output_write(const char *str, size_t len)
+  \brief appends len bytes of str to the output
+*/
+void output_write(const char *str, size_t len)
+{
+	struct output_buf *out = output_get();
+
+	memcpy(output_reserve(out, len), str, len);
+	output_commit(out, len);
+}
+
+void output_puts(const char *str)
+{
+	output_write(str, strlen(str));
+}
+
+void output_vprintf(const char *fmt, va_list args)
+{
+	struct output_buf *out = output_get();
+	va_list args2;
+	size_t avail;
+	int n;
+
+	va_copy(args2, args);
+	output_reserve(out, 128);
+	avail = out->size - out->len;
+	n = vsnprintf(out->data + out->len, avail, fmt, args);
+	if (n >= 0 && (size_t)n >= avail) {
+		output_reserve(out, n + 1);
+		n = vsnprintf(out->data + out->len, n + 1, fmt, args2);
+	}
+	va_end(args2);
+
+	if (n > 0)
+		output_commit(out, n);
+}
+
+void
+__attribute__ ((format(printf, 1, 2)))
+output_printf(const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	output_vprintf(fmt, args);
+	va_end(args);
+}
+
+/*!
+  \fn void output_addr(int family, const void *addr)
+  \brief formats the address directly into the output
+
+  \param family the address family, either AF_INET or AF_INET6.
+  \param addr a pointer to a struct in_addr or a struct in6_addr.
+*/
+void output_addr(int family, const void *addr)
+{
+	struct output_buf *out = output_get();
+	char *p = output_reserve(out, INET6_ADDRSTRLEN);
+
+	if (family == AF_INET)
+		output_commit(out, format_ipv4(p, ntohl(((const struct in_addr *)addr)->s_addr)));
+	else
+		output_commit(out, format_ipv6(p, addr));
+}
+
 void output_start(unsigned * const jsonfirst)
 {
-	if (flags & FLAG_JSON) {
-		printf("{\n");
+	if ((flags & FLAG_JSON) && !(flags & FLAG_NDJSON)) {
+		output_printf("{%s", JSON_NL("\n"));
 	}
 
 	*jsonfirst = JSON_FIRST;
@@ -1198,28 +849,37 @@ void output_start(unsigned * const jsonfirst)
 void output_separate(unsigned * const jsonfirst)
 {
 	if (!(flags & FLAG_JSON)) {
-		printf("\n");
+		output_printf("\n");
 	}
 }
 
 void output_stop(unsigned * const jsonfirst)
 {
-	if (flags & FLAG_JSON) {
-		printf("\n}\n");
+	if (flags & FLAG_NDJSON) {
+		if (*jsonfirst == JSON_FIRST)
+			output_puts("{}\n");
+		else if (*jsonfirst == JSON_NEXT)
+			output_puts("}\n");
+	} else if (flags & FLAG_JSON) {
+		output_printf("%s}\n", JSON_NL("\n"));
 	}
 }
 
 void array_start(unsigned * const jsonfirst, const char *head, const char *json_head)
 {
-	if (flags & FLAG_JSON) {
+	if (flags & FLAG_NDJSON) {
+		if (*jsonfirst == JSON_NEXT)
+			output_puts("}\n");
+		json_array_head = json_head;
+	} else if (flags & FLAG_JSON) {
 		if (*jsonfirst == JSON_NEXT) {
-			printf(",\n  ");
+			output_printf(",%s", JSON_NL("\n"));
 		}
 
-		printf("  \"%s\":[\n  ", json_head);
+		output_printf("%s\"%s\":[%s", JSON_NL("  "), json_head, JSON_NL("\n  "));
 	} else {
 		if (!(flags & FLAG_NO_DECORATE))
-			printf("[%s]\n", head);
+			output_printf("[%s]\n", head);
 	}
 
 	*jsonfirst = JSON_ARRAY_FIRST;
@@ -1227,8 +887,10 @@ void array_start(unsigned * const jsonfirst, const char *head, const char *json_
 
 void array_stop(unsigned * const jsonfirst)
 {
-	if (flags & FLAG_JSON) {
-		printf("]");
+	if (flags & FLAG_NDJSON) {
+		*jsonfirst = JSON_RECORD_NEXT;
+	} else if (flags & FLAG_JSON) {
+		output_printf("]");
 		*jsonfirst = JSON_NEXT;
 	}
 }
@@ -1248,25 +910,15 @@ color_printf(const char *color, const char *title, const char *fmt, ...)
 
 void va_color_printf(const char *color, const char *title, const char *fmt, va_list varglist)
 {
-	int ret;
-	char *str = NULL;
-
-	ret = vasprintf(&str, fmt, varglist);
-
-	if (ret < 0) {
-		return;
-	}
-
-	fputs(title, stdout);
+	output_puts(title);
 	if (colors) {
-		fputs(color, stdout);
+		output_puts(color);
 	}
-	fputs(str, stdout);
-	fputs("\n", stdout);
+	output_vprintf(fmt, varglist);
+	output_puts("\n");
 	if (colors) {
-		fputs(KRESET, stdout);
+		output_puts(KRESET);
 	}
-	free(str);
 	return;
 }
 
@@ -1282,32 +934,51 @@ json_printf(unsigned * const jsonfirst, const char *jsontitle, const char *fmt,
 
 	return;
 }
-void va_json_printf(unsigned * const jsonfirst, const char *jsontitle, const char *fmt, va_list varglist)
+static void json_field_start(unsigned * const jsonfirst, const char *jsontitle)
 {
-	int ret;
-	char *str = NULL;
-
-	ret = vasprintf(&str, fmt, varglist);
-	if (ret < 0)
-		return;
-
-	if (*jsonfirst == JSON_ARRAY_NEXT) {
-		fprintf(stdout, ",\n  ");
+	if (flags & FLAG_NDJSON) {
+		if (*jsonfirst == JSON_NEXT) {
+			output_puts(",");
+		} else if (*jsonfirst == JSON_ARRAY_FIRST) {
+			output_puts("{\"");
+			output_puts(json_array_head);
+			output_puts("\":");
+		} else {
+			output_puts("{");
+		}
+	} else if (*jsonfirst == JSON_ARRAY_NEXT) {
+		output_puts(",");
+		output_puts(JSON_NL("\n  "));
 	} else if (*jsonfirst == JSON_NEXT) {
-		fprintf(stdout, ",\n");
+		output_puts(",");
+		output_puts(JSON_NL("\n"));
 	}
 
-	fprintf(stdout, "  ");
-	if (jsontitle)
-		fprintf(stdout, "\"%s\":\"%s\"", jsontitle, str);
-	else
-		fprintf(stdout, "\"%s\"", str);
-	if (*jsonfirst == JSON_FIRST)
+	output_puts(JSON_NL("  "));
+	output_puts("\"");
+	if (jsontitle) {
+		output_puts(jsontitle);
+		output_puts("\":\"");
+	}
+}
+
+static void json_field_stop(unsigned * const jsonfirst)
+{
+	output_puts("\"");
+	if (*jsonfirst == JSON_ARRAY_FIRST && (flags & FLAG_NDJSON))
+		output_puts("}\n");
+	else if (*jsonfirst == JSON_FIRST || *jsonfirst == JSON_RECORD_NEXT)
 		*jsonfirst = JSON_NEXT;
 	else if (*jsonfirst == JSON_ARRAY_FIRST)
 		*jsonfirst = JSON_ARRAY_NEXT;
+}
+
+void va_json_printf(unsigned * const jsonfirst, const char *jsontitle, const char *fmt, va_list varglist)
+{
+	json_field_start(jsonfirst, jsontitle);
+	output_vprintf(fmt, varglist);
+	json_field_stop(jsonfirst);
 
-	free(str);
 	return;
 }
 
@@ -1319,8 +990,8 @@ default_printf(unsigned * const jsonfirst, const char *title, const char *jsonti
 
 	va_start(args, fmt);
 	if (flags & FLAG_NO_DECORATE) {
-		vprintf(fmt, args);
-		printf("\n");
+		output_vprintf(fmt, args);
+		output_puts("\n");
 	} else if (flags & FLAG_JSON) {
 		va_json_printf(jsonfirst, jsontitle, fmt, args);
 	} else {
@@ -1331,6 +1002,81 @@ default_printf(unsigned * const jsonfirst, const char *title, const char *jsonti
 	return;
 }
 
+/*!
+  \fn void default_puts(unsigned * const jsonfirst, const char *title, const char *jsontitle, const char *str)
+  \brief prints str as \ref default_printf does, without formatting it
+
+  This is used for the output of every network of large splits and
+  deaggregations.
+*/
+void default_puts(unsigned * const jsonfirst, const char *title, const char *jsontitle, const char *str)
+{
+	if (flags & FLAG_NO_DECORATE) {
+		output_puts(str);
+		output_puts("\n");
+	} else if (flags & FLAG_JSON) {
+		json_field_start(jsonfirst, jsontitle);
+		output_puts(str);
+		json_field_stop(jsonfirst);
+	} else {
+		output_puts(title);
+		if (colors)
+			output_puts(KBLUE);
+		output_puts(str);
+		output_puts("\n");
+		if (colors)
+			output_puts(KRESET);
+	}
+}
+
+/*!
+  \fn int output_network(const ipcalc_net_st *net, void *jsonchain)
+  \brief prints a network of a split or a deaggregation
+
+  This is the sink of the library iterators: it has the type of an
+  ipcalc_net_cb and prints as \ref default_puts does, formatting the
+  network directly into the output.
+
+  \param net the network.
+  \param jsonchain the JSON state of the output, an unsigned *.
+
+  \return 0, to continue the iteration.
+*/
+int output_network(const ipcalc_net_st *net, void *jsonchain)
+{
+	unsigned json = (flags & (FLAG_JSON | FLAG_NO_DECORATE)) == FLAG_JSON;
+	unsigned decorate = !(flags & (FLAG_JSON | FLAG_NO_DECORATE));
+	struct output_buf *out;
+	char *p;
+	int n;
+
+	stats.networks++;
+
+	if (json)
+		json_field_start(jsonchain, NULL);
+	else if (decorate) {
+		output_puts("Network:\t");
+		if (colors)
+			output_puts(KBLUE);
+	}
+
+	out = output_get();
+	p = output_reserve(out, IPCALC_NET_SIZE);
+	n = ipcalc_format_net(net, p, IPCALC_NET_SIZE);
+
+	if (json) {
+		output_commit(out, n);
+		json_field_stop(jsonchain);
+		return 0;
+	}
+
+	p[n] = '\n';
+	output_commit(out, n + 1);
+	if (decorate && colors)
+		output_puts(KRESET);
+	return 0;
+}
+
 void
 __attribute__ ((format(printf, 4, 5)))
 dist_printf(unsigned * const jsonfirst, const char *title, const char *jsontitle, const char *fmt, ...)
@@ -1370,114 +1116,404 @@ dist_printf(unsigned * const jsonfirst, const char *title, const char *jsontitle
 #define COORDINATES_NAME "COORDINATES"
 
 /*!
-  \fn main(int argc, const char **argv)
-  \brief wrapper program for ipcalc functions.
-
-  This is a wrapper program for the functions that the ipcalc library provides.
-  It can be used from shell scripts or directly from the command line.
+  \fn void show_info(const ip_info_st *info, const char *ipStr, unsigned flags)
+  \brief prints the information calculated by get_ipv4_info() or get_ipv6_info()
 
-  For more information, please see the ipcalc(1) man page.
+  \param info the calculated information.
+  \param ipStr the address that was resolved when --lookup-host is given.
+  \param flags the flags specifying the information to print.
 */
-int main(int argc, char **argv)
+void show_info(const ip_info_st *info, const char *ipStr, unsigned flags)
 {
-	char *randomStr = NULL;
-	char *hostname = NULL;
-	char *splitStr = NULL;
-	char *ipStr = NULL, *prefixStr = NULL, *netmaskStr = NULL, *chptr = NULL;
-	int prefix = -1, splitPrefix = -1;
-	ip_info_st info;
-	int r = 0;
 	unsigned jsonchain = JSON_FIRST;
-	enum app_t app = 0;
 
-	while (1) {
-		int c = getopt_long(argc, argv, "S:cr:i46abho:gmnpjsvd:", long_options, NULL);
-		if (c == -1)
-			break;
+	/* we know what we want to display now, so display it. */
+	if (flags & FLAG_SHOW_MODERN_INFO) {
+		unsigned single_host = 0;
 
-		switch(c) {
-			case 'c':
-				app |= APP_CHECK_ADDRESS;
-				break;
-			case 'S':
-				app |= APP_SPLIT;
-				splitStr = safe_strdup(optarg);
-				if (splitStr == NULL) exit(1);
-				break;
-			case 'd':
-				app |= APP_DEAGGREGATE;
-				ipStr = safe_strdup(optarg);
-				if (ipStr == NULL) exit(1);
-				break;
-			case 'r':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_RANDOM;
-				randomStr = safe_strdup(optarg);
-				if (randomStr == NULL) exit(1);
-				break;
-			case 'i':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_MODERN_INFO;
-				break;
-			case OPT_ALLINFO:
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_ALL_INFO|FLAG_SHOW_MODERN_INFO;
-				break;
-			case OPT_CLASS_PREFIX:
-				flags |= FLAG_ASSUME_CLASS_PREFIX;
-				break;
-			case OPT_REVERSE:
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_REVERSE;
-				break;
-			case '4':
-				flags |= FLAG_IPV4;
-				break;
-			case '6':
-				flags |= FLAG_IPV6;
-				break;
-			case 'a':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_ADDRESS;
-				break;
-			case 'b':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_BROADCAST;
-				break;
-			case 'h':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_RESOLVE_HOST;
-				break;
-			case 'o':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_RESOLVE_IP;
-				hostname = safe_strdup(optarg);
-				if (hostname == NULL) exit(1);
-				break;
-			case 'g':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_GEOIP;
-				break;
-			case 'm':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_NETMASK;
-				break;
-			case 'n':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_NETWORK;
-				break;
-			case 'p':
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_PREFIX;
-				break;
-			case OPT_MINADDR:
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_MINADDR;
-				break;
-			case OPT_MAXADDR:
-				app |= APP_SHOW_INFO;
-				flags |= FLAG_SHOW_MAXADDR;
-				break;
+		if (((flags & FLAG_IPV6) && info->prefix == 128) ||
+		    (!(flags & FLAG_IPV6) && info->prefix == 32)) {
+			single_host = 1;
+		}
+
+		output_start(&jsonchain);
+
+		if ((!(flags & FLAG_RANDOM) || single_host) &&
+		    (single_host || strcmp(info->network, info->ip) != 0)) {
+			if (info->expanded_ip[0]) {
+				default_printf(&jsonchain,"Full Address:\t", FULL_ADDRESS_NAME, "%s", info->expanded_ip);
+			}
+			default_printf(&jsonchain, "Address:\t", ADDRESS_NAME, "%s", info->ip);
+		}
+
+		if (single_host && info->hostname[0])
+			default_printf(&jsonchain, "Hostname:\t", HOSTNAME_NAME, "%s", info->hostname);
+
+		if (!single_host || (flags & FLAG_JSON)) {
+			if (! (flags & FLAG_JSON)) {
+				if (info->expanded_network[0]) {
+					default_printf(&jsonchain, "Full Network:\t", FULL_NETWORK_NAME, "%s/%u", info->expanded_network, info->prefix);
+				}
+				default_printf(&jsonchain, "Network:\t", NETWORK_NAME, "%s/%u", info->network, info->prefix);
+				default_printf(&jsonchain, "Netmask:\t", NETMASK_NAME, "%s = %u", info->netmask, info->prefix);
+			}
+			else {
+				if (info->expanded_network[0]) {
+					default_printf(&jsonchain, "Full Network:\t", FULL_NETWORK_NAME, "%s", info->expanded_network);
+				}
+				default_printf(&jsonchain, "Network:\t", NETWORK_NAME, "%s", info->network);
+				default_printf(&jsonchain, "Netmask:\t", NETMASK_NAME, "%s", info->netmask);
+				default_printf(&jsonchain, "Prefix:\t", PREFIX_NAME, "%u", info->prefix);
+			}
+
+
+			if (info->broadcast[0])
+				default_printf(&jsonchain, "Broadcast:\t", BROADCAST_NAME, "%s", info->broadcast);
+		}
+
+		if ((flags & FLAG_SHOW_ALL_INFO) && info->reverse_dns[0])
+			default_printf(&jsonchain, "Reverse DNS:\t", REVERSEDNS_NAME, "%s", info->reverse_dns);
+
+		if (!single_host || (flags & FLAG_JSON)) {
+			output_separate(&jsonchain);
+
+			if (info->type)
+				dist_printf(&jsonchain, "Address space:\t", ADDRSPACE_NAME, "%s", info->type);
+
+			if ((flags & FLAG_SHOW_ALL_INFO) && info->class)
+				dist_printf(&jsonchain, "Address class:\t", ADDRCLASS_NAME, "%s", info->class);
+
+			if (info->hostmin[0])
+				default_printf(&jsonchain, "HostMin:\t", MINADDR_NAME, "%s", info->hostmin);
+
+			if (info->hostmax[0])
+				default_printf(&jsonchain, "HostMax:\t", MAXADDR_NAME, "%s", info->hostmax);
+
+			if ((flags & FLAG_IPV6) && info->prefix < 112 && !(flags & FLAG_JSON))
+				default_printf(&jsonchain, "Hosts/Net:\t", ADDRESSES_NAME, "2^(%u) = %s", 128-info->prefix, info->hosts);
+			else
+				default_printf(&jsonchain, "Hosts/Net:\t", ADDRESSES_NAME, "%s", info->hosts);
+
+		} else {
+
+			if (info->type)
+				dist_printf(&jsonchain, "Address space:\t", ADDRSPACE_NAME, "%s", info->type);
+
+			if ((flags & FLAG_SHOW_ALL_INFO) && info->class)
+				dist_printf(&jsonchain, "Address class:\t", ADDRCLASS_NAME, "%s", info->class);
+		}
+
+		if (info->geoip_country[0] || info->geoip_city[0] || info->geoip_coord[0]) {
+			output_separate(&jsonchain);
+
+			if (info->geoip_ccode[0])
+				dist_printf(&jsonchain, "Country code:\t", COUNTRYCODE_NAME, "%s", info->geoip_ccode);
+			if (info->geoip_country[0])
+				dist_printf(&jsonchain, "Country:\t", COUNTRY_NAME, "%s", info->geoip_country);
+			if (info->geoip_city[0])
+				dist_printf(&jsonchain, "City:\t\t", CITY_NAME, "%s", info->geoip_city);
+			if (info->geoip_coord[0])
+				dist_printf(&jsonchain, "Coordinates:\t", COORDINATES_NAME, "%s", info->geoip_coord);
+		}
+
+		output_stop(&jsonchain);
+
+	} else if (!(flags & FLAG_SHOW_MODERN_INFO)) {
+
+		if (flags & FLAG_SHOW_ADDRESS) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(ADDRESS_NAME"=");
+			}
+			output_printf("%s\n", info->ip);
+		}
+
+		if (flags & FLAG_SHOW_NETMASK) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(NETMASK_NAME"=");
+			}
+			output_printf("%s\n", info->netmask);
+		}
+
+		if (flags & FLAG_SHOW_PREFIX) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(PREFIX_NAME"=");
+			}
+			output_printf("%u\n", info->prefix);
+		}
+
+		if ((flags & FLAG_SHOW_BROADCAST) && !(flags & FLAG_IPV6)) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(BROADCAST_NAME"=");
+			}
+			output_printf("%s\n", info->broadcast);
+		}
+
+		if (flags & FLAG_SHOW_NETWORK) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(NETWORK_NAME"=");
+			}
+			output_printf("%s\n", info->network);
+		}
+
+		if (flags & FLAG_SHOW_REVERSE) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(REVERSEDNS_NAME"=");
+			}
+			output_printf("%s\n", info->reverse_dns);
+		}
+
+		if ((flags & FLAG_SHOW_MINADDR) && info->hostmin[0]) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(MINADDR_NAME"=");
+			}
+			output_printf("%s\n", info->hostmin);
+		}
+
+		if ((flags & FLAG_SHOW_MAXADDR) && info->hostmax[0]) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(MAXADDR_NAME"=");
+			}
+			output_printf("%s\n", info->hostmax);
+		}
+
+		if ((flags & FLAG_SHOW_ADDRSPACE) && info->type) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(ADDRSPACE_NAME"=");
+			}
+			if (strchr(info->type, ' ') != NULL)
+				output_printf("\"%s\"\n", info->type);
+			else
+				output_printf("%s\n", info->type);
+		}
+
+		if ((flags & FLAG_SHOW_ADDRESSES) && info->hosts[0]) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(ADDRESSES_NAME"=");
+			}
+			if (strchr(info->hosts, ' ') != NULL)
+				output_printf("\"%s\"\n", info->hosts);
+			else
+				output_printf("%s\n", info->hosts);
+		}
+
+		if ((flags & FLAG_RESOLVE_HOST) && info->hostname[0]) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(HOSTNAME_NAME"=");
+			}
+			output_printf("%s\n", info->hostname);
+		}
+
+		if (flags & FLAG_RESOLVE_IP) {
+			if (! (flags & FLAG_NO_DECORATE)) {
+				output_printf(ADDRESS_NAME"=");
+			}
+			output_printf("%s\n", ipStr);
+		}
+
+		if ((flags & FLAG_SHOW_GEOIP) == FLAG_SHOW_GEOIP) {
+			if (info->geoip_ccode[0]) {
+				if (! (flags & FLAG_NO_DECORATE)) {
+					output_printf(COUNTRYCODE_NAME"=");
+				}
+				output_printf("%s\n", info->geoip_ccode);
+			}
+			if (info->geoip_country[0]) {
+				if (! (flags & FLAG_NO_DECORATE)) {
+					output_printf(COUNTRY_NAME"=");
+				}
+				if (strchr(info->geoip_country, ' ') != NULL)
+					output_printf("\"%s\"\n", info->geoip_country);
+				else
+					output_printf("%s\n", info->geoip_country);
+			}
+			if (info->geoip_city[0]) {
+				if (! (flags & FLAG_NO_DECORATE)) {
+					output_printf(CITY_NAME"=");
+				}
+				if (strchr(info->geoip_city, ' ') != NULL) {
+					output_printf("\"%s\"\n", info->geoip_city);
+				} else {
+					output_printf("%s\n", info->geoip_city);
+				}
+			}
+			if (info->geoip_coord[0]) {
+				if (! (flags & FLAG_NO_DECORATE)) {
+					output_printf(COORDINATES_NAME"=");
+				}
+				output_printf("\"%s\"\n", info->geoip_coord);
+			}
+		}
+	}
+
+}
+
+/*!
+  \fn main(int argc, const char **argv)
+  \brief wrapper program for ipcalc functions.
+
+  This is a wrapper program for the functions that the ipcalc library provides.
+  It can be used from shell scripts or directly from the command line.
+
+  For more information, please see the ipcalc(1) man page.
+*/
+int main(int argc, char **argv)
+{
+	char *randomStr = NULL;
+	char *hostname = NULL;
+	char *splitStr = NULL;
+	char *zonesStr = NULL;
+	unsigned ptr_stubs = 0;
+	char *lpmTable = NULL;
+	char *setFile = NULL;
+	char *servePath = NULL;
+	char *ipStr = NULL, *prefixStr = NULL, *chptr = NULL;
+	int prefix = -1, splitPrefix = -1;
+	split_slice_st slice;
+	unsigned slice_opts = 0;
+	ip_info_st info;
+	unsigned info_flags;
+	int r = 0;
+	enum app_t app = 0;
+	int jobs = 0;
+	int dns_queries = DEFAULT_DNS_QUERIES, dns_timeout = 0;
+	int dns_cache_ttl = DEFAULT_DNS_CACHE_TTL;
+	uint64_t random_count = 0;
+	unsigned unique = 0;
+	uint64_t t;
+
+	/* the output is buffered; write it out on every exit path */
+	atexit(output_flush);
+
+	memset(&slice, 0, sizeof(slice));
+
+	while (1) {
+		int c = getopt_long(argc, argv, "S:cr:i46abho:gmnpjsvd:", long_options, NULL);
+		if (c == -1)
+			break;
+
+		switch(c) {
+			case 'c':
+				app |= APP_CHECK_ADDRESS;
+				break;
+			case 'S':
+				app |= APP_SPLIT;
+				splitStr = safe_strdup(optarg);
+				if (splitStr == NULL) exit(1);
+				break;
+			case OPT_SPLIT_OFFSET:
+				if (safe_atou64(optarg, &slice.offset) != 0) {
+					if (!beSilent)
+						fprintf(stderr,
+							"ipcalc: bad split offset: %s\n", optarg);
+					exit(1);
+				}
+				slice_opts |= 1;
+				break;
+			case OPT_SPLIT_COUNT:
+				if (safe_atou64(optarg, &slice.count) != 0 || slice.count == 0) {
+					if (!beSilent)
+						fprintf(stderr,
+							"ipcalc: bad split count: %s\n", optarg);
+					exit(1);
+				}
+				slice_opts |= 1;
+				break;
+			case OPT_SHARD: {
+				char *sep = strchr(optarg, '/');
+				int shard = 0, shards = 0;
+
+				if (sep) {
+					*sep = 0;
+					if (safe_atoi(optarg, &shard) != 0 ||
+					    safe_atoi(sep + 1, &shards) != 0)
+						shard = 0;
+					*sep = '/';
+				}
+				if (shard < 1 || shard > shards) {
+					if (!beSilent)
+						fprintf(stderr,
+							"ipcalc: bad shard, expected I/N with I from 1 to N: %s\n", optarg);
+					exit(1);
+				}
+				slice.shard = shard;
+				slice.shards = shards;
+				slice_opts |= 2;
+				break;
+			}
+			case 'd':
+				app |= APP_DEAGGREGATE;
+				ipStr = safe_strdup(optarg);
+				if (ipStr == NULL) exit(1);
+				break;
+			case 'r':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_RANDOM;
+				randomStr = safe_strdup(optarg);
+				if (randomStr == NULL) exit(1);
+				break;
+			case 'i':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_MODERN_INFO;
+				break;
+			case OPT_ALLINFO:
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_ALL_INFO|FLAG_SHOW_MODERN_INFO;
+				break;
+			case OPT_CLASS_PREFIX:
+				flags |= FLAG_ASSUME_CLASS_PREFIX;
+				break;
+			case OPT_REVERSE:
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_REVERSE;
+				break;
+			case '4':
+				flags |= FLAG_IPV4;
+				break;
+			case '6':
+				flags |= FLAG_IPV6;
+				break;
+			case 'a':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_ADDRESS;
+				break;
+			case 'b':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_BROADCAST;
+				break;
+			case 'h':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_RESOLVE_HOST;
+				break;
+			case 'o':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_RESOLVE_IP;
+				hostname = safe_strdup(optarg);
+				if (hostname == NULL) exit(1);
+				break;
+			case 'g':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_GEOIP;
+				break;
+			case 'm':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_NETMASK;
+				break;
+			case 'n':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_NETWORK;
+				break;
+			case 'p':
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_PREFIX;
+				break;
+			case OPT_MINADDR:
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_MINADDR;
+				break;
+			case OPT_MAXADDR:
+				app |= APP_SHOW_INFO;
+				flags |= FLAG_SHOW_MAXADDR;
+				break;
 			case OPT_ADDRESSES:
 				app |= APP_SHOW_INFO;
 				flags |= FLAG_SHOW_ADDRESSES;
@@ -1489,9 +1525,100 @@ int main(int argc, char **argv)
 			case OPT_NO_DECORATE:
 				flags |= FLAG_NO_DECORATE;
 				break;
+			case OPT_AGGREGATE:
+				app |= APP_AGGREGATE;
+				break;
+			case OPT_LPM_TABLE:
+				app |= APP_LPM;
+				lpmTable = safe_strdup(optarg);
+				if (lpmTable == NULL) exit(1);
+				break;
+			case OPT_COMPILE_TABLE:
+				app |= APP_COMPILE_TABLE;
+				lpmTable = safe_strdup(optarg);
+				if (lpmTable == NULL) exit(1);
+				break;
+			case OPT_CONTAINS:
+			case OPT_OVERLAPS:
+				app |= (c == OPT_CONTAINS) ? APP_CONTAINS : APP_OVERLAPS;
+				setFile = safe_strdup(optarg);
+				if (setFile == NULL) exit(1);
+				break;
+			case OPT_SUBTRACT:
+			case OPT_INTERSECT:
+			case OPT_UNION:
+				app |= (c == OPT_SUBTRACT) ? APP_SUBTRACT :
+				       (c == OPT_INTERSECT) ? APP_INTERSECT : APP_UNION;
+				setFile = safe_strdup(optarg);
+				if (setFile == NULL) exit(1);
+				break;
+			case OPT_BATCH:
+				flags |= FLAG_BATCH;
+				break;
+			case OPT_SERVE:
+				app |= APP_SERVE;
+				servePath = optarg;
+				break;
+			case OPT_JOBS:
+				if (safe_atoi(optarg, &jobs) != 0 || jobs < 1 || jobs > MAX_JOBS) {
+					if (!beSilent)
+						fprintf(stderr,
+							"ipcalc: the number of jobs must be between 1 and %d: %s\n", MAX_JOBS, optarg);
+					return 1;
+				}
+				break;
+			case OPT_DNS_QUERIES:
+				if (safe_atoi(optarg, &dns_queries) != 0 || dns_queries < 1 || dns_queries > MAX_DNS_QUERIES) {
+					if (!beSilent)
+						fprintf(stderr,
+							"ipcalc: the number of DNS queries must be between 1 and %d: %s\n", MAX_DNS_QUERIES, optarg);
+					return 1;
+				}
+				break;
+			case OPT_DNS_TIMEOUT:
+				if (safe_atoi(optarg, &dns_timeout) != 0 || dns_timeout < 0) {
+					if (!beSilent)
+						fprintf(stderr,
+							"ipcalc: bad DNS timeout: %s\n", optarg);
+					return 1;
+				}
+				break;
+			case OPT_DNS_CACHE_TTL:
+				if (safe_atoi(optarg, &dns_cache_ttl) != 0 || dns_cache_ttl < 1) {
+					if (!beSilent)
+						fprintf(stderr,
+							"ipcalc: bad DNS cache TTL: %s\n", optarg);
+					return 1;
+				}
+				break;
 			case 'j':
 				flags |= FLAG_JSON;
 				break;
+			case OPT_NDJSON:
+				flags |= FLAG_JSON|FLAG_NDJSON;
+				break;
+			case OPT_COUNT:
+				flags |= FLAG_COUNT;
+				if (optarg && (safe_atou64(optarg, &random_count) != 0 || random_count == 0)) {
+					if (!beSilent)
+						fprintf(stderr,
+							"ipcalc: bad count: %s\n", optarg);
+					return 1;
+				}
+				break;
+			case OPT_UNIQUE:
+				unique = 1;
+				break;
+			case OPT_REVERSE_ZONES:
+				app |= APP_REVERSE_ZONES;
+				zonesStr = optarg;
+				break;
+			case OPT_PTR_STUBS:
+				ptr_stubs = 1;
+				break;
+			case OPT_STATS:
+				flags |= FLAG_STATS;
+				break;
 			case 's':
 				beSilent = 1;
 				break;
@@ -1505,49 +1632,248 @@ int main(int argc, char **argv)
 				usage(1);
 				exit(0);
 		}
-	}
+	}
+
+	if (optind < argc) {
+		if (ipStr != NULL) {
+			if (!beSilent)
+				fprintf(stderr,
+					"ipcalc: superfluous option given\n");
+			exit(1);
+		}
+
+		ipStr = argv[optind++];
+		if (optind < argc)
+			chptr = argv[optind++];
+	}
+
+	if ((flags & FLAG_JSON) && (flags & FLAG_NO_DECORATE)) {
+		flags &= ~FLAG_NO_DECORATE;
+	}
+
+	if (!(flags & FLAGS_TO_IGNORE_MASK))
+		flags |= FLAG_SHOW_MODERN_INFO;
+
+	/* Only the modern info flag results to JSON output */
+	if ((flags & ENV_INFO_MASK) && (flags & FLAG_JSON))
+		flags |= FLAG_SHOW_MODERN_INFO;
+
+	if (geo_setup() == 0 && (flags & FLAG_SHOW_ALL_INFO))
+		flags |= FLAG_GET_GEOIP;
+
+	/* the tables of these are loaded for the "lpm", "contains" and
+	 * "overlaps" requests of --serve */
+	if (app & APP_SERVE)
+		app &= ~(APP_SHOW_INFO|APP_LPM|APP_CONTAINS|APP_OVERLAPS);
+
+	if (__builtin_popcount(app) > 1) {
+		if (!beSilent)
+			fprintf(stderr,
+				"ipcalc: you cannot mix these options\n");
+		return 1;
+	}
+
+	if (flags & FLAG_STATS)
+		stats_init(flags);
+
+	if ((flags & FLAG_IPV6) && (flags & FLAG_IPV4)) {
+		if (!beSilent)
+			fprintf(stderr,
+				"ipcalc: you cannot specify both IPv4 and IPv6\n");
+		return 1;
+	}
+
+	/* Process the addresses in the provided file or stdin, one
+	 * per line. */
+	if (flags & FLAG_BATCH) {
+		FILE *fp = stdin;
+
+		if ((app & ~(APP_SHOW_INFO|APP_CHECK_ADDRESS)) ||
+		    (flags & (FLAG_RANDOM|FLAG_RESOLVE_IP))) {
+			if (!beSilent)
+				fprintf(stderr,
+					"ipcalc: you cannot mix these options with --batch\n");
+			return 1;
+		}
 
-	if (optind < argc) {
-		if (ipStr != NULL) {
+		if (chptr) {
 			if (!beSilent)
 				fprintf(stderr,
 					"ipcalc: superfluous option given\n");
-			exit(1);
+			return 1;
 		}
 
-		ipStr = argv[optind++];
-		if (optind < argc)
-			chptr = argv[optind++];
+		if (ipStr && strcmp(ipStr, "-") != 0) {
+			fp = fopen(ipStr, "r");
+			if (fp == NULL) {
+				if (!beSilent)
+					fprintf(stderr,
+						"ipcalc: cannot open %s\n", ipStr);
+				return 1;
+			}
+		}
+
+		if (flags & FLAG_JSON)
+			flags |= FLAG_NDJSON;
+
+		if (isatty(STDOUT_FILENO) != 0)
+			colors = 1;
+
+		if ((flags & FLAG_RESOLVE_HOST) && resolver_init(dns_queries, dns_timeout, dns_cache_ttl) < 0)
+			return 1;
+
+		r = show_batch(fp, flags, app == APP_CHECK_ADDRESS, jobs);
+		if (fp != stdin)
+			fclose(fp);
+		return r;
 	}
 
-	if ((flags & FLAG_JSON) && (flags & FLAG_NO_DECORATE)) {
+	if (app == APP_SERVE) {
+		if (ipStr) {
+			if (!beSilent)
+				fprintf(stderr,
+					"ipcalc: provided superfluous parameter '%s'\n", ipStr);
+			return 1;
+		}
+
+		if (flags & (FLAG_RANDOM|FLAG_RESOLVE_IP)) {
+			if (!beSilent)
+				fprintf(stderr,
+					"ipcalc: you cannot mix these options with --serve\n");
+			return 1;
+		}
+
+		if (jobs == 0) {
+			long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+			jobs = cpus < 1 ? 1 : cpus > MAX_JOBS ? MAX_JOBS : cpus;
+		}
+
+		/* every reply is a line of JSON */
+		flags |= FLAG_JSON|FLAG_NDJSON|FLAG_SHOW_MODERN_INFO;
 		flags &= ~FLAG_NO_DECORATE;
+
+		if ((flags & FLAG_RESOLVE_HOST) && resolver_init(dns_queries, dns_timeout, dns_cache_ttl) < 0)
+			return 1;
+
+		return serve(servePath, lpmTable, setFile, flags, jobs) < 0 ? 1 : 0;
 	}
 
-	if (!(flags & FLAGS_TO_IGNORE_MASK))
-		flags |= FLAG_SHOW_MODERN_INFO;
+	if (jobs != 0) {
+		if (!beSilent)
+			fprintf(stderr,
+				"ipcalc: --jobs can only be used with --batch or --serve\n");
+		return 1;
+	}
 
-	/* Only the modern info flag results to JSON output */
-	if ((flags & ENV_INFO_MASK) && (flags & FLAG_JSON))
-		flags |= FLAG_SHOW_MODERN_INFO;
+	if (slice_opts && app != APP_SPLIT) {
+		if (!beSilent)
+			fprintf(stderr,
+				"ipcalc: --split-offset, --split-count and --shard can only be used with --split\n");
+		return 1;
+	}
 
-	if (geo_setup() == 0 && (flags & FLAG_SHOW_ALL_INFO))
-		flags |= FLAG_GET_GEOIP;
+	/* with -r the number of networks may also follow --count as a
+	 * separate argument */
+	if ((flags & FLAG_RANDOM) && (flags & FLAG_COUNT) && random_count == 0 &&
+	    ipStr && chptr == NULL && strspn(ipStr, "0123456789") == strlen(ipStr)) {
+		if (safe_atou64(ipStr, &random_count) != 0 || random_count == 0) {
+			if (!beSilent)
+				fprintf(stderr,
+					"ipcalc: bad count: %s\n", ipStr);
+			return 1;
+		}
+		ipStr = NULL;
+	}
 
-	if (bit_count(app) > 1) {
+	if (random_count && (!(flags & FLAG_RANDOM) || app != APP_SHOW_INFO)) {
 		if (!beSilent)
 			fprintf(stderr,
-				"ipcalc: you cannot mix these options\n");
+				"ipcalc: --count=N can only be used with --random-private alone\n");
 		return 1;
 	}
 
-	if ((flags & FLAG_IPV6) && (flags & FLAG_IPV4)) {
+	if ((flags & FLAG_COUNT) && !random_count && app != APP_SPLIT && app != APP_DEAGGREGATE) {
 		if (!beSilent)
 			fprintf(stderr,
-				"ipcalc: you cannot specify both IPv4 and IPv6\n");
+				"ipcalc: --count can only be used with --split or --deaggregate, or with a number and --random-private\n");
+		return 1;
+	}
+
+	if (unique && !random_count) {
+		if (!beSilent)
+			fprintf(stderr,
+				"ipcalc: --unique can only be used with --random-private and --count\n");
+		return 1;
+	}
+
+	if (ptr_stubs && app != APP_REVERSE_ZONES) {
+		if (!beSilent)
+			fprintf(stderr,
+				"ipcalc: --ptr-stubs can only be used with --reverse-zones\n");
+		return 1;
+	}
+
+	if (slice_opts == 3) {
+		if (!beSilent)
+			fprintf(stderr,
+				"ipcalc: --shard cannot be combined with --split-offset or --split-count\n");
 		return 1;
 	}
 
+	if (app == APP_COMPILE_TABLE) {
+		if (ipStr == NULL || chptr) {
+			if (!beSilent)
+				fprintf(stderr,
+					"ipcalc: --compile-table expects an output file\n");
+			return 1;
+		}
+
+		return lpm_compile(lpmTable, ipStr, flags);
+	}
+
+	/* Aggregate or combine the networks or look up the addresses in
+	 * the provided file or stdin, one per line. */
+	if (app == APP_AGGREGATE || app == APP_LPM ||
+	    app == APP_CONTAINS || app == APP_OVERLAPS ||
+	    app == APP_SUBTRACT || app == APP_INTERSECT || app == APP_UNION) {
+		FILE *fp = stdin;
+
+		if (chptr) {
+			if (!beSilent)
+				fprintf(stderr,
+					"ipcalc: superfluous option given\n");
+			return 1;
+		}
+
+		if (ipStr && strcmp(ipStr, "-") != 0) {
+			fp = fopen(ipStr, "r");
+			if (fp == NULL) {
+				if (!beSilent)
+					fprintf(stderr,
+						"ipcalc: cannot open %s\n", ipStr);
+				return 1;
+			}
+		}
+
+		if (app == APP_LPM) {
+			if (flags & FLAG_JSON)
+				flags |= FLAG_NDJSON;
+			r = lpm_lookup(lpmTable, fp, flags);
+		} else if (app == APP_CONTAINS || app == APP_OVERLAPS) {
+			if (flags & FLAG_JSON)
+				flags |= FLAG_NDJSON;
+			r = check_networks(setFile, fp, app == APP_CONTAINS, flags);
+		} else if (app != APP_AGGREGATE) {
+			r = combine_networks(setFile, fp, app, flags);
+		} else {
+			r = aggregate(fp, flags);
+		}
+		if (fp != stdin)
+			fclose(fp);
+		return r;
+	}
+
 	/* if there is a : in the address, it is an IPv6 address.
 	 * Note that we allow -4, and -6 to be given explicitly, so
 	 * that the tool can be used to check for a valid IPv4 or IPv6
@@ -1559,12 +1885,23 @@ int main(int argc, char **argv)
 
 	switch (app) {
 	case APP_VERSION:
-		printf("ipcalc %s\n", VERSION);
+		output_printf("ipcalc %s\n", VERSION);
 		return 0;
 	case APP_DEAGGREGATE:
-		deaggregate(ipStr, flags);
-		return 0;
+		return deaggregate(ipStr, flags) < 0 ? 1 : 0;
+	case APP_AGGREGATE:
+	case APP_LPM:
+	case APP_COMPILE_TABLE:
+	case APP_CONTAINS:
+	case APP_OVERLAPS:
+	case APP_SUBTRACT:
+	case APP_INTERSECT:
+	case APP_UNION:
+	case APP_SERVE:
+		/* handled above, as these read their input from a file */
+		break;
 	case APP_SPLIT:
+	case APP_REVERSE_ZONES:
 	case APP_CHECK_ADDRESS:
 	case APP_SHOW_INFO:
 		/* These are handled lower into the info app */
@@ -1589,6 +1926,9 @@ int main(int argc, char **argv)
 			return 1;
 		}
 
+		if (random_count)
+			return show_random_networks(prefix, random_count, unique, flags) < 0 ? 1 : 0;
+
 		ipStr = generate_ip_network(prefix, flags);
 		if (ipStr == NULL) {
 			if (!beSilent)
@@ -1616,7 +1956,7 @@ int main(int argc, char **argv)
 		else if (flags & FLAG_IPV4)
 			family = AF_INET;
 
-		ipStr = get_ip_address(family, hostname);
+		ipStr = get_ip_address(family, hostname, dns_timeout);
 		if (ipStr == NULL) {
 			if (!beSilent)
 				fprintf(stderr,
@@ -1642,51 +1982,21 @@ int main(int argc, char **argv)
 		}
 	}
 
-	if (prefixStr == NULL && strchr(ipStr, '/') != NULL) {
-		prefixStr = strchr(ipStr, '/');
-		*prefixStr = '\0';	/* fix up ipStr */
-		prefixStr++;
-	}
-
-	if (prefixStr != NULL) {
-		prefix = str_to_prefix(&flags, prefixStr, 0);
-		if (prefix < 0) {
-			if (!beSilent)
-				fprintf(stderr,
-					"ipcalc: bad %s prefix: %s\n", (flags & FLAG_IPV6)?"IPv6":"IPv4", prefixStr);
-			return 1;
-		}
-	}
-
-	if (flags & FLAG_IPV6) {
-		r = get_ipv6_info(ipStr, prefix, &info, flags);
-	} else {
-		if ((flags & FLAG_SHOW_BROADCAST) || (flags & FLAG_SHOW_NETWORK) || (flags & FLAG_SHOW_PREFIX)) {
-			if (netmaskStr && prefix >= 0) {
-				if (!beSilent) {
-					fprintf(stderr,
-						"ipcalc: both netmask and prefix specified\n");
-					usage(1);
-				}
-				return 1;
-			}
-		}
+	if ((flags & FLAG_RESOLVE_HOST) && dns_timeout > 0 && resolver_init(1, dns_timeout, dns_cache_ttl) < 0)
+		return 1;
 
-		if (prefix == -1 && netmaskStr) {
-			prefix = ipv4_mask_to_int(netmaskStr);
-			if (prefix < 0) {
-				if (!beSilent)
-					fprintf(stderr,
-						"ipcalc: bad IPv4 prefix: %s\n", prefixStr);
-				return 1;
-			}
-		}
-		r = get_ipv4_info(ipStr, prefix, &info, flags);
-	}
+	/* only calculate the information that is going to be used */
+	info_flags = flags;
+	if (app == APP_CHECK_ADDRESS)
+		info_flags &= ~(FLAG_SHOW_MODERN_INFO|FLAG_SHOW_ALL_INFO|ENV_INFO_FLAGS);
+	else if (app == APP_SPLIT || app == APP_REVERSE_ZONES)
+		info_flags |= FLAG_SHOW_NETWORK|FLAG_SHOW_BROADCAST|FLAG_SHOW_NETMASK|FLAG_SHOW_MAXADDR;
 
+	r = get_info(ipStr, prefixStr, &info, &info_flags);
 	if (r < 0) {
 		return 1;
 	}
+	flags |= info_flags & FLAG_IPV6;
 
 	switch (app) {
 	case APP_SPLIT:
@@ -1698,12 +2008,13 @@ int main(int argc, char **argv)
 			return 1;
 		}
 
-		if (flags & FLAG_IPV6) {
-			show_split_networks_v6(splitPrefix, &info, flags);
-		} else {
-			show_split_networks_v4(splitPrefix, &info, flags);
-		}
-		return 0;
+		if (flags & FLAG_IPV6)
+			r = show_split_networks_v6(splitPrefix, &info, slice_opts ? &slice : NULL, flags);
+		else
+			r = show_split_networks_v4(splitPrefix, &info, slice_opts ? &slice : NULL, flags);
+		return r < 0 ? 1 : 0;
+	case APP_REVERSE_ZONES:
+		return show_reverse_zones(zonesStr, &info, ptr_stubs, flags) < 0 ? 1 : 0;
 	case APP_CHECK_ADDRESS:
 		return 0;
 	default:
@@ -1713,223 +2024,9 @@ int main(int argc, char **argv)
 	if (isatty(STDOUT_FILENO) != 0)
 		colors = 1;
 
-	/* we know what we want to display now, so display it. */
-	if (flags & FLAG_SHOW_MODERN_INFO) {
-		unsigned single_host = 0;
-
-		if (((flags & FLAG_IPV6) && info.prefix == 128) ||
-		    (!(flags & FLAG_IPV6) && info.prefix == 32)) {
-			single_host = 1;
-		}
-
-		output_start(&jsonchain);
-
-		if ((!randomStr || single_host) &&
-		    (single_host || strcmp(info.network, info.ip) != 0)) {
-			if (info.expanded_ip) {
-				default_printf(&jsonchain,"Full Address:\t", FULL_ADDRESS_NAME, "%s", info.expanded_ip);
-			}
-			default_printf(&jsonchain, "Address:\t", ADDRESS_NAME, "%s", info.ip);
-		}
-
-		if (single_host && info.hostname)
-			default_printf(&jsonchain, "Hostname:\t", HOSTNAME_NAME, "%s", info.hostname);
-
-		if (!single_host || (flags & FLAG_JSON)) {
-			if (! (flags & FLAG_JSON)) {
-				if (info.expanded_network) {
-					default_printf(&jsonchain, "Full Network:\t", FULL_NETWORK_NAME, "%s/%u", info.expanded_network, info.prefix);
-				}
-				default_printf(&jsonchain, "Network:\t", NETWORK_NAME, "%s/%u", info.network, info.prefix);
-				default_printf(&jsonchain, "Netmask:\t", NETMASK_NAME, "%s = %u", info.netmask, info.prefix);
-			}
-			else {
-				if (info.expanded_network) {
-					default_printf(&jsonchain, "Full Network:\t", FULL_NETWORK_NAME, "%s", info.expanded_network);
-				}
-				default_printf(&jsonchain, "Network:\t", NETWORK_NAME, "%s", info.network);
-				default_printf(&jsonchain, "Netmask:\t", NETMASK_NAME, "%s", info.netmask);
-				default_printf(&jsonchain, "Prefix:\t", PREFIX_NAME, "%u", info.prefix);
-			}
-
-
-			if (info.broadcast)
-				default_printf(&jsonchain, "Broadcast:\t", BROADCAST_NAME, "%s", info.broadcast);
-		}
-
-		if ((flags & FLAG_SHOW_ALL_INFO) && info.reverse_dns)
-			default_printf(&jsonchain, "Reverse DNS:\t", REVERSEDNS_NAME, "%s", info.reverse_dns);
-
-		if (!single_host || (flags & FLAG_JSON)) {
-			output_separate(&jsonchain);
-
-			if (info.type)
-				dist_printf(&jsonchain, "Address space:\t", ADDRSPACE_NAME, "%s", info.type);
-
-			if ((flags & FLAG_SHOW_ALL_INFO) && info.class)
-				dist_printf(&jsonchain, "Address class:\t", ADDRCLASS_NAME, "%s", info.class);
-
-			if (info.hostmin)
-				default_printf(&jsonchain, "HostMin:\t", MINADDR_NAME, "%s", info.hostmin);
-
-			if (info.hostmax)
-				default_printf(&jsonchain, "HostMax:\t", MAXADDR_NAME, "%s", info.hostmax);
-
-			if ((flags & FLAG_IPV6) && info.prefix < 112 && !(flags & FLAG_JSON))
-				default_printf(&jsonchain, "Hosts/Net:\t", ADDRESSES_NAME, "2^(%u) = %s", 128-info.prefix, info.hosts);
-			else
-				default_printf(&jsonchain, "Hosts/Net:\t", ADDRESSES_NAME, "%s", info.hosts);
-
-		} else {
-
-			if (info.type)
-				dist_printf(&jsonchain, "Address space:\t", ADDRSPACE_NAME, "%s", info.type);
-
-			if ((flags & FLAG_SHOW_ALL_INFO) && info.class)
-				dist_printf(&jsonchain, "Address class:\t", ADDRCLASS_NAME, "%s", info.class);
-		}
-
-		if (info.geoip_country || info.geoip_city || info.geoip_coord) {
-			output_separate(&jsonchain);
-
-			if (info.geoip_ccode)
-				dist_printf(&jsonchain, "Country code:\t", COUNTRYCODE_NAME, "%s", info.geoip_ccode);
-			if (info.geoip_country)
-				dist_printf(&jsonchain, "Country:\t", COUNTRY_NAME, "%s", info.geoip_country);
-			if (info.geoip_city)
-				dist_printf(&jsonchain, "City:\t\t", CITY_NAME, "%s", info.geoip_city);
-			if (info.geoip_coord)
-				dist_printf(&jsonchain, "Coordinates:\t", COORDINATES_NAME, "%s", info.geoip_coord);
-		}
-
-		output_stop(&jsonchain);
-
-	} else if (!(flags & FLAG_SHOW_MODERN_INFO)) {
-
-		if (flags & FLAG_SHOW_ADDRESS) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(ADDRESS_NAME"=");
-			}
-			printf("%s\n", info.ip);
-		}
-
-		if (flags & FLAG_SHOW_NETMASK) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(NETMASK_NAME"=");
-			}
-			printf("%s\n", info.netmask);
-		}
-
-		if (flags & FLAG_SHOW_PREFIX) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(PREFIX_NAME"=");
-			}
-			printf("%u\n", info.prefix);
-		}
-
-		if ((flags & FLAG_SHOW_BROADCAST) && !(flags & FLAG_IPV6)) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(BROADCAST_NAME"=");
-			}
-			printf("%s\n", info.broadcast);
-		}
-
-		if (flags & FLAG_SHOW_NETWORK) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(NETWORK_NAME"=");
-			}
-			printf("%s\n", info.network);
-		}
-
-		if (flags & FLAG_SHOW_REVERSE) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(REVERSEDNS_NAME"=");
-			}
-			printf("%s\n", info.reverse_dns);
-		}
-
-		if ((flags & FLAG_SHOW_MINADDR) && info.hostmin) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(MINADDR_NAME"=");
-			}
-			printf("%s\n", info.hostmin);
-		}
-
-		if ((flags & FLAG_SHOW_MAXADDR) && info.hostmax) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(MAXADDR_NAME"=");
-			}
-			printf("%s\n", info.hostmax);
-		}
-
-		if ((flags & FLAG_SHOW_ADDRSPACE) && info.type) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(ADDRSPACE_NAME"=");
-			}
-			if (strchr(info.type, ' ') != NULL)
-				printf("\"%s\"\n", info.type);
-			else
-				printf("%s\n", info.type);
-		}
-
-		if ((flags & FLAG_SHOW_ADDRESSES) && info.hosts[0]) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(ADDRESSES_NAME"=");
-			}
-			if (strchr(info.hosts, ' ') != NULL)
-				printf("\"%s\"\n", info.hosts);
-			else
-				printf("%s\n", info.hosts);
-		}
-
-		if ((flags & FLAG_RESOLVE_HOST) && info.hostname) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(HOSTNAME_NAME"=");
-			}
-			printf("%s\n", info.hostname);
-		}
-
-		if (flags & FLAG_RESOLVE_IP) {
-			if (! (flags & FLAG_NO_DECORATE)) {
-				printf(ADDRESS_NAME"=");
-			}
-			printf("%s\n", ipStr);
-		}
-
-		if ((flags & FLAG_SHOW_GEOIP) == FLAG_SHOW_GEOIP) {
-			if (info.geoip_ccode) {
-				if (! (flags & FLAG_NO_DECORATE)) {
-					printf(COUNTRYCODE_NAME"=");
-				}
-				printf("%s\n", info.geoip_ccode);
-			}
-			if (info.geoip_country) {
-				if (! (flags & FLAG_NO_DECORATE)) {
-					printf(COUNTRY_NAME"=");
-				}
-				if (strchr(info.geoip_country, ' ') != NULL)
-					printf("\"%s\"\n", info.geoip_country);
-				else
-					printf("%s\n", info.geoip_country);
-			}
-			if (info.geoip_city) {
-				if (! (flags & FLAG_NO_DECORATE)) {
-					printf(CITY_NAME"=");
-				}
-				if (strchr(info.geoip_city, ' ') != NULL) {
-					printf("\"%s\"\n", info.geoip_city);
-				} else {
-					printf("%s\n", info.geoip_city);
-				}
-			}
-			if (info.geoip_coord) {
-				if (! (flags & FLAG_NO_DECORATE)) {
-					printf(COORDINATES_NAME"=");
-				}
-				printf("\"%s\"\n", info.geoip_coord);
-			}
-		}
-	}
+	t = stats_start();
+	show_info(&info, ipStr, flags);
+	stats_lap(STATS_OUTPUT, &t);
 
 	return 0;
 }
@@ -21,16 +21,32 @@
 #define _IPCALC_H
 
 #include <stdarg.h> /* for va_list */
+#include <stdio.h> /* for FILE */
+#include <netinet/in.h> /* for INET6_ADDRSTRLEN */
+#include <netdb.h> /* for NI_MAXHOST */
+
+#include "libipcalc.h"
+
+struct ip_info_st;
+struct ipv6_num;
 
 #if defined(USE_GEOIP)
-  void geo_ip_lookup(const char *ip, char **country, char **ccode, char **city, char  **coord);
+  int geo_ip_lookup(const char *ip, struct ip_info_st *info);
+  void geo_cache_lookup(const char *ip, int family, const void *addr, struct ip_info_st *info);
+  void geo_cache_invalidate(void);
   int geo_setup(void);
+  int geo_init(void);
+  void geo_reload(void);
 # ifndef USE_RUNTIME_LINKING
 #   define geo_setup() 0
 # endif
 #elif defined(USE_MAXMIND)
-  void geo_ip_lookup(const char *ip, char **country, char **ccode, char **city, char  **coord);
+  int geo_ip_lookup(const char *ip, struct ip_info_st *info);
+  void geo_cache_lookup(const char *ip, int family, const void *addr, struct ip_info_st *info);
+  void geo_cache_invalidate(void);
   int geo_setup(void);
+  int geo_init(void);
+  void geo_reload(void);
 # ifndef USE_RUNTIME_LINKING
 #   define geo_setup() 0
 # endif
@@ -38,52 +54,93 @@
 # define geo_ipv4_lookup(x,y,z,w,a)
 # define geo_ipv6_lookup(x,y,z,w,a)
 # define geo_setup() -1
+# define geo_init() -1
+# define geo_reload() do {} while (0)
 #endif
 
 int __attribute__((__format__(printf, 2, 3))) safe_asprintf(char **strp, const char *fmt, ...);
 char __attribute__((warn_unused_result)) *safe_strdup(const char *str);
+void __attribute__((warn_unused_result)) *safe_realloc(void *p, size_t size);
 int safe_atoi(const char *s, int *ret_i);
+int safe_atou64(const char *s, uint64_t *ret);
+char *trim(char *str);
+const char *json_escape(char *buf, unsigned buf_size, const char *str);
+int parse_network(const char *str, unsigned flags, void *addr, unsigned *prefix);
+int str_to_prefix(unsigned *flags, const char *prefixStr, unsigned fix);
 
-char *calc_reverse_dns4(struct in_addr ip, unsigned prefix, struct in_addr net, struct in_addr bcast);
-char *calc_reverse_dns6(struct in6_addr *ip, unsigned prefix);
+char *calc_reverse_dns4(char *str, unsigned str_size, struct in_addr ip, unsigned prefix, struct in_addr net, struct in_addr bcast);
+char *calc_reverse_dns6(char *str, unsigned str_size, struct in6_addr *ip, unsigned prefix);
 
 uint32_t prefix2mask(int prefix);
 int ipv6_prefix_to_mask(unsigned prefix, struct in6_addr *mask);
 
 struct in_addr calc_network(struct in_addr addr, int prefix);
 
+unsigned format_octet(char *buf, unsigned octet);
+unsigned format_ipv4(char *buf, uint32_t addr);
+unsigned format_ipv6(char *buf, const struct in6_addr *addr);
+unsigned format_prefix(char *buf, unsigned prefix);
+unsigned format_uint128(char *buf, const struct ipv6_num *n);
+
+const char *parse_ipv4(const char *str, uint32_t *addr, int *prefix, unsigned abbrev);
+
 char *ipv4_prefix_to_hosts(char *hosts, unsigned hosts_size, unsigned prefix);
 char *ipv6_prefix_to_hosts(char *hosts, unsigned hosts_size, unsigned prefix);
 
+/* Maximum size of the reverse DNS zone name, including the terminating
+ * null, e.g., "x.x.(...).x.ip6.arpa." */
+#define REVERSE_DNS_SIZE 80
+
+/* Maximum size of the geo-information strings */
+#define GEO_INFO_SIZE 128
+
 typedef struct ip_info_st {
-	char *ip;
-	char *expanded_ip;
-	char *expanded_network;
-	char *reverse_dns;
-
-	char *network;
-	char *broadcast;	/* ipv4 only */
-	char *netmask;
-	char *hostname;
-	char *geoip_country;
-	char *geoip_ccode;
-	char *geoip_city;
-	char *geoip_coord;
+	char ip[INET6_ADDRSTRLEN];
+	char expanded_ip[INET6_ADDRSTRLEN];
+	char expanded_network[INET6_ADDRSTRLEN];
+	char reverse_dns[REVERSE_DNS_SIZE];
+
+	char network[INET6_ADDRSTRLEN];
+	char broadcast[INET_ADDRSTRLEN];	/* ipv4 only */
+	char netmask[INET6_ADDRSTRLEN];
+	char hostname[NI_MAXHOST];
+	char geoip_country[GEO_INFO_SIZE];
+	char geoip_ccode[GEO_INFO_SIZE];
+	char geoip_city[GEO_INFO_SIZE];
+	char geoip_coord[GEO_INFO_SIZE];
 	char hosts[64];		/* number of hosts in text */
 	unsigned prefix;
 
-	char *hostmin;
-	char *hostmax;
+	char hostmin[INET6_ADDRSTRLEN];
+	char hostmax[INET6_ADDRSTRLEN];
 	const char *type;
 	const char *class;
 } ip_info_st;
 
+/* The part of the networks of a split to print */
+typedef struct split_slice_st {
+	uint64_t offset;	/* the index of the first network */
+	uint64_t count;		/* the number of networks, or 0 for the rest */
+	unsigned shard;		/* when shards is not zero, the part from 1 to shards */
+	unsigned shards;	/* of that many equal parts to print instead */
+} split_slice_st;
+
 enum app_t {
 	APP_VERSION=1,
 	APP_CHECK_ADDRESS=1<<1,
 	APP_SHOW_INFO=1<<2,
 	APP_SPLIT=1<<3,
-	APP_DEAGGREGATE=1<<4
+	APP_DEAGGREGATE=1<<4,
+	APP_AGGREGATE=1<<5,
+	APP_LPM=1<<6,
+	APP_COMPILE_TABLE=1<<7,
+	APP_CONTAINS=1<<8,
+	APP_OVERLAPS=1<<9,
+	APP_REVERSE_ZONES=1<<10,
+	APP_SUBTRACT=1<<11,
+	APP_INTERSECT=1<<12,
+	APP_UNION=1<<13,
+	APP_SERVE=1<<14
 };
 
 #define FLAG_IPV6 (1<<1)
@@ -108,18 +165,121 @@ enum app_t {
 #define FLAG_SHOW_ADDRESS (1<<21)
 #define FLAG_JSON (1<<22)
 #define FLAG_RANDOM (1<<23)
+#define FLAG_BATCH (1<<24)
+#define FLAG_NDJSON (1<<25)
+#define FLAG_COUNT (1<<26)
+#define FLAG_STATS (1<<27)
 
 /* Flags that are modifying an existing option */
-#define FLAGS_TO_IGNORE (FLAG_IPV6|FLAG_IPV4|FLAG_GET_GEOIP|FLAG_NO_DECORATE|FLAG_JSON|FLAG_ASSUME_CLASS_PREFIX|(1<<16)|FLAG_RANDOM)
+#define FLAGS_TO_IGNORE (FLAG_IPV6|FLAG_IPV4|FLAG_GET_GEOIP|FLAG_NO_DECORATE|FLAG_JSON|FLAG_ASSUME_CLASS_PREFIX|(1<<16)|FLAG_RANDOM|FLAG_BATCH|FLAG_NDJSON|FLAG_COUNT|FLAG_STATS)
 #define FLAGS_TO_IGNORE_MASK (~FLAGS_TO_IGNORE)
 
 #define ENV_INFO_FLAGS (FLAG_SHOW_NETMASK|FLAG_SHOW_BROADCAST|FLAG_RESOLVE_IP|FLAG_RESOLVE_HOST|FLAG_SHOW_ADDRESS|FLAG_SHOW_REVERSE|FLAG_SHOW_GEOIP|FLAG_SHOW_ADDRSPACE|FLAG_SHOW_ADDRESSES|FLAG_SHOW_MAXADDR|FLAG_SHOW_MINADDR|FLAG_SHOW_PREFIX|FLAG_SHOW_NETWORK)
 #define ENV_INFO_MASK (~ENV_INFO_FLAGS)
 
-void show_split_networks_v4(unsigned split_prefix, const struct ip_info_st *info, unsigned flags);
-void show_split_networks_v6(unsigned split_prefix, const struct ip_info_st *info, unsigned flags);
+/* Whether the information shown by flag f is needed; everything is
+ * needed by the modern (default) output */
+#define NEED_INFO(flags, f) ((flags) & (FLAG_SHOW_MODERN_INFO|(f)))
+
+int get_info(char *ipStr, char *prefixStr, ip_info_st *info, unsigned *flags);
+void show_info(const ip_info_st *info, const char *ipStr, unsigned flags);
+
+/* Default and maximum number of concurrent --dns-queries */
+#define DEFAULT_DNS_QUERIES 16
+#define MAX_DNS_QUERIES 256
+
+/* Default --dns-cache-ttl in seconds */
+#define DEFAULT_DNS_CACHE_TTL 3600
+
+char *lookup_hostname(int family, const void *addr, char *hostname, unsigned hostname_size);
+int resolver_init(unsigned queries, unsigned timeout, unsigned ttl);
+void resolver_submit(int family, const void *addr);
+char *resolver_get_hostname(int family, const void *addr, char *hostname, unsigned hostname_size);
+
+/* Maximum number of --jobs threads */
+#define MAX_JOBS 256
+
+int show_batch(FILE *fp, unsigned flags, unsigned check_only, unsigned jobs);
+
+int show_split_networks_v4(unsigned split_prefix, const struct ip_info_st *info, const split_slice_st *slice, unsigned flags);
+int show_split_networks_v6(unsigned split_prefix, const struct ip_info_st *info, const split_slice_st *slice, unsigned flags);
+
+int deaggregate(char *str, unsigned flags);
+
+int show_reverse_zones(const char *zone_prefix, const struct ip_info_st *info, unsigned ptr_stubs, unsigned flags);
+
+char *generate_ip_network(unsigned prefix, unsigned flags);
+int show_random_networks(unsigned prefix, uint64_t count, unsigned unique, unsigned flags);
+
+void deaggregate_ipv4_range(unsigned *jsonchain, uint32_t base, uint32_t end);
+void deaggregate_ipv6_range(unsigned *jsonchain, const struct ipv6_num *first, const struct ipv6_num *end);
 
-void deaggregate(char *str, unsigned flags);
+int aggregate(FILE *fp, unsigned flags);
+
+int lpm_lookup(const char *table_file, FILE *fp, unsigned flags);
+int lpm_compile(const char *table_file, const char *out_file, unsigned flags);
+
+struct lpm_table;
+struct lpm_table *lpm_open(const char *table_file, unsigned flags);
+void lpm_close(struct lpm_table *table);
+int lpm_query(const struct lpm_table *table, const char *str, unsigned flags);
+
+int check_networks(const char *set_file, FILE *fp, unsigned contains, unsigned flags);
+
+struct network_set;
+struct network_set *network_set_open(const char *set_file, unsigned flags);
+void network_set_close(struct network_set *set);
+int network_set_query(const struct network_set *set, const char *str, unsigned contains, unsigned flags);
+
+int combine_networks(const char *set_file, FILE *fp, unsigned app, unsigned flags);
+
+int serve(const char *path, const char *lpm_file, const char *set_file, unsigned flags, unsigned jobs);
+
+/* The phases timed by --stats */
+enum {
+	STATS_PARSE,
+	STATS_COMPUTE,
+	STATS_DNS,
+	STATS_GEOIP,
+	STATS_OUTPUT,
+	STATS_WRITE,	/* the part of the output spent writing it out */
+	STATS_PHASES
+};
+
+struct stats_st {
+	uint64_t records;	/* the addresses processed */
+	uint64_t failures;	/* the addresses which could not be parsed */
+	uint64_t networks;	/* printed by a split or deaggregation */
+	uint64_t dns_lookups;
+	uint64_t dns_hits;
+	uint64_t geoip_lookups;
+	uint64_t geoip_hits;
+	uint64_t time[STATS_PHASES];	/* in nanoseconds */
+};
+
+extern unsigned stats_enabled;
+extern __thread struct stats_st stats;
+
+void stats_init(unsigned flags);
+void stats_merge(void);
+uint64_t stats_clock(void);
+
+/* Returns the start time of a phase, or 0 when not counting */
+static inline uint64_t stats_start(void)
+{
+	return stats_enabled ? stats_clock() : 0;
+}
+
+/* Adds the time since *t to the phase, and starts the next one */
+static inline void stats_lap(unsigned phase, uint64_t *t)
+{
+	if (stats_enabled) {
+		uint64_t now = stats_clock();
+
+		stats.time[phase] += now - *t;
+		*t = now;
+	}
+}
 
 #define KBLUE  "\x1B[34m"
 #define KMAG   "\x1B[35m"
@@ -129,6 +289,7 @@ void deaggregate(char *str, unsigned flags);
 #define JSON_NEXT  1
 #define JSON_ARRAY_FIRST 2
 #define JSON_ARRAY_NEXT  3
+#define JSON_RECORD_NEXT 4	/* NDJSON: the next field starts a record */
 
 void
 __attribute__ ((format(printf, 3, 4)))
@@ -146,8 +307,29 @@ void
 __attribute__ ((format(printf, 4, 5)))
 dist_printf(unsigned * const jsonfirst, const char *title, const char *jsontitle, const char *fmt, ...);
 
+void default_puts(unsigned * const jsonfirst, const char *title, const char *jsontitle, const char *str);
+
 void array_start(unsigned * const jsonfirst, const char *head, const char *json_head);
 void array_stop(unsigned * const jsonfirst);
+struct output_buf {
+	char *data;
+	size_t len;
+	size_t size;
+	FILE *fp;	/* where the data is flushed to; NULL keeps it in memory */
+	unsigned line_buffered;
+};
+
+void output_init(struct output_buf *out, FILE *fp);
+void output_set(struct output_buf *out);
+void output_flush(void);
+void output_write(const char *str, size_t len);
+void output_puts(const char *str);
+void output_vprintf(const char *fmt, va_list args);
+void
+__attribute__ ((format(printf, 1, 2)))
+output_printf(const char *fmt, ...);
+void output_addr(int family, const void *addr);
+int output_network(const ipcalc_net_st *net, void *jsonchain);
 void output_start(unsigned * const jsonfirst);
 void output_stop(unsigned * const jsonfirst);
 
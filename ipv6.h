@@ -18,12 +18,155 @@
 #ifndef IPV6_H
 #define IPV6_H
 
+#include <stdint.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
-void ipv6_add(struct in6_addr *a, const struct in6_addr *b);
-void ipv6_or1(struct in6_addr *a, unsigned bit);
-void ipv6_orm(struct in6_addr *a, unsigned bit);
-int ipv6_cmp(struct in6_addr *a, struct in6_addr *b);
+/* An IPv6 address as a 128-bit number. The arithmetic is done on this
+ * representation; it is converted from and to a struct in6_addr with
+ * ipv6_load() and ipv6_store() only when parsing and printing. */
+struct ipv6_num {
+	uint64_t hi;
+	uint64_t lo;
+};
+
+struct ipv6_num ipv6_load(const struct in6_addr *addr);
+void ipv6_store(struct in6_addr *addr, struct ipv6_num n);
+
+/* Returns a + b, modulo 2^128 */
+static inline struct ipv6_num ipv6_add(struct ipv6_num a, struct ipv6_num b)
+{
+	struct ipv6_num r;
+
+	r.lo = a.lo + b.lo;
+	r.hi = a.hi + b.hi + (r.lo < a.lo);
+	return r;
+}
+
+/* Returns a - b, modulo 2^128 */
+static inline struct ipv6_num ipv6_sub(struct ipv6_num a, struct ipv6_num b)
+{
+	struct ipv6_num r;
+
+	r.lo = a.lo - b.lo;
+	r.hi = a.hi - b.hi - (a.lo < b.lo);
+	return r;
+}
+
+/* Returns 1 if a is greater than b, 0 if equal, -1 if less */
+static inline int ipv6_cmp(struct ipv6_num a, struct ipv6_num b)
+{
+	if (a.hi != b.hi)
+		return a.hi > b.hi ? 1 : -1;
+	if (a.lo != b.lo)
+		return a.lo > b.lo ? 1 : -1;
+	return 0;
+}
+
+static inline struct ipv6_num ipv6_and(struct ipv6_num a, struct ipv6_num b)
+{
+	a.hi &= b.hi;
+	a.lo &= b.lo;
+	return a;
+}
+
+static inline struct ipv6_num ipv6_or(struct ipv6_num a, struct ipv6_num b)
+{
+	a.hi |= b.hi;
+	a.lo |= b.lo;
+	return a;
+}
+
+static inline struct ipv6_num ipv6_xor(struct ipv6_num a, struct ipv6_num b)
+{
+	a.hi ^= b.hi;
+	a.lo ^= b.lo;
+	return a;
+}
+
+static inline struct ipv6_num ipv6_not(struct ipv6_num a)
+{
+	a.hi = ~a.hi;
+	a.lo = ~a.lo;
+	return a;
+}
+
+/* Returns a shifted left by bits, which must be less than 128 */
+static inline struct ipv6_num ipv6_shl(struct ipv6_num a, unsigned bits)
+{
+	if (bits >= 64) {
+		a.hi = a.lo << (bits - 64);
+		a.lo = 0;
+	} else if (bits > 0) {
+		a.hi = (a.hi << bits) | (a.lo >> (64 - bits));
+		a.lo <<= bits;
+	}
+	return a;
+}
+
+/* Returns a shifted right by bits, which must be less than 128 */
+static inline struct ipv6_num ipv6_shr(struct ipv6_num a, unsigned bits)
+{
+	if (bits >= 64) {
+		a.lo = a.hi >> (bits - 64);
+		a.hi = 0;
+	} else if (bits > 0) {
+		a.lo = (a.lo >> bits) | (a.hi << (64 - bits));
+		a.hi >>= bits;
+	}
+	return a;
+}
+
+/* Returns a number with only the bit set, which must be less than 128 */
+static inline struct ipv6_num ipv6_bit(unsigned bit)
+{
+	struct ipv6_num r;
+
+	r.hi = bit >= 64 ? UINT64_C(1) << (bit - 64) : 0;
+	r.lo = bit >= 64 ? 0 : UINT64_C(1) << bit;
+	return r;
+}
+
+/* Returns a number with the lowest bits set, for 0 to 128 bits */
+static inline struct ipv6_num ipv6_low_mask(unsigned bits)
+{
+	struct ipv6_num r;
+
+	r.hi = bits >= 128 ? UINT64_MAX : bits > 64 ? (UINT64_C(1) << (bits - 64)) - 1 : 0;
+	r.lo = bits >= 64 ? UINT64_MAX : (UINT64_C(1) << bits) - 1;
+	return r;
+}
+
+/* Returns the number of trailing zero bits, or 128 if a is zero */
+static inline unsigned ipv6_ctz(struct ipv6_num a)
+{
+	if (a.lo)
+		return __builtin_ctzll(a.lo);
+	if (a.hi)
+		return 64 + __builtin_ctzll(a.hi);
+	return 128;
+}
+
+/* Returns the number of leading zero bits, or 128 if a is zero */
+static inline unsigned ipv6_clz(struct ipv6_num a)
+{
+	if (a.hi)
+		return __builtin_clzll(a.hi);
+	if (a.lo)
+		return 64 + __builtin_clzll(a.lo);
+	return 128;
+}
+
+/* Returns the number of set bits */
+static inline unsigned ipv6_popcount(struct ipv6_num a)
+{
+	return __builtin_popcountll(a.hi) + __builtin_popcountll(a.lo);
+}
+
+/* Returns the netmask of the prefix, for 0 to 128 */
+static inline struct ipv6_num ipv6_prefix_mask(unsigned prefix)
+{
+	return ipv6_not(ipv6_low_mask(128 - prefix));
+}
 
 #endif
@@ -0,0 +1,1363 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The calculations of libipcalc. Nothing here uses the options or the
+ * output of the command line tool; see libipcalc.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "libipcalc.h"
+#include "ipcalc.h"
+#include "ipv6.h"
+#include "addrspace.h"
+
+/* The netmask of every IPv4 prefix, in host byte order */
+static const uint32_t ipv4_masks[33] = {
+	0x00000000, 0x80000000, 0xc0000000, 0xe0000000,
+	0xf0000000, 0xf8000000, 0xfc000000, 0xfe000000,
+	0xff000000, 0xff800000, 0xffc00000, 0xffe00000,
+	0xfff00000, 0xfff80000, 0xfffc0000, 0xfffe0000,
+	0xffff0000, 0xffff8000, 0xffffc000, 0xffffe000,
+	0xfffff000, 0xfffff800, 0xfffffc00, 0xfffffe00,
+	0xffffff00, 0xffffff80, 0xffffffc0, 0xffffffe0,
+	0xfffffff0, 0xfffffff8, 0xfffffffc, 0xfffffffe,
+	0xffffffff
+};
+
+/* The number of usable addresses of every IPv4 prefix; the /31 and /32
+ * networks have no network and broadcast addresses (RFC 3021) */
+static const char *const ipv4_hosts[33] = {
+	"4294967294", "2147483646", "1073741822", "536870910",
+	"268435454", "134217726", "67108862", "33554430",
+	"16777214", "8388606", "4194302", "2097150",
+	"1048574", "524286", "262142", "131070",
+	"65534", "32766", "16382", "8190",
+	"4094", "2046", "1022", "510",
+	"254", "126", "62", "30",
+	"14", "6", "2", "2",
+	"1"
+};
+
+/*!
+  \fn uint32_t prefix2mask(int bits)
+  \brief creates a netmask from a specified number of bits
+
+  This function converts a prefix length to a netmask.  As CIDR (classless
+  internet domain internet domain routing) has taken off, more an more IP
+  addresses are being specified in the format address/prefix
+  (i.e. 192.168.2.3/24, with a corresponding netmask 255.255.255.0).  If you
+  need to see what netmask corresponds to the prefix part of the address, this
+  is the function.  See also \ref mask2prefix.
+
+  \param prefix is the number of bits to create a mask for, from 0 to 32.
+  \return a network mask, in network byte order.
+*/
+uint32_t prefix2mask(int prefix)
+{
+	return htonl(ipv4_masks[prefix]);
+}
+
+/*!
+  \fn struct in_addr calc_broadcast(struct in_addr addr, int prefix)
+
+  \brief calculate broadcast address given an IP address and a prefix length.
+
+  \param addr an IP address in network byte order.
+  \param prefix a prefix length.
+
+  \return the calculated broadcast address for the network, in network byte
+  order.
+*/
+static struct in_addr calc_broadcast(struct in_addr addr, int prefix)
+{
+	struct in_addr mask;
+	struct in_addr broadcast;
+
+	mask.s_addr = prefix2mask(prefix);
+
+	memset(&broadcast, 0, sizeof(broadcast));
+
+	/* Follow RFC3021 and set the limited broadcast address on /31 */
+	if (prefix == 31)
+		broadcast.s_addr = htonl(0xFFFFFFFF);
+	else
+		broadcast.s_addr = (addr.s_addr & mask.s_addr) | ~mask.s_addr;
+
+	return broadcast;
+}
+
+/*!
+  \fn struct in_addr calc_network(struct in_addr addr, int prefix)
+  \brief calculates the network address for a specified address and prefix.
+
+  \param addr an IP address, in network byte order
+  \param prefix the network prefix
+  \return the base address of the network that addr is associated with, in
+  network byte order.
+*/
+struct in_addr calc_network(struct in_addr addr, int prefix)
+{
+	struct in_addr mask;
+	struct in_addr network;
+
+	mask.s_addr = prefix2mask(prefix);
+
+	memset(&network, 0, sizeof(network));
+	network.s_addr = addr.s_addr & mask.s_addr;
+	return network;
+}
+
+/*!
+  \fn int mask2prefix(struct in_addr mask)
+  \brief calculates the number of bits masked off by a netmask.
+
+  This function calculates the significant bits in an IP address as specified by
+  a netmask.  See also \ref prefix2mask.
+
+  \param mask is the netmask, specified as an struct in_addr in network byte order.
+  \return the number of significant bits, or -1 if they are not contiguous.  */
+static int mask2prefix(struct in_addr mask)
+{
+	uint32_t i = ntohl(mask.s_addr);
+
+	if (i == 0)
+		return 0;
+
+	/* the bits are contiguous when they are all ones after the trailing zeros */
+	i >>= __builtin_ctz(i);
+	if (i & (i + 1))
+		return -1;
+
+	return __builtin_popcount(i);
+}
+
+/* Returns powers of two in textual format */
+static const char *p2_table(unsigned pow)
+{
+	static const char *pow2[] = {
+		"1",
+		"2",
+		"4",
+		"8",
+		"16",
+		"32",
+		"64",
+		"128",
+		"256",
+		"512",
+		"1024",
+		"2048",
+		"4096",
+		"8192",
+		"16384",
+		"32768",
+		"65536",
+		"131072",
+		"262144",
+		"524288",
+		"1048576",
+		"2097152",
+		"4194304",
+		"8388608",
+		"16777216",
+		"33554432",
+		"67108864",
+		"134217728",
+		"268435456",
+		"536870912",
+		"1073741824",
+		"2147483648",
+		"4294967296",
+		"8589934592",
+		"17179869184",
+		"34359738368",
+		"68719476736",
+		"137438953472",
+		"274877906944",
+		"549755813888",
+		"1099511627776",
+		"2199023255552",
+		"4398046511104",
+		"8796093022208",
+		"17592186044416",
+		"35184372088832",
+		"70368744177664",
+		"140737488355328",
+		"281474976710656",
+		"562949953421312",
+		"1125899906842624",
+		"2251799813685248",
+		"4503599627370496",
+		"9007199254740992",
+		"18014398509481984",
+		"36028797018963968",
+		"72057594037927936",
+		"144115188075855872",
+		"288230376151711744",
+		"576460752303423488",
+		"1152921504606846976",
+		"2305843009213693952",
+		"4611686018427387904",
+		"9223372036854775808",
+		"18446744073709551616",
+		"36893488147419103232",
+		"73786976294838206464",
+		"147573952589676412928",
+		"295147905179352825856",
+		"590295810358705651712",
+		"1180591620717411303424",
+		"2361183241434822606848",
+		"4722366482869645213696",
+		"9444732965739290427392",
+		"18889465931478580854784",
+		"37778931862957161709568",
+		"75557863725914323419136",
+		"151115727451828646838272",
+		"302231454903657293676544",
+		"604462909807314587353088",
+		"1208925819614629174706176",
+		"2417851639229258349412352",
+		"4835703278458516698824704",
+		"9671406556917033397649408",
+		"19342813113834066795298816",
+		"38685626227668133590597632",
+		"77371252455336267181195264",
+		"154742504910672534362390528",
+		"309485009821345068724781056",
+		"618970019642690137449562112",
+		"1237940039285380274899124224",
+		"2475880078570760549798248448",
+		"4951760157141521099596496896",
+		"9903520314283042199192993792",
+		"19807040628566084398385987584",
+		"39614081257132168796771975168",
+		"79228162514264337593543950336",
+		"158456325028528675187087900672",
+		"316912650057057350374175801344",
+		"633825300114114700748351602688",
+		"1267650600228229401496703205376",
+		"2535301200456458802993406410752",
+		"5070602400912917605986812821504",
+		"10141204801825835211973625643008",
+		"20282409603651670423947251286016",
+		"40564819207303340847894502572032",
+		"81129638414606681695789005144064",
+		"162259276829213363391578010288128",
+		"324518553658426726783156020576256",
+		"649037107316853453566312041152512",
+		"1298074214633706907132624082305024",
+		"2596148429267413814265248164610048",
+		"5192296858534827628530496329220096",
+		"10384593717069655257060992658440192",
+		"20769187434139310514121985316880384",
+		"41538374868278621028243970633760768",
+		"83076749736557242056487941267521536",
+		"166153499473114484112975882535043072",
+		"332306998946228968225951765070086144",
+		"664613997892457936451903530140172288",
+		"1329227995784915872903807060280344576",
+		"2658455991569831745807614120560689152",
+		"5316911983139663491615228241121378304",
+		"10633823966279326983230456482242756608",
+		"21267647932558653966460912964485513216",
+		"42535295865117307932921825928971026432",
+		"85070591730234615865843651857942052864",
+		"170141183460469231731687303715884105728",
+		"340282366920938463463374607431768211456",
+	};
+	if (pow <= 128)
+		return pow2[pow];
+	return "";
+}
+
+/* the entries come from ipv4-address-space.txt, see gen-addrspace.c */
+static const char *ipv4_net_to_type(struct in_addr net, unsigned prefix)
+{
+	uint32_t addr = ntohl(net.s_addr);
+	unsigned byte1 = addr >> 24;
+	unsigned i;
+
+	for (i = ipv4_types_index[byte1]; i < ipv4_types_index[byte1 + 1]; i++) {
+		const struct ipv4_type_entry *e = &ipv4_types[i];
+
+		if ((addr & ntohl(prefix2mask(e->len))) == e->net &&
+		    (e->any || prefix >= e->len))
+			return e->name;
+	}
+
+	return "Internet";
+}
+
+static
+const char *ipv4_net_to_class(struct in_addr net)
+{
+	unsigned byte1 = (ntohl(net.s_addr) >> 24) & 0xff;
+
+	if (byte1 < 128) {
+		return "Class A";
+	}
+
+	if (byte1 >= 128 && byte1 < 192) {
+		return "Class B";
+	}
+
+	if (byte1 >= 192 && byte1 < 224) {
+		return "Class C";
+	}
+
+	if (byte1 >= 224 && byte1 < 239) {
+		return "Class D";
+	}
+
+	return "Class E";
+}
+
+/*!
+  \fn unsigned ipcalc_class_prefix(struct in_addr addr)
+  \brief returns the prefix of the legacy class of an IPv4 address
+
+  \param addr the address, in network byte order.
+
+  \return the prefix, 8, 16 or 24.
+*/
+unsigned ipcalc_class_prefix(struct in_addr net)
+{
+	unsigned byte1 = (ntohl(net.s_addr) >> 24) & 0xff;
+
+	if (byte1 < 128) {
+		return 8;
+	}
+
+	if (byte1 >= 128 && byte1 < 192) {
+		return 16;
+	}
+
+	if (byte1 >= 192 && byte1 < 224) {
+		return 24;
+	}
+
+	return 24;
+}
+
+int ipv6_prefix_to_mask(unsigned prefix, struct in6_addr *mask)
+{
+	struct in6_addr in6;
+	int i, j;
+
+	if (prefix > 128)
+		return -1;
+
+	memset(&in6, 0x0, sizeof(in6));
+	for (i = prefix, j = 0; i > 0; i -= 8, j++) {
+		if (i >= 8) {
+			in6.s6_addr[j] = 0xff;
+		} else {
+			in6.s6_addr[j] = (unsigned long)(0xffU << (8 - i));
+		}
+	}
+
+	memcpy(mask, &in6, sizeof(*mask));
+	return 0;
+}
+
+/* the entries come from ipv6-address-space.txt, see gen-addrspace.c */
+static const char *ipv6_net_to_type(struct in6_addr *net, int prefix)
+{
+	unsigned byte1 = net->s6_addr[0];
+	unsigned i;
+
+	for (i = ipv6_types_index[byte1]; i < ipv6_types_index[byte1 + 1]; i++) {
+		const struct ipv6_type_entry *e = &ipv6_types[i];
+		unsigned bytes = e->len / 8;
+		unsigned bits = e->len % 8;
+
+		if (!e->any && prefix < e->len)
+			continue;
+
+		if (memcmp(net->s6_addr, e->net, bytes) != 0)
+			continue;
+
+		if (bits && ((net->s6_addr[bytes] ^ e->net[bytes]) & (0xff00 >> bits)))
+			continue;
+
+		return e->name;
+	}
+
+	return "Reserved";
+}
+
+/* Copies the formatted string to the buffer of the caller */
+static int copy_out(char *buf, size_t size, const char *str, size_t len)
+{
+	if (len >= size)
+		return IPCALC_E_BUFFER_TOO_SMALL;
+	memcpy(buf, str, len + 1);
+	return len;
+}
+
+static unsigned family_width(int family)
+{
+	return family == AF_INET6 ? 128 : 32;
+}
+
+/* An address as a number; IPv4 addresses are in the low 32 bits */
+static struct ipv6_num addr_to_num(int family, const void *addr)
+{
+	struct ipv6_num n = {0, 0};
+
+	if (family == AF_INET6)
+		return ipv6_load(addr);
+
+	n.lo = ntohl(((const struct in_addr *)addr)->s_addr);
+	return n;
+}
+
+static void num_to_addr(int family, struct ipv6_num n, ipcalc_addr_un *addr)
+{
+	if (family == AF_INET6)
+		ipv6_store(&addr->v6, n);
+	else
+		addr->v4.s_addr = htonl(n.lo);
+}
+
+static inline void put_be64(unsigned char *p, uint64_t v)
+{
+	int i;
+
+	for (i = 7; i >= 0; i--) {
+		p[i] = v & 0xff;
+		v >>= 8;
+	}
+}
+
+static inline struct ipv6_num get_num(const uint64_t v[2])
+{
+	struct ipv6_num n = {v[0], v[1]};
+
+	return n;
+}
+
+static inline void set_num(uint64_t v[2], struct ipv6_num n)
+{
+	v[0] = n.hi;
+	v[1] = n.lo;
+}
+
+/*!
+  \fn const char *ipcalc_strerror(int err)
+  \brief returns a description of an error code of the library
+
+  \param err one of the IPCALC_E_* codes.
+
+  \return a static string.
+*/
+const char *ipcalc_strerror(int err)
+{
+	switch (err) {
+	case IPCALC_OK:
+		return "success";
+	case IPCALC_E_INVALID_ADDRESS:
+		return "invalid address";
+	case IPCALC_E_INVALID_PREFIX:
+		return "invalid prefix";
+	case IPCALC_E_INVALID_RANGE:
+		return "invalid range";
+	case IPCALC_E_BUFFER_TOO_SMALL:
+		return "buffer too small";
+	case IPCALC_E_INVALID_ARGUMENT:
+		return "invalid argument";
+	}
+	return "unknown error";
+}
+
+/*!
+  \fn int ipcalc_parse_prefix(const char *str, int family)
+  \brief parses a prefix length, or an IPv4 netmask
+
+  \param str the prefix, or for AF_INET a netmask such as 255.255.255.0.
+  \param family AF_INET or AF_INET6.
+
+  \return the prefix, or a negative error code.
+*/
+int ipcalc_parse_prefix(const char *str, int family)
+{
+	char *end;
+	long l;
+
+	if (family != AF_INET && family != AF_INET6)
+		return IPCALC_E_INVALID_ARGUMENT;
+
+	if (family == AF_INET && strchr(str, '.')) {
+		struct in_addr mask;
+
+		if (inet_pton(AF_INET, str, &mask) <= 0)
+			return IPCALC_E_INVALID_PREFIX;
+		l = mask2prefix(mask);
+	} else {
+		errno = 0;
+		l = strtol(str, &end, 0);
+		if (end == str || *end || errno)
+			return IPCALC_E_INVALID_PREFIX;
+	}
+
+	if (l < 0 || l > family_width(family))
+		return IPCALC_E_INVALID_PREFIX;
+	return l;
+}
+
+/*!
+  \fn int ipcalc_parse_net(const char *str, const ipcalc_opts_st *opts, ipcalc_net_st *net)
+  \brief parses a network in the ADDRESS[/PREFIX] form
+
+  The address is IPv6 when IPCALC_OPT_IPV6 is set, or when it contains a
+  ':' and IPCALC_OPT_IPV4 is not set. The prefix may also be given as an
+  IPv4 netmask, and when omitted it is the full length of the address,
+  or the class prefix with IPCALC_OPT_CLASS_PREFIX. An IPv4 address
+  followed by a prefix may be abbreviated, as in 172.16/12. The host bits
+  of the address are kept.
+
+  \param str the network.
+  \param opts the options, or NULL for none.
+  \param net where to store the network.
+
+  \return IPCALC_OK, or a negative error code.
+*/
+int ipcalc_parse_net(const char *str, const ipcalc_opts_st *opts, ipcalc_net_st *net)
+{
+	unsigned flags = opts ? opts->flags : 0;
+	const char *slash, *end;
+	char buf[INET6_ADDRSTRLEN];
+	uint32_t ip;
+	size_t len;
+	int p;
+
+	memset(net, 0, sizeof(*net));
+
+	if ((flags & IPCALC_OPT_IPV6) ||
+	    ((flags & IPCALC_OPT_IPV4) == 0 && strchr(str, ':') != NULL)) {
+		net->family = AF_INET6;
+
+		slash = strchr(str, '/');
+		len = slash ? (size_t)(slash - str) : strlen(str);
+		if (len >= sizeof(buf))
+			return IPCALC_E_INVALID_ADDRESS;
+		memcpy(buf, str, len);
+		buf[len] = 0;
+
+		if (inet_pton(AF_INET6, buf, &net->addr.v6) <= 0)
+			return IPCALC_E_INVALID_ADDRESS;
+
+		p = slash ? ipcalc_parse_prefix(slash + 1, AF_INET6) : 128;
+		if (p < 0)
+			return p;
+		net->prefix = p;
+		return IPCALC_OK;
+	}
+
+	/* the common IPv4 forms are parsed in a single pass */
+	net->family = AF_INET;
+	end = parse_ipv4(str, &ip, &p, 0);
+	if (end == NULL || (*end != 0 && *end != '/'))
+		return IPCALC_E_INVALID_ADDRESS;
+	net->addr.v4.s_addr = htonl(ip);
+
+	/* a netmask; parse_ipv4() has accepted the address */
+	if (*end == '/')
+		p = ipcalc_parse_prefix(end + 1, AF_INET);
+	else if (p < 0)
+		p = (flags & IPCALC_OPT_CLASS_PREFIX) ? ipcalc_class_prefix(net->addr.v4) : 32;
+	if (p < 0)
+		return p;
+	net->prefix = p;
+	return IPCALC_OK;
+}
+
+/*!
+  \fn int ipcalc_info(const ipcalc_net_st *net, ipcalc_info_st *info)
+  \brief calculates the addresses of a network
+
+  \param net the network.
+  \param info where to store the addresses.
+
+  \return IPCALC_OK, or a negative error code.
+*/
+int ipcalc_info(const ipcalc_net_st *net, ipcalc_info_st *info)
+{
+	unsigned prefix = net->prefix;
+	unsigned i;
+
+	memset(info, 0, sizeof(*info));
+
+	if (net->family != AF_INET && net->family != AF_INET6)
+		return IPCALC_E_INVALID_ARGUMENT;
+	if (prefix > family_width(net->family))
+		return IPCALC_E_INVALID_PREFIX;
+
+	info->family = net->family;
+	info->prefix = prefix;
+	info->address = net->addr;
+
+	if (net->family == AF_INET6) {
+		const struct in6_addr *ip6 = &net->addr.v6;
+		struct in6_addr *mask = &info->netmask.v6;
+
+		ipv6_prefix_to_mask(prefix, mask);
+		for (i = 0; i < sizeof(struct in6_addr); i++) {
+			info->network.v6.s6_addr[i] = ip6->s6_addr[i] & mask->s6_addr[i];
+			info->maxaddr.v6.s6_addr[i] = ip6->s6_addr[i] | ~mask->s6_addr[i];
+		}
+		info->minaddr = info->network;
+		return IPCALC_OK;
+	}
+
+	info->netmask.v4.s_addr = prefix2mask(prefix);
+	info->network.v4 = calc_network(net->addr.v4, prefix);
+	info->broadcast.v4 = calc_broadcast(net->addr.v4, prefix);
+
+	info->minaddr = info->network;
+	info->maxaddr = info->network;
+	if (prefix < 32) {
+		if (prefix <= 30)
+			info->minaddr.v4.s_addr = htonl(ntohl(info->minaddr.v4.s_addr) | 1);
+
+		info->maxaddr.v4.s_addr |= ~info->netmask.v4.s_addr;
+		if (prefix <= 30)
+			info->maxaddr.v4.s_addr = htonl(ntohl(info->maxaddr.v4.s_addr) - 1);
+	}
+
+	return IPCALC_OK;
+}
+
+/*!
+  \fn const char *ipcalc_addrspace(const ipcalc_net_st *net)
+  \brief returns the name of the address space the network belongs to
+
+  \param net the network.
+
+  \return a static string, as in the IANA registries.
+*/
+const char *ipcalc_addrspace(const ipcalc_net_st *net)
+{
+	if (net->family == AF_INET6) {
+		struct in6_addr network;
+		struct ipv6_num n = addr_to_num(AF_INET6, &net->addr.v6);
+
+		ipv6_store(&network, ipv6_and(n, ipv6_prefix_mask(net->prefix)));
+		return ipv6_net_to_type(&network, net->prefix);
+	}
+
+	return ipv4_net_to_type(calc_network(net->addr.v4, net->prefix), net->prefix);
+}
+
+/*!
+  \fn const char *ipcalc_class(const ipcalc_net_st *net)
+  \brief returns the legacy class of an IPv4 network
+
+  \param net the network.
+
+  \return a static string, or NULL for an IPv6 network.
+*/
+const char *ipcalc_class(const ipcalc_net_st *net)
+{
+	if (net->family != AF_INET)
+		return NULL;
+	return ipv4_net_to_class(calc_network(net->addr.v4, net->prefix));
+}
+
+/*!
+  \fn int ipcalc_hosts(int family, unsigned prefix, char *buf, size_t size)
+  \brief formats the number of usable addresses of a network
+
+  \param family AF_INET or AF_INET6.
+  \param prefix the prefix of the network.
+  \param buf the output buffer; IPCALC_HOSTS_SIZE bytes are always enough.
+  \param size the size of the buffer.
+
+  \return the length of the string, or a negative error code.
+*/
+int ipcalc_hosts(int family, unsigned prefix, char *buf, size_t size)
+{
+	const char *hosts;
+
+	if (family != AF_INET && family != AF_INET6)
+		return IPCALC_E_INVALID_ARGUMENT;
+	if (prefix > family_width(family))
+		return IPCALC_E_INVALID_PREFIX;
+
+	hosts = (family == AF_INET6) ? p2_table(128 - prefix) : ipv4_hosts[prefix];
+	return copy_out(buf, size, hosts, strlen(hosts));
+}
+
+/*!
+  \fn int ipcalc_reverse_dns(const ipcalc_net_st *net, char *buf, size_t size)
+  \brief formats the reverse DNS zone of a network
+
+  IPv4 networks need a prefix of at least 8 and IPv6 networks a prefix
+  which is a multiple of 4.
+
+  \param net the network.
+  \param buf the output buffer.
+  \param size the size of the buffer.
+
+  \return the length of the zone name, or a negative error code.
+*/
+int ipcalc_reverse_dns(const ipcalc_net_st *net, char *buf, size_t size)
+{
+	ipcalc_info_st info;
+	int ret;
+
+	ret = ipcalc_info(net, &info);
+	if (ret < 0)
+		return ret;
+
+	if (net->family == AF_INET6) {
+		if (net->prefix % 4 != 0)
+			return IPCALC_E_INVALID_PREFIX;
+		if (calc_reverse_dns6(buf, size, &info.network.v6, net->prefix) == NULL)
+			return IPCALC_E_BUFFER_TOO_SMALL;
+	} else {
+		if (net->prefix < 8)
+			return IPCALC_E_INVALID_PREFIX;
+		if (calc_reverse_dns4(buf, size, info.network.v4, net->prefix,
+				      info.network.v4, info.broadcast.v4) == NULL)
+			return IPCALC_E_BUFFER_TOO_SMALL;
+	}
+
+	return strlen(buf);
+}
+
+static int format_address(int family, const void *addr, char *buf)
+{
+	if (family == AF_INET)
+		return format_ipv4(buf, ntohl(((const struct in_addr *)addr)->s_addr));
+	if (family == AF_INET6)
+		return format_ipv6(buf, addr);
+	return IPCALC_E_INVALID_ARGUMENT;
+}
+
+/*!
+  \fn int ipcalc_format_addr(int family, const void *addr, char *buf, size_t size)
+  \brief formats an address as inet_ntop() does
+
+  \param family AF_INET or AF_INET6.
+  \param addr the address, a struct in_addr or a struct in6_addr.
+  \param buf the output buffer; IPCALC_NET_SIZE bytes are always enough.
+  \param size the size of the buffer.
+
+  \return the length of the string, or a negative error code.
+*/
+int ipcalc_format_addr(int family, const void *addr, char *buf, size_t size)
+{
+	char tmp[IPCALC_NET_SIZE];
+	int len;
+
+	if (size >= sizeof(tmp))
+		return format_address(family, addr, buf);
+
+	len = format_address(family, addr, tmp);
+	if (len < 0)
+		return len;
+	return copy_out(buf, size, tmp, len);
+}
+
+/*!
+  \fn int ipcalc_format_net(const ipcalc_net_st *net, char *buf, size_t size)
+  \brief formats a network in the ADDRESS/PREFIX form
+
+  \param net the network; the host bits of the address are printed.
+  \param buf the output buffer; IPCALC_NET_SIZE bytes are always enough.
+  \param size the size of the buffer.
+
+  \return the length of the string, or a negative error code.
+*/
+int ipcalc_format_net(const ipcalc_net_st *net, char *buf, size_t size)
+{
+	char tmp[IPCALC_NET_SIZE];
+	char *p = (size >= sizeof(tmp)) ? buf : tmp;
+	int len;
+
+	if (net->prefix > family_width(net->family))
+		return IPCALC_E_INVALID_PREFIX;
+
+	len = format_address(net->family, &net->addr, p);
+	if (len < 0)
+		return len;
+	len += format_prefix(p + len, net->prefix);
+
+	return (p == buf) ? len : copy_out(buf, size, tmp, len);
+}
+
+/* Returns the index of the first network of the i-th of n shards of the
+ * 2^bits networks, floor(i * 2^bits / n), by long division */
+static struct ipv6_num shard_start(unsigned i, unsigned n, unsigned bits)
+{
+	struct ipv6_num q = {0, 0};
+	uint64_t r = i;
+	unsigned k;
+
+	for (k = 0; k < bits; k++) {
+		r <<= 1;
+		q = ipv6_shl(q, 1);
+		if (r >= n) {
+			r -= n;
+			q = ipv6_or(q, ipv6_bit(0));
+		}
+	}
+	return q;
+}
+
+/* Returns the address of the network with the index in the split */
+static struct ipv6_num split_addr(const ipcalc_split_st *it, struct ipv6_num index)
+{
+	/* a split to /0 has the single network ::/0 */
+	if (it->shift >= 128)
+		return get_num(it->base);
+	return ipv6_add(get_num(it->base), ipv6_shl(index, it->shift));
+}
+
+/* Restarts the iteration over the networks from first to last */
+static void split_set(ipcalc_split_st *it, struct ipv6_num first, struct ipv6_num last)
+{
+	set_num(it->first, first);
+	set_num(it->last, last);
+	set_num(it->next, split_addr(it, first));
+	set_num(it->end, split_addr(it, last));
+	it->empty = it->done = 0;
+}
+
+/*!
+  \fn int ipcalc_split_init(ipcalc_split_st *it, const ipcalc_net_st *net, unsigned prefix)
+  \brief starts the iteration over the networks of the given prefix in a network
+
+  \param it the iteration state.
+  \param net the network to split.
+  \param prefix the prefix of the networks, at least the prefix of net.
+
+  \return IPCALC_OK, or a negative error code.
+*/
+int ipcalc_split_init(ipcalc_split_st *it, const ipcalc_net_st *net, unsigned prefix)
+{
+	unsigned width;
+	struct ipv6_num mask;
+
+	if (net->family != AF_INET && net->family != AF_INET6)
+		return IPCALC_E_INVALID_ARGUMENT;
+	width = family_width(net->family);
+	if (net->prefix > width || prefix > width || prefix < net->prefix)
+		return IPCALC_E_INVALID_PREFIX;
+
+	memset(it, 0, sizeof(*it));
+	it->family = net->family;
+	it->prefix = prefix;
+	it->bits = prefix - net->prefix;
+	it->shift = width - prefix;
+
+	mask = ipv6_and(ipv6_low_mask(width), ipv6_not(ipv6_low_mask(width - net->prefix)));
+	set_num(it->base, ipv6_and(addr_to_num(net->family, &net->addr), mask));
+	if (it->shift < 128)
+		set_num(it->step, ipv6_bit(it->shift));
+
+	split_set(it, ipv6_low_mask(0), ipv6_low_mask(it->bits));
+	return IPCALC_OK;
+}
+
+/*!
+  \fn int ipcalc_split_slice(ipcalc_split_st *it, uint64_t offset, uint64_t count)
+  \brief restricts the iteration to a part of the networks of the split
+
+  The iteration restarts at the first network of the part, which replaces
+  any part previously set.
+
+  \param it the iteration state, as set by ipcalc_split_init().
+  \param offset the index of the first network of the part.
+  \param count the number of networks of the part, or 0 for all the rest.
+
+  \return IPCALC_OK, or IPCALC_E_INVALID_RANGE if offset is past the last network.
+*/
+int ipcalc_split_slice(ipcalc_split_st *it, uint64_t offset, uint64_t count)
+{
+	struct ipv6_num max = ipv6_low_mask(it->bits), last = max;
+	struct ipv6_num first = {0, offset}, n = {0, 0};
+
+	if (ipv6_cmp(first, max) > 0)
+		return IPCALC_E_INVALID_RANGE;
+
+	if (count > 0) {
+		n.lo = count - 1;
+		n = ipv6_add(first, n);
+		if (ipv6_cmp(n, max) < 0)
+			last = n;
+	}
+
+	split_set(it, first, last);
+	return IPCALC_OK;
+}
+
+/*!
+  \fn int ipcalc_split_shard(ipcalc_split_st *it, unsigned shard, unsigned shards)
+  \brief restricts the iteration to one of equal parts of the networks of the split
+
+  The sizes of the parts differ by at most one network, and a part is
+  empty when there are less networks than parts. The iteration restarts
+  at the first network of the part, which replaces any part previously
+  set.
+
+  \param it the iteration state, as set by ipcalc_split_init().
+  \param shard the part, from 1 to shards.
+  \param shards the number of parts.
+
+  \return IPCALC_OK, or IPCALC_E_INVALID_ARGUMENT.
+*/
+int ipcalc_split_shard(ipcalc_split_st *it, unsigned shard, unsigned shards)
+{
+	struct ipv6_num first, next;
+
+	if (shard == 0 || shard > shards)
+		return IPCALC_E_INVALID_ARGUMENT;
+
+	first = shard_start(shard - 1, shards, it->bits);
+	if (shard == shards) {
+		split_set(it, first, ipv6_low_mask(it->bits));
+		return IPCALC_OK;
+	}
+
+	next = shard_start(shard, shards, it->bits);
+	if (ipv6_cmp(next, first) == 0) {
+		split_set(it, first, first);
+		it->empty = it->done = 1;
+		return IPCALC_OK;
+	}
+
+	split_set(it, first, ipv6_sub(next, ipv6_bit(0)));
+	return IPCALC_OK;
+}
+
+/*!
+  \fn int ipcalc_split_next(ipcalc_split_st *it, ipcalc_net_st *net)
+  \brief returns the next network of the split
+
+  \param it the iteration state.
+  \param net where to store the network.
+
+  \return 1 if a network was stored, or 0 at the end of the split.
+*/
+int ipcalc_split_next(ipcalc_split_st *it, ipcalc_net_st *net)
+{
+	/* The halves of the address are never loaded together, as such a
+	 * load is not forwarded from their separate stores by the previous
+	 * call, and stalls each iteration. */
+	uint64_t hi = it->next[0], lo = it->next[1];
+
+	if (it->done)
+		return 0;
+
+	net->family = it->family;
+	net->prefix = it->prefix;
+	if (it->family == AF_INET6) {
+		put_be64(net->addr.v6.s6_addr, hi);
+		put_be64(net->addr.v6.s6_addr + 8, lo);
+	} else {
+		net->addr.v4.s_addr = htonl(lo);
+	}
+
+	if (hi > it->end[0] || (hi == it->end[0] && lo >= it->end[1])) {
+		it->done = 1;
+	} else {
+		lo += it->step[1];
+		it->next[0] = hi + it->step[0] + (lo < it->step[1]);
+		it->next[1] = lo;
+	}
+	return 1;
+}
+
+/*!
+  \fn size_t ipcalc_split_fill(ipcalc_split_st *it, ipcalc_net_st *nets, size_t count)
+  \brief stores the next networks of the split in an array
+
+  \param it the iteration state.
+  \param nets the array.
+  \param count the number of elements of the array.
+
+  \return the number of networks stored, which is less than count only
+  at the end of the split.
+*/
+size_t ipcalc_split_fill(ipcalc_split_st *it, ipcalc_net_st *nets, size_t count)
+{
+	size_t n = 0;
+
+	while (n < count && ipcalc_split_next(it, &nets[n]))
+		n++;
+	return n;
+}
+
+/*!
+  \fn int ipcalc_split_foreach(ipcalc_split_st *it, ipcalc_net_cb cb, void *arg)
+  \brief passes the remaining networks of the split to a callback
+
+  \param it the iteration state.
+  \param cb the callback, which stops the iteration by returning non-zero.
+  \param arg the argument of the callback.
+
+  \return 0 at the end of the split, or the value returned by cb when it stopped it.
+*/
+int ipcalc_split_foreach(ipcalc_split_st *it, ipcalc_net_cb cb, void *arg)
+{
+	ipcalc_net_st net;
+	int ret;
+
+	while (ipcalc_split_next(it, &net)) {
+		ret = cb(&net, arg);
+		if (ret != 0)
+			return ret;
+	}
+	return 0;
+}
+
+/*!
+  \fn int ipcalc_split_count(const ipcalc_split_st *it, char *buf, size_t size)
+  \brief formats the number of networks of the split, or of its part
+
+  \param it the iteration state.
+  \param buf the output buffer; IPCALC_HOSTS_SIZE bytes are always enough.
+  \param size the size of the buffer.
+
+  \return the length of the string, or a negative error code.
+*/
+int ipcalc_split_count(const ipcalc_split_st *it, char *buf, size_t size)
+{
+	char tmp[IPCALC_HOSTS_SIZE];
+	struct ipv6_num n;
+	int len;
+
+	n = ipv6_sub(get_num(it->last), get_num(it->first));
+
+	/* the count of a whole split to /128 of ::/0 is 2^128 */
+	if (it->empty) {
+		len = snprintf(tmp, sizeof(tmp), "0");
+	} else if (ipv6_cmp(n, ipv6_low_mask(128)) == 0) {
+		len = snprintf(tmp, sizeof(tmp), "%s", p2_table(128));
+	} else {
+		n = ipv6_add(n, ipv6_bit(0));
+		len = format_uint128(tmp, &n);
+	}
+
+	return copy_out(buf, size, tmp, len);
+}
+
+/* Returns the order of the largest block starting at base which is
+ * aligned to its size and does not extend past end: the smaller of the
+ * alignment of base and of the largest power of two up to end-base+1 */
+static unsigned block_order(struct ipv6_num base, struct ipv6_num end, unsigned width)
+{
+	struct ipv6_num span = ipv6_sub(end, base);
+	unsigned order, align;
+
+	if (ipv6_cmp(span, ipv6_low_mask(width)) == 0)
+		return width;
+	order = 127 - ipv6_clz(ipv6_add(span, ipv6_bit(0)));
+
+	align = ipv6_ctz(base);
+	return align < order ? align : order;
+}
+
+/* Returns the number of networks covering the range, without enumerating
+ * them. With e the address after the range and m the highest bit where
+ * base and e differ, the networks below the aligned address mid, e with
+ * its lowest m bits cleared, grow in size and are the set bits of
+ * mid - base, and the following ones shrink and are the set bits of
+ * e - mid. */
+static unsigned block_count(struct ipv6_num base, struct ipv6_num end)
+{
+	struct ipv6_num e, low, mid;
+	unsigned m;
+
+	/* e is 2^128, which is also mid */
+	if (ipv6_cmp(end, ipv6_low_mask(128)) == 0) {
+		if (ipv6_cmp(base, ipv6_low_mask(0)) == 0)
+			return 1;
+		return ipv6_popcount(ipv6_sub(ipv6_low_mask(0), base));
+	}
+
+	e = ipv6_add(end, ipv6_bit(0));
+	m = 127 - ipv6_clz(ipv6_xor(base, e));
+	low = ipv6_low_mask(m);
+	mid = ipv6_and(e, ipv6_not(low));
+
+	return ipv6_popcount(ipv6_sub(mid, base)) + ipv6_popcount(ipv6_and(e, low));
+}
+
+/*!
+  \fn int ipcalc_deagg_init(ipcalc_deagg_st *it, int family, const void *first, const void *last)
+  \brief starts the iteration over the minimal set of networks covering a range
+
+  \param it the iteration state.
+  \param family AF_INET or AF_INET6.
+  \param first the first address of the range, a struct in_addr or a struct in6_addr.
+  \param last the last address of the range.
+
+  \return IPCALC_OK, or a negative error code.
+*/
+int ipcalc_deagg_init(ipcalc_deagg_st *it, int family, const void *first, const void *last)
+{
+	struct ipv6_num base, end;
+
+	if (family != AF_INET && family != AF_INET6)
+		return IPCALC_E_INVALID_ARGUMENT;
+
+	base = addr_to_num(family, first);
+	end = addr_to_num(family, last);
+	if (ipv6_cmp(base, end) > 0)
+		return IPCALC_E_INVALID_RANGE;
+
+	memset(it, 0, sizeof(*it));
+	it->family = family;
+	set_num(it->base, base);
+	set_num(it->end, end);
+	return IPCALC_OK;
+}
+
+/*!
+  \fn int ipcalc_deagg_next(ipcalc_deagg_st *it, ipcalc_net_st *net)
+  \brief returns the next network covering the range
+
+  \param it the iteration state.
+  \param net where to store the network.
+
+  \return 1 if a network was stored, or 0 when the range is covered.
+*/
+int ipcalc_deagg_next(ipcalc_deagg_st *it, ipcalc_net_st *net)
+{
+	struct ipv6_num base = get_num(it->base), end = get_num(it->end), last;
+	unsigned width = family_width(it->family), step;
+
+	if (it->done)
+		return 0;
+
+	step = block_order(base, end, width);
+	net->family = it->family;
+	net->prefix = width - step;
+	num_to_addr(it->family, base, &net->addr);
+
+	last = ipv6_or(base, ipv6_low_mask(step));
+	if (ipv6_cmp(last, end) >= 0)
+		it->done = 1;
+	else
+		set_num(it->base, ipv6_add(last, ipv6_bit(0)));
+	return 1;
+}
+
+/*!
+  \fn size_t ipcalc_deagg_fill(ipcalc_deagg_st *it, ipcalc_net_st *nets, size_t count)
+  \brief stores the next networks covering the range in an array
+
+  \param it the iteration state.
+  \param nets the array.
+  \param count the number of elements of the array.
+
+  \return the number of networks stored, which is less than count only
+  when the range is covered.
+*/
+size_t ipcalc_deagg_fill(ipcalc_deagg_st *it, ipcalc_net_st *nets, size_t count)
+{
+	size_t n = 0;
+
+	while (n < count && ipcalc_deagg_next(it, &nets[n]))
+		n++;
+	return n;
+}
+
+/*!
+  \fn int ipcalc_deagg_foreach(ipcalc_deagg_st *it, ipcalc_net_cb cb, void *arg)
+  \brief passes the remaining networks covering the range to a callback
+
+  \param it the iteration state.
+  \param cb the callback, which stops the iteration by returning non-zero.
+  \param arg the argument of the callback.
+
+  \return 0 when the range is covered, or the value returned by cb when it stopped the iteration.
+*/
+int ipcalc_deagg_foreach(ipcalc_deagg_st *it, ipcalc_net_cb cb, void *arg)
+{
+	ipcalc_net_st net;
+	int ret;
+
+	while (ipcalc_deagg_next(it, &net)) {
+		ret = cb(&net, arg);
+		if (ret != 0)
+			return ret;
+	}
+	return 0;
+}
+
+/*!
+  \fn int ipcalc_deagg_count(const ipcalc_deagg_st *it)
+  \brief returns the number of networks left to cover the range
+
+  \param it the iteration state.
+
+  \return the number of networks ipcalc_deagg_next() is going to return.
+*/
+int ipcalc_deagg_count(const ipcalc_deagg_st *it)
+{
+	if (it->done)
+		return 0;
+	return block_count(get_num(it->base), get_num(it->end));
+}
+
+/* The number of the labels before the suffix of the reverse names of a
+ * prefix: a nibble each for IPv6, and an octet each for IPv4, the last
+ * one possibly a range of values */
+static unsigned revzone_labels(int family, unsigned prefix)
+{
+	if (family == AF_INET6)
+		return prefix / 4;
+	return (prefix + 7) / 8;
+}
+
+/* Formats the label with the given index, counting from the leftmost
+ * one, of the reverse name of n; returns its length */
+static unsigned revzone_label(const ipcalc_revzone_st *it, struct ipv6_num n, unsigned label, char *buf)
+{
+	unsigned field = it->labels - 1 - label, value, len;
+
+	if (it->family == AF_INET6) {
+		value = ipv6_shr(n, 124 - 4 * field).lo & 0xf;
+		buf[0] = "0123456789abcdef"[value];
+		return 1;
+	}
+
+	value = (n.lo >> (24 - 8 * field)) & 0xff;
+	len = format_octet(buf, value);
+	if (label == 0 && it->prefix % 8 != 0) {
+		buf[len++] = '-';
+		len += format_octet(buf + len, value | (0xff >> (it->prefix % 8)));
+	}
+	return len;
+}
+
+/* Rewrites the given number of labels from the left of the name, those
+ * to their right being up to date */
+static void revzone_write(ipcalc_revzone_st *it, struct ipv6_num n, unsigned count)
+{
+	unsigned end = it->pos[count], len;
+	char buf[8];
+
+	while (count-- > 0) {
+		len = revzone_label(it, n, count, buf);
+		end -= len + 1;
+		memcpy(&it->name[end], buf, len);
+		it->name[end + len] = '.';
+		it->pos[count] = end;
+	}
+}
+
+/*!
+  \fn int ipcalc_revzone_init(ipcalc_revzone_st *it, const ipcalc_net_st *net, unsigned prefix)
+  \brief starts the iteration over the reverse DNS zones of the networks of a prefix in a network
+
+  The names are those of \ref ipcalc_reverse_dns; a prefix of 32 or 128
+  gives the names of the PTR records of every address in the network.
+
+  \param it the iteration state.
+  \param net the network.
+  \param prefix the prefix of the zones, at least the prefix of net; it
+  must be a multiple of 4 for IPv6 and at least 8 for IPv4.
+
+  \return IPCALC_OK, or a negative error code.
+*/
+int ipcalc_revzone_init(ipcalc_revzone_st *it, const ipcalc_net_st *net, unsigned prefix)
+{
+	const char *suffix = (net->family == AF_INET6) ? "ip6.arpa." : "in-addr.arpa.";
+	unsigned width, shift;
+	struct ipv6_num mask, base;
+
+	if (net->family != AF_INET && net->family != AF_INET6)
+		return IPCALC_E_INVALID_ARGUMENT;
+	width = family_width(net->family);
+	if (net->prefix > width || prefix > width || prefix < net->prefix ||
+	    (net->family == AF_INET6 ? prefix % 4 != 0 : prefix < 8))
+		return IPCALC_E_INVALID_PREFIX;
+
+	memset(it, 0, sizeof(*it));
+	it->family = net->family;
+	it->prefix = prefix;
+	it->labels = revzone_labels(net->family, prefix);
+
+	shift = width - prefix;
+	mask = ipv6_and(ipv6_low_mask(width), ipv6_not(ipv6_low_mask(width - net->prefix)));
+	base = ipv6_and(addr_to_num(net->family, &net->addr), mask);
+	set_num(it->next, base);
+	set_num(it->end, ipv6_or(base, ipv6_and(ipv6_low_mask(width - net->prefix),
+						 ipv6_not(ipv6_low_mask(shift)))));
+	if (shift < 128)
+		set_num(it->step, ipv6_bit(shift));
+
+	it->pos[it->labels] = sizeof(it->name) - strlen(suffix) - 1;
+	strcpy(&it->name[it->pos[it->labels]], suffix);
+	revzone_write(it, base, it->labels);
+	return IPCALC_OK;
+}
+
+/*!
+  \fn int ipcalc_revzone_next(ipcalc_revzone_st *it, const char **name)
+  \brief returns the next reverse DNS zone
+
+  The labels of the name that are the same as in the previous one are
+  not written again, so that the names of a large network are listed at
+  the cost of about a label each.
+
+  \param it the iteration state.
+  \param name where to store the name, which is valid until the next
+  call.
+
+  \return the length of the name, or 0 after the last one.
+*/
+int ipcalc_revzone_next(ipcalc_revzone_st *it, const char **name)
+{
+	struct ipv6_num cur = get_num(it->next), next;
+	unsigned width, changed;
+
+	if (it->done)
+		return 0;
+
+	if (it->started) {
+		if (ipv6_cmp(cur, get_num(it->end)) == 0) {
+			it->done = 1;
+			return 0;
+		}
+
+		/* only the labels up to the highest changed bit differ */
+		width = family_width(it->family);
+		next = ipv6_add(cur, get_num(it->step));
+		changed = (ipv6_clz(ipv6_xor(cur, next)) - (128 - width)) /
+			  (it->family == AF_INET6 ? 4 : 8);
+		revzone_write(it, next, it->labels - changed);
+		set_num(it->next, next);
+	}
+
+	it->started = 1;
+	*name = &it->name[it->pos[0]];
+	return sizeof(it->name) - 1 - it->pos[0];
+}
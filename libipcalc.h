@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * libipcalc: the address calculations of ipcalc as a library.
+ *
+ * The functions keep no state between calls and use no global options;
+ * they take their options explicitly, write into the buffers of the
+ * caller, and return one of the IPCALC_E_* codes on failure instead of
+ * printing anything. They are safe to call from several threads.
+ */
+
+#ifndef LIBIPCALC_H
+#define LIBIPCALC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/* The shared library is built with its internal symbols hidden, and
+ * exports only the functions declared with IPCALC_EXPORT */
+#if defined(__GNUC__)
+# define IPCALC_EXPORT __attribute__((__visibility__("default")))
+#else
+# define IPCALC_EXPORT
+#endif
+
+#define IPCALC_OK			0
+#define IPCALC_E_INVALID_ADDRESS	-1
+#define IPCALC_E_INVALID_PREFIX		-2
+#define IPCALC_E_INVALID_RANGE		-3
+#define IPCALC_E_BUFFER_TOO_SMALL	-4
+#define IPCALC_E_INVALID_ARGUMENT	-5
+
+IPCALC_EXPORT const char *ipcalc_strerror(int err);
+
+/* The options of ipcalc_parse_net() */
+#define IPCALC_OPT_IPV4		(1<<0)	/* the address is IPv4 */
+#define IPCALC_OPT_IPV6		(1<<1)	/* the address is IPv6 */
+#define IPCALC_OPT_CLASS_PREFIX	(1<<2)	/* an IPv4 address without prefix gets its class prefix */
+
+typedef struct ipcalc_opts_st {
+	unsigned flags;
+} ipcalc_opts_st;
+
+/* An address of either family, in network byte order */
+typedef union ipcalc_addr_un {
+	struct in_addr v4;
+	struct in6_addr v6;
+} ipcalc_addr_un;
+
+/* An address with a prefix; the host bits of the address may be set */
+typedef struct ipcalc_net_st {
+	int family;		/* AF_INET or AF_INET6 */
+	unsigned prefix;
+	ipcalc_addr_un addr;
+} ipcalc_net_st;
+
+typedef struct ipcalc_info_st {
+	int family;
+	unsigned prefix;
+	ipcalc_addr_un address;
+	ipcalc_addr_un netmask;
+	ipcalc_addr_un network;
+	ipcalc_addr_un broadcast;	/* IPv4 only */
+	ipcalc_addr_un minaddr;		/* the first usable address */
+	ipcalc_addr_un maxaddr;		/* the last usable address */
+} ipcalc_info_st;
+
+/* Enough for any formatted network, including the terminating null */
+#define IPCALC_NET_SIZE (INET6_ADDRSTRLEN + 4)
+
+/* Enough for any number of addresses, including the terminating null */
+#define IPCALC_HOSTS_SIZE 40
+
+IPCALC_EXPORT int ipcalc_parse_net(const char *str, const ipcalc_opts_st *opts, ipcalc_net_st *net);
+IPCALC_EXPORT int ipcalc_parse_prefix(const char *str, int family);
+IPCALC_EXPORT int ipcalc_info(const ipcalc_net_st *net, ipcalc_info_st *info);
+
+IPCALC_EXPORT const char *ipcalc_addrspace(const ipcalc_net_st *net);
+IPCALC_EXPORT const char *ipcalc_class(const ipcalc_net_st *net);
+IPCALC_EXPORT unsigned ipcalc_class_prefix(struct in_addr addr);
+
+IPCALC_EXPORT int ipcalc_hosts(int family, unsigned prefix, char *buf, size_t size);
+IPCALC_EXPORT int ipcalc_reverse_dns(const ipcalc_net_st *net, char *buf, size_t size);
+IPCALC_EXPORT int ipcalc_format_addr(int family, const void *addr, char *buf, size_t size);
+IPCALC_EXPORT int ipcalc_format_net(const ipcalc_net_st *net, char *buf, size_t size);
+
+/* A consumer of the networks of an iteration; a non-zero return value
+ * stops the iteration */
+typedef int (*ipcalc_net_cb)(const ipcalc_net_st *net, void *arg);
+
+/* The state of the iteration over the networks of a split. It may be
+ * allocated by the caller anywhere; the fields are private. */
+typedef struct ipcalc_split_st {
+	int family;
+	unsigned prefix;	/* of the networks */
+	unsigned bits;		/* log2 of the number of networks */
+	unsigned shift;		/* of an index to an address */
+	unsigned empty;		/* the slice has no networks */
+	unsigned done;
+	uint64_t base[2];	/* the address of the split network */
+	uint64_t step[2];	/* the distance between the networks */
+	uint64_t first[2];	/* the index of the first network of the slice */
+	uint64_t last[2];	/* the index of the last network of the slice */
+	uint64_t next[2];	/* the address of the next network */
+	uint64_t end[2];	/* the address of the last network */
+} ipcalc_split_st;
+
+IPCALC_EXPORT int ipcalc_split_init(ipcalc_split_st *it, const ipcalc_net_st *net, unsigned prefix);
+IPCALC_EXPORT int ipcalc_split_slice(ipcalc_split_st *it, uint64_t offset, uint64_t count);
+IPCALC_EXPORT int ipcalc_split_shard(ipcalc_split_st *it, unsigned shard, unsigned shards);
+IPCALC_EXPORT int ipcalc_split_next(ipcalc_split_st *it, ipcalc_net_st *net);
+IPCALC_EXPORT size_t ipcalc_split_fill(ipcalc_split_st *it, ipcalc_net_st *nets, size_t count);
+IPCALC_EXPORT int ipcalc_split_foreach(ipcalc_split_st *it, ipcalc_net_cb cb, void *arg);
+IPCALC_EXPORT int ipcalc_split_count(const ipcalc_split_st *it, char *buf, size_t size);
+
+/* The state of the iteration over the networks covering a range */
+typedef struct ipcalc_deagg_st {
+	int family;
+	unsigned done;
+	uint64_t base[2];	/* the first address not yet covered */
+	uint64_t end[2];	/* the last address of the range */
+} ipcalc_deagg_st;
+
+IPCALC_EXPORT int ipcalc_deagg_init(ipcalc_deagg_st *it, int family, const void *first, const void *last);
+IPCALC_EXPORT int ipcalc_deagg_next(ipcalc_deagg_st *it, ipcalc_net_st *net);
+IPCALC_EXPORT size_t ipcalc_deagg_fill(ipcalc_deagg_st *it, ipcalc_net_st *nets, size_t count);
+IPCALC_EXPORT int ipcalc_deagg_foreach(ipcalc_deagg_st *it, ipcalc_net_cb cb, void *arg);
+IPCALC_EXPORT int ipcalc_deagg_count(const ipcalc_deagg_st *it);
+
+/* Enough for any reverse DNS name, including the terminating null */
+#define IPCALC_REVERSE_SIZE 74
+
+/* The state of the iteration over the reverse DNS zones of a network */
+typedef struct ipcalc_revzone_st {
+	int family;
+	unsigned prefix;	/* of the zones */
+	unsigned labels;	/* before the in-addr.arpa. or ip6.arpa. suffix */
+	unsigned started;
+	unsigned done;
+	uint64_t next[2];	/* the address of the current zone */
+	uint64_t end[2];	/* the address of the last zone */
+	uint64_t step[2];	/* the distance between the zones */
+	unsigned char pos[33];	/* the start of every label in name */
+	char name[IPCALC_REVERSE_SIZE];	/* written from the end */
+} ipcalc_revzone_st;
+
+IPCALC_EXPORT int ipcalc_revzone_init(ipcalc_revzone_st *it, const ipcalc_net_st *net, unsigned prefix);
+IPCALC_EXPORT int ipcalc_revzone_next(ipcalc_revzone_st *it, const char **name);
+
+#endif
@@ -0,0 +1,689 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Longest prefix match of a stream of addresses against a table of
+ * labelled prefixes.
+ *
+ * Every address family uses a multibit trie with a 16-bit root node and
+ * 8-bit nodes below it, so that an IPv4 lookup takes at most three memory
+ * accesses and an IPv6 one at most fifteen. The prefixes are inserted
+ * from the shortest to the longest and expanded to the node boundaries;
+ * a node created for a longer prefix inherits the match of the entry it
+ * replaces, so every entry holds the longest match for its addresses and
+ * no backtracking is needed during the lookup.
+ *
+ * The tries, the prefixes and their strings are flat arrays which refer
+ * to each other by offsets, so --compile-table can write them out as they
+ * are. A compiled table is mapped read-only and used without parsing, and
+ * processes using the same file share its pages.
+ */
+
+#define _GNU_SOURCE		/* getline */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "ipcalc.h"
+
+#define ROOT_BITS 16
+#define NODE_BITS 8
+
+/* An entry is either a leaf, holding the index of the matching prefix
+ * plus one (zero when nothing matches), or the offset of a child node */
+#define ENTRY_CHILD 0x80000000U
+
+struct lpm_trie {
+	uint32_t *entries;	/* the root node followed by the child nodes */
+	size_t count;
+	size_t size;	/* zero when the entries are mapped from a file */
+};
+
+struct lpm_prefix {
+	uint32_t net;		/* offsets in the string table */
+	uint32_t label;
+};
+
+struct lpm_table {
+	struct lpm_trie v4;
+	struct lpm_trie v6;
+	struct lpm_prefix *prefixes;
+	size_t nprefixes;
+	char *strings;
+	size_t strings_len;
+	size_t strings_size;
+
+	void *map;	/* the compiled table file, if one is used */
+	size_t map_size;
+};
+
+/* The compiled table file: this header followed by the sections it
+ * points to. The data is in the byte order of the host that compiled
+ * it, which is detected with byte_order; all the offsets are from the
+ * start of the file, and every section is 8-byte aligned. */
+#define LPM_FILE_MAGIC "IPCT"
+#define LPM_FILE_VERSION 1
+#define LPM_BYTE_ORDER 0x01020304
+
+struct lpm_file_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t reserved;
+	uint64_t v4_off, v4_count;	/* the IPv4 trie entries */
+	uint64_t v6_off, v6_count;	/* the IPv6 trie entries */
+	uint64_t prefixes_off, nprefixes;
+	uint64_t strings_off, strings_len;
+};
+
+/* A prefix read from the table file, before it is inserted */
+struct lpm_input {
+	int family;
+	unsigned prefix;
+	unsigned char addr[16];
+};
+
+static uint32_t add_string(struct lpm_table *table, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	uint32_t off;
+
+	if (table->strings_len + len > table->strings_size) {
+		table->strings_size = 2 * (table->strings_len + len);
+		table->strings = safe_realloc(table->strings, table->strings_size);
+	}
+
+	off = table->strings_len;
+	memcpy(table->strings + off, str, len);
+	table->strings_len += len;
+	return off;
+}
+
+/* Appends a node with every entry set to value; returns its offset */
+static uint32_t trie_add_node(struct lpm_trie *trie, unsigned bits, uint32_t value)
+{
+	size_t n = (size_t)1 << bits, i;
+	uint32_t off;
+
+	if (trie->count + n >= ENTRY_CHILD) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: the prefix table is too large\n");
+		exit(1);
+	}
+
+	if (trie->count + n > trie->size) {
+		trie->size = 2 * (trie->count + n);
+		trie->entries = safe_realloc(trie->entries, trie->size * sizeof(trie->entries[0]));
+	}
+
+	off = trie->count;
+	for (i = 0; i < n; i++)
+		trie->entries[off + i] = value;
+	trie->count += n;
+	return off;
+}
+
+static void trie_insert(struct lpm_trie *trie, const unsigned char *addr, unsigned prefix, uint32_t value)
+{
+	uint32_t off = 0, idx, i, n;
+	unsigned pos = 0, bits = ROOT_BITS;
+
+	if (trie->count == 0)
+		trie_add_node(trie, ROOT_BITS, 0);
+
+	while (1) {
+		if (bits == ROOT_BITS)
+			idx = (addr[0] << 8) | addr[1];
+		else
+			idx = addr[pos / 8];
+
+		if (prefix <= pos + bits) {
+			/* the prefix covers 2^n entries of this node; nothing
+			 * below them can be more specific yet */
+			n = pos + bits - prefix;
+			idx &= ~((1U << n) - 1);
+			for (i = 0; i < (1U << n); i++)
+				trie->entries[off + idx + i] = value;
+			return;
+		}
+
+		if (!(trie->entries[off + idx] & ENTRY_CHILD)) {
+			uint32_t child = trie_add_node(trie, NODE_BITS, trie->entries[off + idx]);
+
+			trie->entries[off + idx] = ENTRY_CHILD | child;
+		}
+
+		off = trie->entries[off + idx] & ~ENTRY_CHILD;
+		pos += bits;
+		bits = NODE_BITS;
+	}
+}
+
+/* Returns the index of the matching prefix plus one, or zero. The child
+ * offsets are checked, as a mapped file is not validated when loaded. */
+static inline uint32_t trie_lookup(const struct lpm_trie *trie, const unsigned char *addr, unsigned addr_len)
+{
+	uint32_t e, off;
+	unsigned i = 2;
+
+	if (trie->count == 0)
+		return 0;
+
+	e = trie->entries[(addr[0] << 8) | addr[1]];
+	while (e & ENTRY_CHILD) {
+		off = e & ~ENTRY_CHILD;
+		if (i == addr_len || off + (1U << NODE_BITS) > trie->count)
+			return 0;
+		e = trie->entries[off + addr[i++]];
+	}
+	return e;
+}
+
+static void mask_address(unsigned char *addr, unsigned bytes, unsigned prefix)
+{
+	unsigned i;
+
+	for (i = 0; i < bytes; i++) {
+		if (prefix >= 8) {
+			prefix -= 8;
+		} else {
+			addr[i] &= (0xff00 >> prefix) & 0xff;
+			prefix = 0;
+		}
+	}
+}
+
+/* Maps a table written by lpm_compile(). Returns 0 on success or -1
+ * on error. */
+static int lpm_map(struct lpm_table *table, const char *file, int fd)
+{
+	const struct lpm_file_header *h;
+	struct stat st;
+	size_t i;
+
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*h))
+		goto fail;
+
+	table->map_size = st.st_size;
+	table->map = mmap(NULL, table->map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (table->map == MAP_FAILED) {
+		table->map = NULL;
+		goto fail;
+	}
+	h = table->map;
+
+	if (h->version != LPM_FILE_VERSION || h->byte_order != LPM_BYTE_ORDER) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: %s: unsupported compiled table version or byte order\n", file);
+		return -1;
+	}
+
+#define SECTION_OK(off, count, size) \
+	((off) % 8 == 0 && (off) <= table->map_size && \
+	 (count) <= (table->map_size - (off)) / (size))
+
+	if (!SECTION_OK(h->v4_off, h->v4_count, sizeof(uint32_t)) ||
+	    !SECTION_OK(h->v6_off, h->v6_count, sizeof(uint32_t)) ||
+	    !SECTION_OK(h->prefixes_off, h->nprefixes, sizeof(struct lpm_prefix)) ||
+	    !SECTION_OK(h->strings_off, h->strings_len, 1) ||
+	    (h->v4_count != 0 && h->v4_count < (1U << ROOT_BITS)) ||
+	    (h->v6_count != 0 && h->v6_count < (1U << ROOT_BITS)) ||
+	    h->strings_len == 0 || h->nprefixes >= ENTRY_CHILD)
+		goto fail;
+#undef SECTION_OK
+
+	table->v4.entries = (uint32_t *)((char *)table->map + h->v4_off);
+	table->v4.count = h->v4_count;
+	table->v6.entries = (uint32_t *)((char *)table->map + h->v6_off);
+	table->v6.count = h->v6_count;
+	table->prefixes = (struct lpm_prefix *)((char *)table->map + h->prefixes_off);
+	table->nprefixes = h->nprefixes;
+	table->strings = (char *)table->map + h->strings_off;
+	table->strings_len = h->strings_len;
+
+	/* the strings are printed as they are; make sure that they end */
+	if (table->strings[table->strings_len - 1] != 0)
+		goto fail;
+	for (i = 0; i < table->nprefixes; i++) {
+		if (table->prefixes[i].net >= table->strings_len ||
+		    table->prefixes[i].label >= table->strings_len)
+			goto fail;
+	}
+
+	return 0;
+
+ fail:
+	if (!beSilent)
+		fprintf(stderr, "ipcalc: %s: invalid compiled table\n", file);
+	return -1;
+}
+
+/* Reads the table file; every line holds a network followed by an
+ * optional label. Returns 0 on success or -1 on error. */
+static int lpm_parse(struct lpm_table *table, const char *file, FILE *fp, unsigned flags)
+{
+	struct lpm_input *input = NULL;
+	size_t ninput = 0, input_size = 0, i;
+	size_t count[129], start[129];
+	uint32_t *order;
+	char *line = NULL;
+	size_t line_size = 0;
+	unsigned lineno = 0;
+	int ret = 0;
+
+	memset(count, 0, sizeof(count));
+
+	while (getline(&line, &line_size, fp) != -1) {
+		char netstr[INET6_ADDRSTRLEN + 4];
+		char *str, *label;
+		struct lpm_input *in;
+		size_t len;
+
+		lineno++;
+		str = trim(line);
+		if (str[0] == 0 || str[0] == '#')
+			continue;
+
+		label = "";
+		len = strcspn(str, " \t");
+		if (str[len]) {
+			str[len] = 0;
+			label = trim(str + len + 1);
+		}
+
+		if (ninput == input_size) {
+			input_size = input_size ? 2 * input_size : 1024;
+			input = safe_realloc(input, input_size * sizeof(input[0]));
+			table->prefixes = safe_realloc(table->prefixes, input_size * sizeof(table->prefixes[0]));
+		}
+		in = &input[ninput];
+
+		in->family = parse_network(str, flags, in->addr, &in->prefix);
+		if (in->family < 0) {
+			if (!beSilent)
+				fprintf(stderr, "ipcalc: %s:%u: bad network: %s\n", file, lineno, str);
+			ret = -1;
+			continue;
+		}
+
+		if (in->family == AF_INET) {
+			uint32_t ip;
+
+			mask_address(in->addr, 4, in->prefix);
+			memcpy(&ip, in->addr, 4);
+			len = format_ipv4(netstr, ntohl(ip));
+		} else {
+			mask_address(in->addr, 16, in->prefix);
+			len = format_ipv6(netstr, (struct in6_addr *)in->addr);
+		}
+		format_prefix(netstr + len, in->prefix);
+
+		table->prefixes[ninput].net = add_string(table, netstr);
+		table->prefixes[ninput].label = add_string(table, label);
+		count[in->prefix]++;
+		ninput++;
+	}
+	free(line);
+
+	if (ferror(fp)) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: error reading %s\n", file);
+		ret = -1;
+	}
+
+	/* insert from the shortest prefix to the longest; the sort is stable
+	 * so that of two identical prefixes the later one is used */
+	order = safe_realloc(NULL, (ninput ? ninput : 1) * sizeof(order[0]));
+	start[0] = 0;
+	for (i = 1; i <= 128; i++)
+		start[i] = start[i - 1] + count[i - 1];
+	for (i = 0; i < ninput; i++)
+		order[start[input[i].prefix]++] = i;
+
+	for (i = 0; i < ninput; i++) {
+		struct lpm_input *in = &input[order[i]];
+
+		if (in->family == AF_INET)
+			trie_insert(&table->v4, in->addr, in->prefix, order[i] + 1);
+		else
+			trie_insert(&table->v6, in->addr, in->prefix, order[i] + 1);
+	}
+	table->nprefixes = ninput;
+
+	free(order);
+	free(input);
+	return ret;
+}
+
+/* Loads a text or a compiled table. Returns 0 on success or -1 on error. */
+static int lpm_load(struct lpm_table *table, const char *file, unsigned flags)
+{
+	char magic[4];
+	FILE *fp;
+	int ret;
+
+	memset(table, 0, sizeof(*table));
+
+	fp = fopen(file, "r");
+	if (fp == NULL) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: cannot open %s\n", file);
+		return -1;
+	}
+
+	if (fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+	    memcmp(magic, LPM_FILE_MAGIC, sizeof(magic)) == 0) {
+		ret = lpm_map(table, file, fileno(fp));
+	} else {
+		rewind(fp);
+		ret = lpm_parse(table, file, fp, flags);
+	}
+
+	fclose(fp);
+	return ret;
+}
+
+static void lpm_free(struct lpm_table *table)
+{
+	if (table->map) {
+		munmap(table->map, table->map_size);
+		return;
+	}
+
+	free(table->v4.entries);
+	free(table->v6.entries);
+	free(table->prefixes);
+	free(table->strings);
+}
+
+static int write_section(FILE *fp, const void *data, size_t size)
+{
+	static const char zero[8];
+
+	if (size && fwrite(data, 1, size, fp) != size)
+		return -1;
+	if (size % 8 && fwrite(zero, 1, 8 - size % 8, fp) != 8 - size % 8)
+		return -1;
+	return 0;
+}
+
+static uint64_t align8(uint64_t n)
+{
+	return (n + 7) & ~(uint64_t)7;
+}
+
+/*!
+  \fn int lpm_compile(const char *table_file, const char *out_file, unsigned flags)
+  \brief writes the prefix table in table_file to out_file in the compiled form
+
+  The compiled table can be used in place of the text one with
+  --lpm-table; it is mapped into memory instead of parsed. The file is
+  written under a temporary name and renamed into place, so that the
+  processes using the old file are not affected.
+
+  \param table_file the file with the prefix table.
+  \param out_file the file to write.
+  \param flags the flags to use.
+
+  \return 0 on success, or 1 on error.
+*/
+int lpm_compile(const char *table_file, const char *out_file, unsigned flags)
+{
+	struct lpm_table table;
+	struct lpm_file_header h;
+	char *tmp_file = NULL;
+	FILE *fp = NULL;
+	int fd, ret = 1;
+
+	if (lpm_load(&table, table_file, flags) < 0)
+		goto cleanup;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, LPM_FILE_MAGIC, sizeof(h.magic));
+	h.version = LPM_FILE_VERSION;
+	h.byte_order = LPM_BYTE_ORDER;
+	h.v4_count = table.v4.count;
+	h.v6_count = table.v6.count;
+	h.nprefixes = table.nprefixes;
+	h.strings_len = table.strings_len;
+	if (h.strings_len == 0)
+		h.strings_len = 1;	/* the empty string */
+
+	h.v4_off = align8(sizeof(h));
+	h.v6_off = h.v4_off + align8(h.v4_count * sizeof(uint32_t));
+	h.prefixes_off = h.v6_off + align8(h.v6_count * sizeof(uint32_t));
+	h.strings_off = h.prefixes_off + align8(h.nprefixes * sizeof(struct lpm_prefix));
+
+	safe_asprintf(&tmp_file, "%s.XXXXXX", out_file);
+	fd = mkstemp(tmp_file);
+	if (fd < 0 || (fp = fdopen(fd, "w")) == NULL) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: cannot create %s\n", tmp_file);
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmp_file);
+		}
+		goto cleanup;
+	}
+	fchmod(fd, 0644);
+
+	if (write_section(fp, &h, sizeof(h)) < 0 ||
+	    write_section(fp, table.v4.entries, h.v4_count * sizeof(uint32_t)) < 0 ||
+	    write_section(fp, table.v6.entries, h.v6_count * sizeof(uint32_t)) < 0 ||
+	    write_section(fp, table.prefixes, h.nprefixes * sizeof(struct lpm_prefix)) < 0 ||
+	    write_section(fp, table.strings_len ? table.strings : "", h.strings_len) < 0 ||
+	    fclose(fp) != 0) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: error writing %s\n", tmp_file);
+		unlink(tmp_file);
+		goto cleanup;
+	}
+
+	if (rename(tmp_file, out_file) < 0) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: cannot create %s\n", out_file);
+		unlink(tmp_file);
+		goto cleanup;
+	}
+
+	ret = 0;
+ cleanup:
+	free(tmp_file);
+	lpm_free(&table);
+	return ret;
+}
+
+static void show_match(const struct lpm_table *table, const char *addr, uint32_t match, unsigned flags)
+{
+	const char *net = NULL, *label = "";
+	unsigned jsonchain;
+	char buf[256];
+
+	if (match) {
+		net = table->strings + table->prefixes[match - 1].net;
+		label = table->strings + table->prefixes[match - 1].label;
+	}
+
+	if (flags & FLAG_JSON) {
+		output_start(&jsonchain);
+		json_printf(&jsonchain, "ADDRESS", "%s", addr);
+		if (net) {
+			json_printf(&jsonchain, "PREFIX", "%s", net);
+			if (label[0])
+				json_printf(&jsonchain, "LABEL", "%s", json_escape(buf, sizeof(buf), label));
+		}
+		output_stop(&jsonchain);
+		return;
+	}
+
+	output_puts(addr);
+	output_puts("\t");
+	output_puts(net ? net : "-");
+	if (label[0]) {
+		output_puts("\t");
+		output_puts(label);
+	}
+	output_puts("\n");
+}
+
+static void show_lpm_error(const char *str, unsigned flags)
+{
+	char buf[256];
+	unsigned jsonchain;
+
+	if (!beSilent)
+		fprintf(stderr, "ipcalc: bad address: %s\n", str);
+
+	if (!(flags & FLAG_JSON))
+		return;
+
+	output_start(&jsonchain);
+	json_printf(&jsonchain, "INPUT", "%s", json_escape(buf, sizeof(buf), str));
+	json_printf(&jsonchain, "ERROR", "%s", "invalid address");
+	output_stop(&jsonchain);
+}
+
+/*!
+  \fn struct lpm_table *lpm_open(const char *table_file, unsigned flags)
+  \brief loads a prefix table for lpm_query()
+
+  \param table_file the file with the prefix table, in the text form of
+  lpm_lookup() or written by lpm_compile().
+  \param flags the flags to use.
+
+  \return the table, or NULL on error.
+*/
+struct lpm_table *lpm_open(const char *table_file, unsigned flags)
+{
+	struct lpm_table *table = malloc(sizeof(*table));
+
+	if (table == NULL) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: memory error\n");
+		return NULL;
+	}
+
+	if (lpm_load(table, table_file, flags) < 0) {
+		lpm_close(table);
+		return NULL;
+	}
+	return table;
+}
+
+void lpm_close(struct lpm_table *table)
+{
+	if (table) {
+		lpm_free(table);
+		free(table);
+	}
+}
+
+/*!
+  \fn int lpm_query(const struct lpm_table *table, const char *str, unsigned flags)
+  \brief prints the longest matching prefix of an address
+
+  \param table the prefix table.
+  \param str the address.
+  \param flags the flags to use.
+
+  \return 0 on success, or -1 if str is not a valid address.
+*/
+int lpm_query(const struct lpm_table *table, const char *str, unsigned flags)
+{
+	unsigned char addr[16];
+	uint32_t match, ip;
+
+	if ((flags & FLAG_IPV4) == 0 && ((flags & FLAG_IPV6) || strchr(str, ':') != NULL)) {
+		if (inet_pton(AF_INET6, str, addr) <= 0)
+			goto fail;
+		match = trie_lookup(&table->v6, addr, 16);
+	} else {
+		const char *end = parse_ipv4(str, &ip, NULL, 0);
+
+		if (end == NULL || *end != 0)
+			goto fail;
+		ip = htonl(ip);
+		memcpy(addr, &ip, sizeof(ip));
+		match = trie_lookup(&table->v4, addr, 4);
+	}
+
+	if (match > table->nprefixes)
+		match = 0;
+	show_match(table, str, match, flags);
+	return 0;
+ fail:
+	show_lpm_error(str, flags);
+	return -1;
+}
+
+/*!
+  \fn int lpm_lookup(const char *table_file, FILE *fp, unsigned flags)
+  \brief prints the longest matching prefix of every address read from fp
+
+  The table file contains a network in the ADDRESS[/PREFIX] form per
+  line, optionally followed by a label. The input contains an address
+  per line; only the first field of a line is used. For every address
+  the address, the matching prefix and its label are printed, or '-'
+  when no prefix matches.
+
+  \param table_file the file with the prefix table.
+  \param fp the input stream.
+  \param flags the flags to use.
+
+  \return 0 if all lines were processed, or 1 if any errors were found.
+*/
+int lpm_lookup(const char *table_file, FILE *fp, unsigned flags)
+{
+	struct lpm_table table;
+	char *line = NULL;
+	size_t size = 0;
+	int ret = 0;
+
+	if (lpm_load(&table, table_file, flags) < 0) {
+		lpm_free(&table);
+		return 1;
+	}
+
+	while (getline(&line, &size, fp) != -1) {
+		char *str;
+
+		str = trim(line);
+		if (str[0] == 0 || str[0] == '#')
+			continue;
+		str[strcspn(str, " \t")] = 0;
+
+		if (lpm_query(&table, str, flags) < 0)
+			ret = 1;
+	}
+	free(line);
+
+	if (ferror(fp)) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: error reading input\n");
+		ret = 1;
+	}
+
+	lpm_free(&table);
+	return ret;
+}
@@ -32,219 +32,138 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <stdint.h>
+#include <inttypes.h>
 
-#include "ipv6.h"
 #include "ipcalc.h"
 
-static const char *numtoquad(uint32_t num)
+/* Restricts the split to the part to print */
+static int set_slice(ipcalc_split_st *it, const split_slice_st *slice)
 {
-	static char quad[64];
+	if (slice == NULL)
+		return 0;
 
-	num = htonl(num);
-	return inet_ntop(AF_INET, &num, quad, sizeof(quad));
-}
-
-void show_split_networks_v4(unsigned split_prefix, const struct ip_info_st *info, unsigned flags)
-{
-	char buf[64];
-	uint32_t diff, start, end;
-	size_t maxlen = 0;
-	unsigned count;
-	uint32_t splitmask = ntohl(prefix2mask(split_prefix));
-	uint32_t nmask = ntohl(prefix2mask(info->prefix));
-	struct in_addr net, broadcast;
-	unsigned jsonchain = JSON_FIRST;
+	if (slice->shards)
+		return ipcalc_split_shard(it, slice->shard, slice->shards) < 0 ? -1 : 0;
 
-	if (splitmask < nmask) {
+	if (ipcalc_split_slice(it, slice->offset, slice->count) < 0) {
 		if (!beSilent)
-			fprintf(stderr, "Cannot subnet to /%d with this base network, use a prefix > /%d\n",
-				split_prefix, info->prefix);
-		exit(1);
+			fprintf(stderr, "ipcalc: the split offset is past the last network: %" PRIu64 "\n",
+				slice->offset);
+		return -1;
 	}
+	return 0;
+}
 
-	output_start(&jsonchain);
-	array_start(&jsonchain, "Split networks", "SPLITNETWORK");
-
-	if (inet_pton(AF_INET, info->network, &net) <= 0) {
-		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad IPv4 address: %s\n", info->network);
-		exit(1);
+/* Prints the totals of the split; with --count these are all the output */
+static void show_split_totals(unsigned *jsonchain, const char *nets, const char *hosts, unsigned flags)
+{
+	if (flags & FLAG_COUNT) {
+		default_printf(jsonchain, "Total:  \t", "NETS", "%s", nets);
+		default_printf(jsonchain, "Hosts/Net:\t", "ADDRESSES", "%s", hosts);
+	} else if ((!(flags & FLAG_NO_DECORATE)) || (flags & FLAG_JSON)) {
+		dist_printf(jsonchain, "\nTotal:  \t", "NETS", "%s", nets);
+		dist_printf(jsonchain, "Hosts/Net:\t", "ADDRESSES", "%s", hosts);
 	}
-	net.s_addr = ntohl(net.s_addr);
+}
 
-	if (inet_pton(AF_INET, info->broadcast, &broadcast) <= 0) {
+static int show_split_networks(unsigned split_prefix, const ipcalc_net_st *net, const split_slice_st *slice, unsigned flags)
+{
+	ipcalc_split_st it;
+	char buf[64], nets[64];
+	unsigned jsonchain = JSON_FIRST;
+	uint64_t t;
+
+	if (ipcalc_split_init(&it, net, split_prefix) < 0) {
 		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad broadcast address: %s\n", info->broadcast);
-		exit(1);
+			fprintf(stderr, "Cannot subnet to /%d with this base network, use a prefix > /%d\n",
+				split_prefix, net->prefix);
+		return -1;
 	}
-	broadcast.s_addr = ntohl(broadcast.s_addr);
 
-	diff  = 0xffffffff - splitmask + 1;
-	start = net.s_addr;
-	end   = net.s_addr + diff - 1;
+	if (set_slice(&it, slice) < 0)
+		return -1;
 
-	/* Figure out max width of a network string. */
-	while (1) {
-		size_t len;
+	ipcalc_hosts(net->family, split_prefix, buf, sizeof(buf));
+	ipcalc_split_count(&it, nets, sizeof(nets));
 
-		len = snprintf(buf, sizeof(buf), "%s", numtoquad(start));
-		if (len > maxlen)
-			maxlen = len;
+	output_start(&jsonchain);
 
-		start += diff;
-		if (end == 0xffffffff || end >= broadcast.s_addr)
-			break;
-		end += diff;
+	if (flags & FLAG_COUNT) {
+		show_split_totals(&jsonchain, nets, buf, flags);
+		output_stop(&jsonchain);
+		return 0;
 	}
 
-	start = net.s_addr;
-	end = net.s_addr + diff - 1;
-	count = 0;
-	while (1) {
-		if (!(flags & FLAG_NO_DECORATE) || (flags & FLAG_JSON)) {
-			default_printf(&jsonchain, "Network:\t", NULL, "%s/%u", numtoquad(start), split_prefix);
-		} else {
-			printf("%s/%u\n", numtoquad(start), split_prefix);
-		}
-
-		count++;
-		start += diff;
-		if (end == 0xffffffff || end >= broadcast.s_addr)
-			break;
-		end += diff;
-	}
+	array_start(&jsonchain, "Split networks", "SPLITNETWORK");
+
+	/* The networks are streamed through the output buffer as they are
+	 * formatted; nothing depends on the whole range. */
+	t = stats_start();
+	ipcalc_split_foreach(&it, output_network, &jsonchain);
+	stats_lap(STATS_OUTPUT, &t);
 
 	array_stop(&jsonchain);
 
-	if ((!(flags & FLAG_NO_DECORATE)) || (flags & FLAG_JSON)) {
-		dist_printf(&jsonchain, "\nTotal:  \t", "NETS", "%u", count);
-		dist_printf(&jsonchain, "Hosts/Net:\t", "ADDRESSES", "%s", ipv4_prefix_to_hosts(buf, sizeof(buf), split_prefix));
-	}
+	show_split_totals(&jsonchain, nets, buf, flags);
 
 	output_stop(&jsonchain);
+	return 0;
 }
 
-static const char *ipv6tostr(struct in6_addr *ip)
-{
-	static char str[64];
+/*!
+  \fn int show_split_networks_v4(unsigned split_prefix, const struct ip_info_st *info, const split_slice_st *slice, unsigned flags)
+  \brief prints the networks of the given prefix in the network
 
-	return inet_ntop(AF_INET6, ip, str, sizeof(str));
-}
+  \param split_prefix the prefix of the networks to print.
+  \param info the network to split.
+  \param slice the part of the networks to print, or NULL for all of them.
+  \param flags the output flags.
 
-void show_split_networks_v6(unsigned split_prefix, const struct ip_info_st *info, unsigned flags)
+  \return 0 on success, or -1 on error.
+*/
+int show_split_networks_v4(unsigned split_prefix, const struct ip_info_st *info, const split_slice_st *slice, unsigned flags)
 {
-	int i, j, k;
-	unsigned count;
-	struct in6_addr splitmask, net, netmask, sdiff, ediff, start, end, tmpaddr, netlast;
-	char buf[32];
-	unsigned jsonchain = JSON_FIRST;
-
-	if (inet_pton(AF_INET6, info->network, &net) <= 0) {
-		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad IPv6 address: %s\n", info->network);
-		exit(1);
-	}
+	ipcalc_net_st net;
 
-	if (inet_pton(AF_INET6, info->hostmax, &netlast) <= 0) {
+	if (inet_pton(AF_INET, info->network, &net.addr.v4) <= 0) {
 		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad IPv6 address: %s\n", info->hostmax);
-		exit(1);
-	}
-
-	if (inet_pton(AF_INET6, info->netmask, &netmask) <= 0) {
-		if (!beSilent)
-			fprintf(stderr, "ipcalc: bad IPv6 mask: %s\n", info->netmask);
-		exit(1);
-	}
-
-	if (ipv6_prefix_to_mask(split_prefix, &splitmask) < 0) {
-		if (!beSilent)
-			fprintf(stderr, "ipcalc: IPv6 prefix: %d\n", split_prefix);
-		exit(1);
-	}
-
-	i = 0;
-	j = 0;
-	do {
-		if (splitmask.s6_addr[i] > netmask.s6_addr[i])
-			j = 1;
-		if (netmask.s6_addr[i] > splitmask.s6_addr[i])
-			j = 2;
-		i++;
-	} while (i < 16 && !j);
-
-	if (j == 2) {
-		if (!beSilent)
-			fprintf(stderr, "Cannot subnet to /%d with this base network, use a prefix > /%d\n",
-				split_prefix, info->prefix);
-		exit(1);
-	}
-
-	memset(&sdiff, 0, sizeof(sdiff));
-	memset(&ediff, 0, sizeof(ediff));
-
-	for (i = 0; i < 16; i++) {
-		if (splitmask.s6_addr)
-			sdiff.s6_addr[i] = 0xff - splitmask.s6_addr[i];
-		end.s6_addr[i] = net.s6_addr[i] + sdiff.s6_addr[i];
+			fprintf(stderr, "ipcalc: bad IPv4 address: %s\n", info->network);
+		return -1;
 	}
+	net.family = AF_INET;
+	net.prefix = info->prefix;
 
-	memcpy(&start, &net, sizeof(net));
-	memcpy(&ediff, &sdiff, sizeof(sdiff));
+	return show_split_networks(split_prefix, &net, slice, flags);
+}
 
-	memset(&tmpaddr, 0, sizeof(tmpaddr));
-	tmpaddr.s6_addr[15] = 1;
-	ipv6_add(&sdiff, &tmpaddr);
+/*!
+  \fn int show_split_networks_v6(unsigned split_prefix, const struct ip_info_st *info, const split_slice_st *slice, unsigned flags)
+  \brief prints the networks of the given prefix in the network
 
-	output_start(&jsonchain);
+  \param split_prefix the prefix of the networks to print.
+  \param info the network to split.
+  \param slice the part of the networks to print, or NULL for all of them.
+  \param flags the output flags.
 
-	array_start(&jsonchain, "Split networks", "SPLITNETWORK");
+  \return 0 on success, or -1 on error.
+*/
+int show_split_networks_v6(unsigned split_prefix, const struct ip_info_st *info, const split_slice_st *slice, unsigned flags)
+{
+	ipcalc_net_st net;
 
-	i = count = 0;
-	while (!i) {
-		if (!(flags & FLAG_NO_DECORATE) || (flags & FLAG_JSON)) {
-			default_printf(&jsonchain, "Network:\t", NULL, "%s/%u", ipv6tostr(&start), split_prefix);
-		} else {
-			printf("%s/%u\n", ipv6tostr(&start), split_prefix);
-		}
-
-		ipv6_add(&start, &sdiff);
-
-		j = 0;
-		for (k = 0; k < 16; k+=2)
-			if (end.s6_addr[k] != 0xff && end.s6_addr[k+1] != 0xff)
-				j = 1;
-		if (!j)
-			i = 1;
-
-		j = 0;
-		k = 0;
-		do {
-			if (end.s6_addr[k] > netlast.s6_addr[k])
-				j = 1;
-			if (netlast.s6_addr[k] > end.s6_addr[k])
-				j = 2;
-			k++;
-		} while (k < 16 && !j);
-
-		if (!j || j == 1)
-			i = 1;
-
-		memset(&end, 0, sizeof(end));
-
-		ipv6_add(&end, &start);
-		ipv6_add(&end, &ediff);
-		count++;
+	if (inet_pton(AF_INET6, info->network, &net.addr.v6) <= 0) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: bad IPv6 address: %s\n", info->network);
+		return -1;
 	}
+	net.family = AF_INET6;
+	net.prefix = info->prefix;
 
-	array_stop(&jsonchain);
-
-	if ((!(flags & FLAG_NO_DECORATE)) || (flags & FLAG_JSON)) {
-		dist_printf(&jsonchain, "\nTotal:  \t", "NETS", "%u", count);
-		dist_printf(&jsonchain, "Hosts/Net:\t", "ADDRESSES", "%s", ipv6_prefix_to_hosts(buf, sizeof(buf), split_prefix));
+	if (split_prefix > 128) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: IPv6 prefix: %d\n", split_prefix);
+		return -1;
 	}
 
-	output_stop(&jsonchain);
-
+	return show_split_networks(split_prefix, &net, slice, flags);
 }
-
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Membership and overlap checks of a stream of networks against a set
+ * of networks.
+ *
+ * Two networks are either disjoint or one contains the other, so only
+ * the networks of the set which are not contained in another one are
+ * kept. These are disjoint, sorted by their first address and by their
+ * last one alike, and a network is contained in or overlaps one of the
+ * set exactly when it does so with the first kept network which ends at
+ * or after its start. The kept networks are stored in the Eytzinger
+ * (breadth first) order of a binary search tree, so that the first
+ * levels of the search share a few cache lines.
+ */
+
+#define _GNU_SOURCE		/* getline */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "ipcalc.h"
+#include "ipv6.h"
+#include "range.h"
+
+/* The kept networks of every family, once loaded, are in the nodes 1 to
+ * count of the list; node k has the children 2k and 2k + 1 */
+struct network_set {
+	struct range_list v4;
+	struct range_list v6;
+};
+
+/* Drops the networks contained in another one of the sorted array */
+static size_t keep_outer_ipv4(struct ipv4_range *r, size_t n)
+{
+	size_t i, m = 0;
+
+	for (i = 0; i < n; i++) {
+		if (m > 0 && r[i].start <= r[m - 1].end) {
+			/* nested; only the one with the same start can be larger */
+			if (r[i].end > r[m - 1].end)
+				r[m - 1] = r[i];
+			continue;
+		}
+		r[m++] = r[i];
+	}
+	return m;
+}
+
+static size_t keep_outer_ipv6(struct ipv6_range *r, size_t n)
+{
+	size_t i, m = 0;
+
+	for (i = 0; i < n; i++) {
+		if (m > 0 && ipv6_cmp(r[i].start, r[m - 1].end) <= 0) {
+			if (ipv6_cmp(r[i].end, r[m - 1].end) > 0)
+				r[m - 1] = r[i];
+			continue;
+		}
+		r[m++] = r[i];
+	}
+	return m;
+}
+
+/* Stores the sorted elements in the Eytzinger order of dst, starting
+ * with the subtree of node k; returns the index of the next element */
+static size_t eytzinger_fill(char *dst, const char *sorted, size_t elem_size,
+			     size_t n, size_t i, size_t k)
+{
+	if (k <= n) {
+		i = eytzinger_fill(dst, sorted, elem_size, n, i, 2 * k);
+		memcpy(dst + k * elem_size, sorted + i++ * elem_size, elem_size);
+		i = eytzinger_fill(dst, sorted, elem_size, n, i, 2 * k + 1);
+	}
+	return i;
+}
+
+static void eytzinger_build(struct range_list *list, size_t n, size_t elem_size)
+{
+	struct range_list tree = {NULL, 0, 0};
+	size_t i;
+
+	/* node 0 is unused */
+	for (i = 0; i <= n; i++)
+		range_add(&tree, elem_size);
+	eytzinger_fill(tree.data, list->data, elem_size, n, 0, 1);
+
+	range_free(list);
+	*list = tree;
+	list->count = n;
+}
+
+/* The search descends to a leaf and the last node where it went left is
+ * the result; the trailing ones of k are the right turns after it */
+static inline size_t eytzinger_result(size_t k)
+{
+	return k >> (__builtin_ctzll(~(unsigned long long)k) + 1);
+}
+
+/* Returns the first network which ends at or after addr, or NULL */
+static const struct ipv4_range *search_ipv4(const struct range_list *set, uint32_t addr)
+{
+	const struct ipv4_range *r = set->data;
+	size_t k = 1;
+
+	while (k <= set->count)
+		k = 2 * k + (r[k].end < addr);
+	k = eytzinger_result(k);
+
+	return k ? &r[k] : NULL;
+}
+
+static const struct ipv6_range *search_ipv6(const struct range_list *set, struct ipv6_num addr)
+{
+	const struct ipv6_range *r = set->data;
+	size_t k = 1;
+
+	while (k <= set->count)
+		k = 2 * k + (ipv6_cmp(r[k].end, addr) < 0);
+	k = eytzinger_result(k);
+
+	return k ? &r[k] : NULL;
+}
+
+static int set_load(struct network_set *set, const char *file, unsigned flags)
+{
+	FILE *fp;
+	size_t n;
+	int ret;
+
+	memset(set, 0, sizeof(*set));
+
+	fp = fopen(file, "r");
+	if (fp == NULL) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: cannot open %s\n", file);
+		return -1;
+	}
+
+	ret = range_read(fp, flags, &set->v4, &set->v6);
+	fclose(fp);
+	if (ret != 0)
+		return -1;
+
+	range_sort_ipv4(set->v4.data, set->v4.count);
+	n = keep_outer_ipv4(set->v4.data, set->v4.count);
+	eytzinger_build(&set->v4, n, sizeof(struct ipv4_range));
+
+	range_sort_ipv6(set->v6.data, set->v6.count);
+	n = keep_outer_ipv6(set->v6.data, set->v6.count);
+	eytzinger_build(&set->v6, n, sizeof(struct ipv6_range));
+
+	return 0;
+}
+
+static void show_result(const char *query, const char *match, unsigned flags)
+{
+	char buf[256];
+	unsigned jsonchain;
+
+	if (flags & FLAG_JSON) {
+		output_start(&jsonchain);
+		json_printf(&jsonchain, "NETWORK", "%s", json_escape(buf, sizeof(buf), query));
+		if (match)
+			json_printf(&jsonchain, "MATCH", "%s", match);
+		output_stop(&jsonchain);
+		return;
+	}
+
+	output_puts(query);
+	output_puts("\t");
+	output_puts(match ? match : "-");
+	output_puts("\n");
+}
+
+static void show_set_error(const char *str, unsigned flags)
+{
+	char buf[256];
+	unsigned jsonchain;
+
+	if (!beSilent)
+		fprintf(stderr, "ipcalc: bad network: %s\n", str);
+
+	if (!(flags & FLAG_JSON))
+		return;
+
+	output_start(&jsonchain);
+	json_printf(&jsonchain, "INPUT", "%s", json_escape(buf, sizeof(buf), str));
+	json_printf(&jsonchain, "ERROR", "%s", "invalid network");
+	output_stop(&jsonchain);
+}
+
+/*!
+  \fn struct network_set *network_set_open(const char *set_file, unsigned flags)
+  \brief loads a set of networks for network_set_query()
+
+  \param set_file the file with the set of networks.
+  \param flags the flags to use.
+
+  \return the set, or NULL on error.
+*/
+struct network_set *network_set_open(const char *set_file, unsigned flags)
+{
+	struct network_set *set = malloc(sizeof(*set));
+
+	if (set == NULL) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: memory error\n");
+		return NULL;
+	}
+
+	if (set_load(set, set_file, flags) < 0) {
+		network_set_close(set);
+		return NULL;
+	}
+	return set;
+}
+
+void network_set_close(struct network_set *set)
+{
+	if (set) {
+		range_free(&set->v4);
+		range_free(&set->v6);
+		free(set);
+	}
+}
+
+/*!
+  \fn int network_set_query(const struct network_set *set, const char *str, unsigned contains, unsigned flags)
+  \brief prints the network of the set which contains or overlaps a network
+
+  \param set the set of networks.
+  \param str the network.
+  \param contains whether to check for containment rather than overlap.
+  \param flags the flags to use.
+
+  \return 0 on success, or -1 if str is not a valid network.
+*/
+int network_set_query(const struct network_set *set, const char *str, unsigned contains, unsigned flags)
+{
+	char match[INET6_ADDRSTRLEN + 4];
+	struct ipv4_range q4;
+	struct ipv6_range q6;
+	unsigned found = 0;
+	int family;
+
+	family = range_parse(str, flags, &q4, &q6);
+	if (family == AF_INET6) {
+		const struct ipv6_range *r = search_ipv6(&set->v6, q6.start);
+
+		if (r) {
+			if (contains)
+				found = ipv6_cmp(r->start, q6.start) <= 0 &&
+					ipv6_cmp(r->end, q6.end) >= 0;
+			else
+				found = ipv6_cmp(r->start, q6.end) <= 0;
+		}
+		if (found) {
+			struct in6_addr ip;
+
+			ipv6_store(&ip, r->start);
+			format_prefix(match + format_ipv6(match, &ip),
+				      ipv6_clz(ipv6_sub(r->end, r->start)));
+		}
+	} else if (family == AF_INET) {
+		const struct ipv4_range *r = search_ipv4(&set->v4, q4.start);
+
+		if (r) {
+			if (contains)
+				found = r->start <= q4.start && r->end >= q4.end;
+			else
+				found = r->start <= q4.end;
+		}
+		if (found) {
+			uint32_t hostmask = r->end - r->start;
+
+			format_prefix(match + format_ipv4(match, r->start),
+				      hostmask ? __builtin_clz(hostmask) : 32);
+		}
+	} else {
+		show_set_error(str, flags);
+		return -1;
+	}
+
+	show_result(str, found ? match : NULL, flags);
+	return 0;
+}
+
+/*!
+  \fn int check_networks(const char *set_file, FILE *fp, unsigned contains, unsigned flags)
+  \brief checks every network read from fp against the networks in set_file
+
+  The set file and the input contain a network in the ADDRESS[/PREFIX]
+  form per line; only the first field of an input line is used. For
+  every input network, the network is printed followed by the network of
+  the set which contains it or, when contains is zero, which overlaps
+  it, or '-' when there is none. A network of the set which is itself
+  contained in another one is never printed.
+
+  \param set_file the file with the set of networks.
+  \param fp the input stream.
+  \param contains whether to check for containment rather than overlap.
+  \param flags the flags to use.
+
+  \return 0 if all lines were processed, or 1 if any errors were found.
+*/
+int check_networks(const char *set_file, FILE *fp, unsigned contains, unsigned flags)
+{
+	struct network_set set;
+	char *line = NULL;
+	size_t size = 0;
+	int ret = 0;
+
+	if (set_load(&set, set_file, flags) < 0) {
+		range_free(&set.v4);
+		range_free(&set.v6);
+		return 1;
+	}
+
+	while (getline(&line, &size, fp) != -1) {
+		char *str;
+
+		str = trim(line);
+		if (str[0] == 0 || str[0] == '#')
+			continue;
+		str[strcspn(str, " \t")] = 0;
+
+		if (network_set_query(&set, str, contains, flags) < 0)
+			ret = 1;
+	}
+	free(line);
+
+	if (ferror(fp)) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: error reading input\n");
+		ret = 1;
+	}
+
+	range_free(&set.v4);
+	range_free(&set.v6);
+	return ret;
+}
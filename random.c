@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The random private networks of -r. A single network is made of bytes
+ * of the system random source; many of them, with --count, are drawn by
+ * a xoshiro256** generator seeded once. The networks of the prefix in
+ * the private space are numbered, and with --unique the numbers drawn
+ * already are remembered in a bitmap of the whole space, or in a Bloom
+ * filter when the space is much larger than the number of networks.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#ifdef HAVE_GETRANDOM
+#include <sys/random.h>
+#endif
+
+#include "ipcalc.h"
+
+/* The bitmap of the whole space is used up to this many bits, or while
+ * it is smaller than the Bloom filter */
+#define MAX_BITMAP_BITS (1ULL << 28)
+
+/* The bits per network and the probes of the Bloom filter; the probes
+ * of a network are all in one block of 512 bits, a cache line */
+#define BLOOM_BITS 16
+#define BLOOM_PROBES 7
+#define BLOOM_BLOCK_WORDS 8
+
+static int randomize(void *ptr, unsigned size)
+{
+	int fd, ret;
+
+#ifdef HAVE_GETRANDOM
+	if (getrandom(ptr, size, 0) == (ssize_t)size)
+		return 0;
+#endif
+
+	fd = open("/dev/urandom", O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	ret = read(fd, ptr, size);
+	close(fd);
+
+	if (ret != size) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+  \fn char *generate_ip_network(unsigned prefix, unsigned flags)
+  \brief generates a random private network
+
+  \param prefix the prefix of the network.
+  \param flags FLAG_IPV6 for a unique local IPv6 network.
+
+  \return the network as an allocated string, or NULL on error.
+*/
+char *generate_ip_network(unsigned prefix, unsigned flags)
+{
+	char ipbuf[64];
+	char *p = NULL;
+
+	if (flags & FLAG_IPV6) {
+		struct in6_addr net;
+
+		if (randomize(&net.s6_addr, 16) < 0)
+			return NULL;
+		net.s6_addr[0] = 0xfc | (net.s6_addr[0] & 1);
+
+		if (inet_ntop(AF_INET6, &net, ipbuf, sizeof(ipbuf)) == NULL)
+			return NULL;
+	} else {
+		struct in_addr net;
+		uint8_t bytes[5];
+		unsigned c;
+
+		if (randomize(bytes, 5) < 0)
+			return NULL;
+		c = bytes[4] % 4;
+
+		if (prefix >= 16 && c < 2) {
+			if (c == 1) {
+				bytes[0] = 192;
+				bytes[1] = 168;
+			} else {
+				bytes[0] = 172;
+				bytes[1] = 16 | ((bytes[4] >> 4) & 0x0f);
+			}
+		} else {
+			bytes[0] = 10;
+		}
+
+		memcpy(&net.s_addr, bytes, 4);
+
+		if (inet_ntop(AF_INET, &net, ipbuf, sizeof(ipbuf)) == NULL)
+			return NULL;
+	}
+
+	if (asprintf(&p, "%s/%u", ipbuf, prefix) == -1)
+		return NULL;
+
+	return p;
+}
+
+typedef struct rng_st {
+	uint64_t s[4];
+} rng_st;
+
+static uint64_t rotl(uint64_t x, unsigned k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+/* xoshiro256** */
+static uint64_t rng_next(rng_st *rng)
+{
+	uint64_t *s = rng->s;
+	uint64_t r = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+
+	return r;
+}
+
+static uint64_t mix64(uint64_t x)
+{
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+/* The networks drawn already */
+typedef struct seen_st {
+	uint64_t *bits;
+	uint64_t blocks;	/* of the Bloom filter; a power of two */
+	unsigned bloom;
+} seen_st;
+
+static int seen_init(seen_st *seen, unsigned index_bits, uint64_t space, uint64_t count)
+{
+	uint64_t size;
+
+	memset(seen, 0, sizeof(*seen));
+
+	if (index_bits < 64 && (space <= MAX_BITMAP_BITS || space / BLOOM_BITS <= count)) {
+		size = space;
+	} else {
+		seen->bloom = 1;
+		for (size = 1024; size / BLOOM_BITS < count && size < (1ULL << 62); size <<= 1)
+			;
+		seen->blocks = size / (64 * BLOOM_BLOCK_WORDS);
+	}
+
+	seen->bits = calloc((size + 63) / 64, sizeof(uint64_t));
+	return seen->bits == NULL ? -1 : 0;
+}
+
+/* Marks the network with the given index, and returns whether it was
+ * marked already; the Bloom filter may also claim so for a new one */
+static unsigned seen_test_and_set(seen_st *seen, const uint64_t index[2])
+{
+	uint64_t h, *block;
+	unsigned i, bit, found = 1;
+
+	if (!seen->bloom) {
+		found = (seen->bits[index[1] / 64] >> (index[1] % 64)) & 1;
+		seen->bits[index[1] / 64] |= 1ULL << (index[1] % 64);
+		return found;
+	}
+
+	h = mix64(index[0] ^ mix64(index[1]));
+	block = &seen->bits[(h & (seen->blocks - 1)) * BLOOM_BLOCK_WORDS];
+
+	/* 9 bits of the other hash for every probe */
+	h = mix64(h);
+	for (i = 0; i < BLOOM_PROBES; i++, h >>= 9) {
+		bit = h & 511;
+		if (!((block[bit / 64] >> (bit % 64)) & 1)) {
+			block[bit / 64] |= 1ULL << (bit % 64);
+			found = 0;
+		}
+	}
+	return found;
+}
+
+/* Draws a random number below space, of at most index_bits bits; from
+ * 64 bits on the space is 2^index_bits */
+static void draw_index(rng_st *rng, unsigned index_bits, uint64_t space, uint64_t index[2])
+{
+	if (index_bits >= 64) {
+		index[0] = index_bits > 64 ? rng_next(rng) >> (128 - index_bits) : 0;
+		index[1] = rng_next(rng);
+		return;
+	}
+
+	index[0] = 0;
+	do {
+		index[1] = index_bits ? rng_next(rng) >> (64 - index_bits) : 0;
+	} while (index[1] >= space);
+}
+
+/* The network of the given index in 10.0.0.0/8, 172.16.0.0/12 and
+ * 192.168.0.0/16, in this order */
+static void index_to_net4(unsigned prefix, uint64_t index, ipcalc_net_st *net)
+{
+	uint64_t n10 = 1ULL << (prefix - 8);
+	uint64_t n172 = prefix >= 12 ? 1ULL << (prefix - 12) : 0;
+	uint32_t base;
+
+	if (index < n10) {
+		base = 0x0a000000;
+	} else if (index - n10 < n172) {
+		index -= n10;
+		base = 0xac100000;
+	} else {
+		index -= n10 + n172;
+		base = 0xc0a80000;
+	}
+
+	net->addr.v4.s_addr = htonl(base | (uint32_t)(index << (32 - prefix)));
+}
+
+/* The network of the given index in fc00::/7 */
+static void index_to_net6(unsigned prefix, const uint64_t index[2], ipcalc_net_st *net)
+{
+	unsigned shift = 128 - prefix, i;
+	uint64_t a[2];
+
+	if (shift >= 64) {
+		a[0] = index[1] << (shift - 64);
+		a[1] = 0;
+	} else if (shift == 0) {
+		a[0] = index[0];
+		a[1] = index[1];
+	} else {
+		a[0] = (index[0] << shift) | (index[1] >> (64 - shift));
+		a[1] = index[1] << shift;
+	}
+	a[0] |= 0xfcULL << 56;
+
+	for (i = 0; i < 8; i++) {
+		net->addr.v6.s6_addr[i] = a[0] >> (56 - 8 * i);
+		net->addr.v6.s6_addr[8 + i] = a[1] >> (56 - 8 * i);
+	}
+}
+
+/*!
+  \fn int show_random_networks(unsigned prefix, uint64_t count, unsigned unique, unsigned flags)
+  \brief prints random private networks
+
+  The IPv4 networks are drawn from 10.0.0.0/8, 172.16.0.0/12 and
+  192.168.0.0/16 and the IPv6 ones from fc00::/7, every network of the
+  prefix with the same probability.
+
+  \param prefix the prefix of the networks.
+  \param count the number of networks to print.
+  \param unique if non-zero, every network is printed at most once.
+  \param flags the output flags; FLAG_IPV6 for IPv6 networks.
+
+  \return 0 on success, or -1 on error.
+*/
+int show_random_networks(unsigned prefix, uint64_t count, unsigned unique, unsigned flags)
+{
+	unsigned is_ipv6 = (flags & FLAG_IPV6) != 0;
+	unsigned min_prefix = is_ipv6 ? 7 : 8;
+	unsigned index_bits, jsonchain;
+	uint64_t space, index[2], i;
+	ipcalc_net_st net;
+	seen_st seen;
+	rng_st rng;
+	uint64_t t;
+
+	if (prefix < min_prefix) {
+		if (!beSilent)
+			fprintf(stderr,
+				"ipcalc: the prefix of random %s networks must be at least %u\n",
+				is_ipv6 ? "IPv6" : "IPv4", min_prefix);
+		return -1;
+	}
+
+	if (is_ipv6) {
+		index_bits = prefix - 7;
+		space = index_bits < 64 ? 1ULL << index_bits : UINT64_MAX;
+	} else {
+		space = (1ULL << (prefix - 8)) + (prefix >= 12 ? 1ULL << (prefix - 12) : 0) +
+			(prefix >= 16 ? 1ULL << (prefix - 16) : 0);
+		for (index_bits = 0; (1ULL << index_bits) < space; index_bits++)
+			;
+	}
+
+	if (unique && index_bits < 64 && count > space) {
+		if (!beSilent)
+			fprintf(stderr,
+				"ipcalc: cannot generate %" PRIu64 " unique networks, the private space has %" PRIu64 " with prefix %u\n",
+				count, space, prefix);
+		return -1;
+	}
+
+	do {
+		if (randomize(rng.s, sizeof(rng.s)) < 0) {
+			if (!beSilent)
+				fprintf(stderr, "ipcalc: cannot read random data\n");
+			return -1;
+		}
+	} while ((rng.s[0] | rng.s[1] | rng.s[2] | rng.s[3]) == 0);
+
+	if (unique && seen_init(&seen, index_bits, space, count) < 0) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: memory allocation failure\n");
+		return -1;
+	}
+
+	net.family = is_ipv6 ? AF_INET6 : AF_INET;
+	net.prefix = prefix;
+
+	output_start(&jsonchain);
+	array_start(&jsonchain, "Random networks", "RANDOMNETWORK");
+
+	t = stats_start();
+	for (i = 0; i < count; i++) {
+		do {
+			draw_index(&rng, index_bits, space, index);
+		} while (unique && seen_test_and_set(&seen, index));
+
+		if (is_ipv6)
+			index_to_net6(prefix, index, &net);
+		else
+			index_to_net4(prefix, index[1], &net);
+
+		output_network(&net, &jsonchain);
+	}
+	stats_lap(STATS_OUTPUT, &t);
+
+	array_stop(&jsonchain);
+	output_stop(&jsonchain);
+
+	if (unique)
+		free(seen.bits);
+	return 0;
+}
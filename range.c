@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Lists of networks kept as address ranges, as read by the modes which
+ * operate on a set of networks.
+ */
+
+#define _GNU_SOURCE		/* getline */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "ipcalc.h"
+#include "range.h"
+
+/*!
+  \fn void *range_add(struct range_list *list, size_t elem_size)
+  \brief appends an element to a range list
+
+  \param list the list.
+  \param elem_size the size of the elements of the list.
+
+  \return a pointer to the new, uninitialized, element.
+*/
+void *range_add(struct range_list *list, size_t elem_size)
+{
+	if (list->count == list->size) {
+		size_t size = list->size ? 2 * list->size : 1024;
+
+		list->data = safe_realloc(list->data, size * elem_size);
+		list->size = size;
+	}
+
+	return (char *)list->data + list->count++ * elem_size;
+}
+
+void range_free(struct range_list *list)
+{
+	free(list->data);
+	list->data = NULL;
+	list->count = list->size = 0;
+}
+
+/* Least significant digit first radix sort on the first address, one
+ * byte per pass. All the histograms are computed in a single read of
+ * the input, and passes where every element has the same digit are
+ * skipped. */
+void range_sort_ipv4(struct ipv4_range *r, size_t n)
+{
+	static size_t count[4][256];
+	struct ipv4_range *tmp, *src = r, *dst;
+	unsigned pass, d;
+	size_t i;
+
+	if (n < 2)
+		return;
+
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++) {
+		for (pass = 0; pass < 4; pass++)
+			count[pass][(r[i].start >> (pass * 8)) & 0xff]++;
+	}
+
+	tmp = dst = safe_realloc(NULL, n * sizeof(*tmp));
+	for (pass = 0; pass < 4; pass++) {
+		size_t offset = 0;
+		unsigned shift = pass * 8;
+
+		if (count[pass][(r[0].start >> shift) & 0xff] == n)
+			continue;
+
+		for (d = 0; d < 256; d++) {
+			size_t c = count[pass][d];
+
+			count[pass][d] = offset;
+			offset += c;
+		}
+
+		for (i = 0; i < n; i++)
+			dst[count[pass][(src[i].start >> shift) & 0xff]++] = src[i];
+
+		dst = src;
+		src = (src == r) ? tmp : r;
+	}
+
+	if (src != r)
+		memcpy(r, src, n * sizeof(*r));
+	free(tmp);
+}
+
+static unsigned ipv6_digit(const struct ipv6_num *n, unsigned pass)
+{
+	return (pass < 8 ? n->lo >> (pass * 8) : n->hi >> ((pass - 8) * 8)) & 0xff;
+}
+
+void range_sort_ipv6(struct ipv6_range *r, size_t n)
+{
+	static size_t count[16][256];
+	struct ipv6_range *tmp, *src = r, *dst;
+	unsigned pass, d;
+	size_t i;
+
+	if (n < 2)
+		return;
+
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++) {
+		for (pass = 0; pass < 16; pass++)
+			count[pass][ipv6_digit(&r[i].start, pass)]++;
+	}
+
+	tmp = dst = safe_realloc(NULL, n * sizeof(*tmp));
+	for (pass = 0; pass < 16; pass++) {
+		size_t offset = 0;
+
+		if (count[pass][ipv6_digit(&r[0].start, pass)] == n)
+			continue;
+
+		for (d = 0; d < 256; d++) {
+			size_t c = count[pass][d];
+
+			count[pass][d] = offset;
+			offset += c;
+		}
+
+		for (i = 0; i < n; i++)
+			dst[count[pass][ipv6_digit(&src[i].start, pass)]++] = src[i];
+
+		dst = src;
+		src = (src == r) ? tmp : r;
+	}
+
+	if (src != r)
+		memcpy(r, src, n * sizeof(*r));
+	free(tmp);
+}
+
+/*!
+  \fn size_t range_merge_ipv4(struct ipv4_range *r, size_t n)
+  \brief sorts the ranges and merges the overlapping or adjacent ones
+
+  \param r the ranges.
+  \param n the number of ranges.
+
+  \return the number of ranges left at the start of r; these are sorted,
+  disjoint and not adjacent.
+*/
+size_t range_merge_ipv4(struct ipv4_range *r, size_t n)
+{
+	size_t i, m = 0;
+
+	range_sort_ipv4(r, n);
+
+	for (i = 0; i < n; i++) {
+		if (m > 0 && (r[m - 1].end == UINT32_MAX || r[i].start <= r[m - 1].end + 1)) {
+			if (r[i].end > r[m - 1].end)
+				r[m - 1].end = r[i].end;
+			continue;
+		}
+		r[m++] = r[i];
+	}
+	return m;
+}
+
+size_t range_merge_ipv6(struct ipv6_range *r, size_t n)
+{
+	const struct ipv6_num all = ipv6_low_mask(128);
+	size_t i, m = 0;
+
+	range_sort_ipv6(r, n);
+
+	for (i = 0; i < n; i++) {
+		if (m > 0 && (ipv6_cmp(r[m - 1].end, all) == 0 ||
+			      ipv6_cmp(r[i].start, ipv6_add(r[m - 1].end, ipv6_bit(0))) <= 0)) {
+			if (ipv6_cmp(r[i].end, r[m - 1].end) > 0)
+				r[m - 1].end = r[i].end;
+			continue;
+		}
+		r[m++] = r[i];
+	}
+	return m;
+}
+
+/*!
+  \fn int range_parse(const char *str, unsigned flags, struct ipv4_range *r4, struct ipv6_range *r6)
+  \brief parses a network to the range of its addresses
+
+  The network is in the ADDRESS[/PREFIX] form accepted by parse_network();
+  the host bits of the address are ignored.
+
+  \param str the network.
+  \param flags the flags to use.
+  \param r4 where to store the range of an IPv4 network.
+  \param r6 where to store the range of an IPv6 network.
+
+  \return AF_INET or AF_INET6, depending on which range was set, or -1
+  if str is not a valid network.
+*/
+int range_parse(const char *str, unsigned flags, struct ipv4_range *r4, struct ipv6_range *r6)
+{
+	struct in6_addr addr;
+	unsigned prefix;
+	int family;
+
+	family = parse_network(str, flags, &addr, &prefix);
+	if (family == AF_INET6) {
+		r6->start = ipv6_and(ipv6_load(&addr), ipv6_prefix_mask(prefix));
+		r6->end = ipv6_or(r6->start, ipv6_low_mask(128 - prefix));
+	} else if (family == AF_INET) {
+		uint32_t hostmask = (prefix == 32) ? 0 : UINT32_MAX >> prefix;
+		struct in_addr *ip = (struct in_addr *)&addr;
+
+		r4->start = ntohl(ip->s_addr) & ~hostmask;
+		r4->end = r4->start | hostmask;
+	}
+
+	return family;
+}
+
+/*!
+  \fn int range_read(FILE *fp, unsigned flags, struct range_list *v4, struct range_list *v6)
+  \brief reads a list of networks
+
+  Every line of the input is expected to contain a network in the
+  ADDRESS[/PREFIX] format; IPv4 and IPv6 networks may be mixed. Empty
+  lines and lines starting with '#' are ignored. Invalid lines are
+  reported on standard error and skipped.
+
+  \param fp the input stream.
+  \param flags the flags to use.
+  \param v4 the list to append the IPv4 networks to.
+  \param v6 the list to append the IPv6 networks to.
+
+  \return 0 if all lines were read, or 1 if any errors were found.
+*/
+int range_read(FILE *fp, unsigned flags, struct range_list *v4, struct range_list *v6)
+{
+	struct ipv4_range r4;
+	struct ipv6_range r6;
+	char *line = NULL, *str;
+	size_t size = 0;
+	int family, ret = 0;
+
+	while (getline(&line, &size, fp) != -1) {
+		str = trim(line);
+		if (str[0] == 0 || str[0] == '#')
+			continue;
+
+		family = range_parse(str, flags, &r4, &r6);
+		if (family == AF_INET6) {
+			*(struct ipv6_range *)range_add(v6, sizeof(r6)) = r6;
+		} else if (family == AF_INET) {
+			*(struct ipv4_range *)range_add(v4, sizeof(r4)) = r4;
+		} else {
+			if (!beSilent)
+				fprintf(stderr, "ipcalc: bad network: %s\n", str);
+			ret = 1;
+		}
+	}
+	free(line);
+
+	if (ferror(fp)) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: error reading input\n");
+		ret = 1;
+	}
+
+	return ret;
+}
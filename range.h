@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RANGE_H
+#define RANGE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ipv6.h"
+
+/* The addresses from start to end, inclusive */
+struct ipv4_range {
+	uint32_t start;
+	uint32_t end;
+};
+
+struct ipv6_range {
+	struct ipv6_num start;
+	struct ipv6_num end;
+};
+
+/* A growable array of ranges of either family */
+struct range_list {
+	void *data;
+	size_t count;
+	size_t size;
+};
+
+void *range_add(struct range_list *list, size_t elem_size);
+void range_free(struct range_list *list);
+
+void range_sort_ipv4(struct ipv4_range *r, size_t n);
+void range_sort_ipv6(struct ipv6_range *r, size_t n);
+
+size_t range_merge_ipv4(struct ipv4_range *r, size_t n);
+size_t range_merge_ipv6(struct ipv6_range *r, size_t n);
+
+int range_parse(const char *str, unsigned flags, struct ipv4_range *r4, struct ipv6_range *r6);
+int range_read(FILE *fp, unsigned flags, struct range_list *v4, struct range_list *v6);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <stdint.h>
+
+#include "ipcalc.h"
+
+/* The prefix of the zones when none is given: the prefix of the network
+ * rounded up to a label boundary */
+static unsigned default_zone_prefix(const ipcalc_net_st *net)
+{
+	if (net->family == AF_INET6)
+		return (net->prefix + 3) / 4 * 4;
+	return net->prefix < 8 ? 8 : (net->prefix + 7) / 8 * 8;
+}
+
+/* Prints the names of the PTR records of every address of the zone */
+static void show_ptr_stubs(unsigned *jsonchain, const ipcalc_net_st *zone)
+{
+	ipcalc_revzone_st it;
+	const char *name;
+	char head[IPCALC_REVERSE_SIZE];
+
+	if (ipcalc_reverse_dns(zone, head, sizeof(head)) < 0 ||
+	    ipcalc_revzone_init(&it, zone, zone->family == AF_INET6 ? 128 : 32) < 0)
+		return;
+
+	array_start(jsonchain, head, head);
+	while (ipcalc_revzone_next(&it, &name) > 0)
+		default_puts(jsonchain, "PTR:\t", NULL, name);
+	array_stop(jsonchain);
+}
+
+static int ptr_stubs_cb(const ipcalc_net_st *zone, void *jsonchain)
+{
+	show_ptr_stubs(jsonchain, zone);
+	return 0;
+}
+
+/*!
+  \fn int show_reverse_zones(const char *zone_prefix, const struct ip_info_st *info, unsigned ptr_stubs, unsigned flags)
+  \brief prints the reverse DNS zones of a network
+
+  \param zone_prefix the prefix of the zones, or NULL for the prefix of
+  the network rounded up to a label boundary.
+  \param info the network.
+  \param ptr_stubs if non-zero, every zone is followed by the names of
+  the PTR records of its addresses.
+  \param flags the output flags.
+
+  \return 0 on success, or -1 on error.
+*/
+int show_reverse_zones(const char *zone_prefix, const struct ip_info_st *info, unsigned ptr_stubs, unsigned flags)
+{
+	const char *family = (flags & FLAG_IPV6) ? "IPv6" : "IPv4";
+	ipcalc_revzone_st it;
+	ipcalc_split_st split;
+	ipcalc_net_st net;
+	unsigned jsonchain = JSON_FIRST;
+	const char *name;
+	int prefix;
+	uint64_t t;
+
+	net.family = (flags & FLAG_IPV6) ? AF_INET6 : AF_INET;
+	net.prefix = info->prefix;
+	if (inet_pton(net.family, info->network, &net.addr) <= 0) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: bad %s address: %s\n", family, info->network);
+		return -1;
+	}
+
+	if (zone_prefix) {
+		prefix = str_to_prefix(&flags, zone_prefix, 0);
+		if (prefix < 0) {
+			if (!beSilent)
+				fprintf(stderr, "ipcalc: bad %s prefix: %s\n", family, zone_prefix);
+			return -1;
+		}
+	} else {
+		prefix = default_zone_prefix(&net);
+	}
+
+	if ((unsigned)prefix < net.prefix) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: the zone prefix /%d is shorter than the network prefix /%u\n",
+				prefix, net.prefix);
+		return -1;
+	}
+
+	if (ipcalc_revzone_init(&it, &net, prefix) < 0 ||
+	    ipcalc_split_init(&split, &net, prefix) < 0) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: the %s zone prefix must be %s: %d\n", family,
+				net.family == AF_INET6 ? "a multiple of 4" : "at least 8", prefix);
+		return -1;
+	}
+
+	output_start(&jsonchain);
+
+	t = stats_start();
+	if (ptr_stubs) {
+		ipcalc_split_foreach(&split, ptr_stubs_cb, &jsonchain);
+	} else {
+		array_start(&jsonchain, "Reverse zones", "REVERSEZONE");
+		while (ipcalc_revzone_next(&it, &name) > 0)
+			default_puts(&jsonchain, "Zone:\t", NULL, name);
+		array_stop(&jsonchain);
+	}
+	stats_lap(STATS_OUTPUT, &t);
+
+	output_stop(&jsonchain);
+	return 0;
+}
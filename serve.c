@@ -0,0 +1,734 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The --serve mode: a long lived process answering queries over a Unix
+ * stream socket, with the prefix table, the network set and the GeoIP
+ * databases loaded once.
+ *
+ * The main thread runs an epoll loop which accepts the connections,
+ * reads the requests and writes the replies, and a pool of threads
+ * answers the requests. All the complete lines received on a connection
+ * are handed to a worker at once, and the next ones wait until their
+ * replies are written out, so that the replies of a connection are in
+ * the order of its requests and a client which does not read them is
+ * not read from either.
+ *
+ * On SIGHUP the tables are loaded again and the GeoIP databases are
+ * reopened. The workers hold a read lock over the tables while they
+ * answer, and the new tables replace the old ones under the write lock.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "ipcalc.h"
+
+/* The longest request; a connection sending a longer line is closed */
+#define MAX_REQUEST 4096
+
+/* The data read from a connection at once */
+#define READ_SIZE 16384
+
+#define MAX_EVENTS 64
+
+struct conn {
+	int fd;		/* -1 once closed */
+	uint32_t events;	/* the events waited for */
+
+	/* the data received and not yet handed to a worker */
+	char *in;
+	size_t in_len, in_size;
+
+	/* the complete lines given to a worker and their replies, which
+	 * belong to the worker while busy is set */
+	char *job;
+	size_t job_len, job_size;
+	struct output_buf reply;
+	size_t sent;	/* the part of the replies written out */
+
+	unsigned busy;
+	unsigned eof;	/* the client sends no more requests */
+	unsigned dead;	/* the connection is closed once its worker is done */
+
+	struct conn *next;	/* in the queue of jobs or the done list */
+	struct conn *prev_open, *next_open;
+};
+
+struct server {
+	int listen_fd;
+	int signal_fd;
+	int event_fd;	/* signalled by the workers when a job is done */
+	int epoll_fd;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct conn *queue, *queue_tail;
+	struct conn *done;
+	unsigned stop;
+
+	struct conn *open;	/* all the connections not yet freed */
+	struct conn *closed;	/* freed after the events being handled */
+
+	pthread_rwlock_t tables_lock;
+	struct lpm_table *lpm;
+	struct network_set *set;
+	const char *lpm_file;
+	const char *set_file;
+	unsigned geo;
+
+	unsigned flags;
+
+	/* whether -s was given; once serving, beSilent is set so that the
+	 * errors of the requests are only reported in the replies */
+	unsigned quiet;
+};
+
+static void show_request_error(const char *str, const char *error)
+{
+	char buf[256];
+	unsigned jsonchain;
+
+	output_start(&jsonchain);
+	json_printf(&jsonchain, "INPUT", "%s", json_escape(buf, sizeof(buf), str));
+	json_printf(&jsonchain, "ERROR", "%s", error);
+	output_stop(&jsonchain);
+}
+
+/* Prints the information of an address in the ADDRESS[/PREFIX] or the
+ * ADDRESS NETMASK form, as --batch does */
+static void serve_info(char *str, unsigned flags)
+{
+	char *prefixStr = NULL, *space, *slash;
+	ip_info_st info;
+
+	if ((flags & FLAG_IPV4) == 0 && strchr(str, ':') != NULL)
+		flags |= FLAG_IPV6;
+
+	space = strpbrk(str, " \t");
+	if (space) {
+		*space = 0;
+		prefixStr = trim(space + 1);
+	}
+
+	slash = strchr(str, '/');
+	if (get_info(str, prefixStr, &info, &flags) < 0) {
+		if (slash)
+			*slash = '/';
+		if (space)
+			*space = ' ';
+		show_request_error(str, "invalid address");
+		return;
+	}
+
+	show_info(&info, NULL, flags);
+}
+
+/* Answers a request; every request but an empty line gets exactly one
+ * line of reply */
+static void serve_request(struct server *srv, char *line)
+{
+	unsigned flags = srv->flags;
+	char *str, *arg;
+	size_t len;
+
+	str = trim(line);
+	if (str[0] == 0)
+		return;
+
+	len = strcspn(str, " \t");
+	arg = str + len;
+	if (*arg) {
+		*arg = 0;
+		arg = trim(arg + 1);
+	}
+
+	if (strcmp(str, "info") == 0 || strcmp(str, "geo") == 0) {
+		if (arg[0] == 0) {
+			show_request_error(str, "missing address");
+		} else if (str[0] == 'g' && !srv->geo) {
+			show_request_error(arg, "GeoIP is not available");
+		} else {
+			if (str[0] == 'g')
+				flags |= FLAG_GET_GEOIP;
+			serve_info(arg, flags);
+		}
+	} else if (strcmp(str, "lpm") == 0) {
+		arg[strcspn(arg, " \t")] = 0;
+		if (srv->lpm == NULL)
+			show_request_error(arg, "no prefix table loaded");
+		else
+			lpm_query(srv->lpm, arg, flags);
+	} else if (strcmp(str, "contains") == 0 || strcmp(str, "overlaps") == 0) {
+		arg[strcspn(arg, " \t")] = 0;
+		if (srv->set == NULL)
+			show_request_error(arg, "no network set loaded");
+		else
+			network_set_query(srv->set, arg, str[0] == 'c', flags);
+	} else {
+		/* a line with just an address, as in the --batch input */
+		if (arg != str + len)
+			str[len] = ' ';
+		serve_info(str, flags);
+	}
+}
+
+static void serve_job(struct server *srv, struct conn *c)
+{
+	char *line = c->job, *end = c->job + c->job_len, *nl;
+
+	output_set(&c->reply);
+	while (line < end) {
+		nl = memchr(line, '\n', end - line);
+		*nl = 0;
+		serve_request(srv, line);
+		line = nl + 1;
+	}
+	output_set(NULL);
+}
+
+static void *serve_worker(void *arg)
+{
+	struct server *srv = arg;
+	const uint64_t one = 1;
+	struct conn *c;
+
+	pthread_mutex_lock(&srv->lock);
+	while (1) {
+		while (srv->queue == NULL && !srv->stop)
+			pthread_cond_wait(&srv->cond, &srv->lock);
+		if (srv->queue == NULL)
+			break;
+
+		c = srv->queue;
+		srv->queue = c->next;
+		if (srv->queue == NULL)
+			srv->queue_tail = NULL;
+		pthread_mutex_unlock(&srv->lock);
+
+		pthread_rwlock_rdlock(&srv->tables_lock);
+		serve_job(srv, c);
+		pthread_rwlock_unlock(&srv->tables_lock);
+
+		pthread_mutex_lock(&srv->lock);
+		c->next = srv->done;
+		srv->done = c;
+		/* the counter cannot overflow, so this never fails */
+		if (write(srv->event_fd, &one, sizeof(one)) < 0 && !srv->quiet)
+			fprintf(stderr, "ipcalc: cannot wake up the server\n");
+	}
+	pthread_mutex_unlock(&srv->lock);
+
+	stats_merge();
+	return NULL;
+}
+
+static void conn_wait(struct server *srv, struct conn *c, uint32_t events)
+{
+	struct epoll_event ev;
+
+	if (c->events == events)
+		return;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.ptr = c;
+	epoll_ctl(srv->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+	c->events = events;
+}
+
+static void conn_close(struct server *srv, struct conn *c)
+{
+	close(c->fd);
+	c->fd = -1;
+
+	if (c->prev_open)
+		c->prev_open->next_open = c->next_open;
+	else
+		srv->open = c->next_open;
+	if (c->next_open)
+		c->next_open->prev_open = c->prev_open;
+
+	c->next = srv->closed;
+	srv->closed = c;
+}
+
+static void conn_free(struct conn *c)
+{
+	free(c->in);
+	free(c->job);
+	free(c->reply.data);
+	free(c);
+}
+
+/* Writes out the replies; returns 0 once all are written, 1 when the
+ * socket is full and -1 on error */
+static int conn_send(struct conn *c)
+{
+	ssize_t n;
+
+	while (c->sent < c->reply.len) {
+		n = send(c->fd, c->reply.data + c->sent, c->reply.len - c->sent, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : -1;
+		}
+		c->sent += n;
+	}
+
+	c->sent = c->reply.len = 0;
+	return 0;
+}
+
+/* Moves a connection on once its worker is done: writes out the
+ * replies, then hands the next requests to a worker, or waits for them */
+static void conn_progress(struct server *srv, struct conn *c)
+{
+	char *nl;
+	int r;
+
+	if (c->busy)
+		return;
+
+	if (c->dead || (r = conn_send(c)) < 0) {
+		conn_close(srv, c);
+		return;
+	}
+	if (r > 0) {
+		conn_wait(srv, c, EPOLLOUT);
+		return;
+	}
+
+	nl = c->in_len ? memrchr(c->in, '\n', c->in_len) : NULL;
+	if (nl == NULL) {
+		if (c->eof || c->in_len > MAX_REQUEST)
+			conn_close(srv, c);
+		else
+			conn_wait(srv, c, EPOLLIN);
+		return;
+	}
+
+	c->job_len = nl + 1 - c->in;
+	if (c->job_size < c->job_len) {
+		c->job_size = c->job_len;
+		c->job = safe_realloc(c->job, c->job_size);
+	}
+	memcpy(c->job, c->in, c->job_len);
+	c->in_len -= c->job_len;
+	memmove(c->in, nl + 1, c->in_len);
+
+	/* only errors are reported until the worker is done */
+	conn_wait(srv, c, 0);
+	c->busy = 1;
+
+	pthread_mutex_lock(&srv->lock);
+	c->next = NULL;
+	if (srv->queue_tail)
+		srv->queue_tail->next = c;
+	else
+		srv->queue = c;
+	srv->queue_tail = c;
+	pthread_cond_signal(&srv->cond);
+	pthread_mutex_unlock(&srv->lock);
+}
+
+static void conn_read(struct server *srv, struct conn *c)
+{
+	ssize_t n;
+
+	if (c->in_size - c->in_len < READ_SIZE) {
+		c->in_size = c->in_len + READ_SIZE;
+		c->in = safe_realloc(c->in, c->in_size);
+	}
+
+	n = recv(c->fd, c->in + c->in_len, READ_SIZE, 0);
+	if (n > 0) {
+		c->in_len += n;
+	} else if (n == 0) {
+		/* the last request may lack its newline */
+		c->eof = 1;
+		if (c->in_len > 0 && c->in[c->in_len - 1] != '\n')
+			c->in[c->in_len++] = '\n';
+	} else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+		c->dead = 1;
+	}
+
+	conn_progress(srv, c);
+}
+
+static void conn_event(struct server *srv, struct conn *c, uint32_t events)
+{
+	if (c->fd < 0)
+		return;
+
+	if (c->busy) {
+		/* the client is gone; stop watching until the worker is done */
+		epoll_ctl(srv->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+		c->dead = 1;
+	} else if (events & EPOLLIN) {
+		conn_read(srv, c);
+	} else {
+		if (!(events & EPOLLOUT))
+			c->dead = 1;
+		conn_progress(srv, c);
+	}
+}
+
+static void serve_accept(struct server *srv)
+{
+	struct epoll_event ev;
+	struct conn *c;
+	int fd;
+
+	while (1) {
+		fd = accept4(srv->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK && !srv->quiet)
+				fprintf(stderr, "ipcalc: cannot accept a connection: %s\n", strerror(errno));
+			return;
+		}
+
+		c = calloc(1, sizeof(*c));
+		if (c == NULL) {
+			close(fd);
+			continue;
+		}
+		c->fd = fd;
+		c->events = EPOLLIN;
+		output_init(&c->reply, NULL);
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = c;
+		if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			close(fd);
+			free(c);
+			continue;
+		}
+
+		c->next_open = srv->open;
+		if (srv->open)
+			srv->open->prev_open = c;
+		srv->open = c;
+	}
+}
+
+static void serve_done(struct server *srv)
+{
+	struct conn *c, *next;
+	uint64_t count;
+
+	if (read(srv->event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		return;
+
+	pthread_mutex_lock(&srv->lock);
+	c = srv->done;
+	srv->done = NULL;
+	pthread_mutex_unlock(&srv->lock);
+
+	for (; c; c = next) {
+		next = c->next;
+		c->busy = 0;
+		conn_progress(srv, c);
+	}
+}
+
+/* Loads the tables again and reopens the GeoIP databases; a table which
+ * cannot be loaded is kept as it is */
+static void serve_reload(struct server *srv)
+{
+	struct lpm_table *lpm = NULL;
+	struct network_set *set = NULL;
+
+	if (srv->lpm_file) {
+		lpm = lpm_open(srv->lpm_file, srv->flags);
+		if (lpm == NULL && !srv->quiet)
+			fprintf(stderr, "ipcalc: cannot load %s, keeping the loaded table\n", srv->lpm_file);
+	}
+
+	if (srv->set_file) {
+		set = network_set_open(srv->set_file, srv->flags);
+		if (set == NULL && !srv->quiet)
+			fprintf(stderr, "ipcalc: cannot load %s, keeping the loaded set\n", srv->set_file);
+	}
+
+	pthread_rwlock_wrlock(&srv->tables_lock);
+	if (lpm) {
+		struct lpm_table *old = srv->lpm;
+
+		srv->lpm = lpm;
+		lpm = old;
+	}
+	if (set) {
+		struct network_set *old = srv->set;
+
+		srv->set = set;
+		set = old;
+	}
+	if (srv->geo)
+		geo_reload();
+	pthread_rwlock_unlock(&srv->tables_lock);
+
+	lpm_close(lpm);
+	network_set_close(set);
+}
+
+static void serve_signal(struct server *srv)
+{
+	struct signalfd_siginfo si;
+
+	while (read(srv->signal_fd, &si, sizeof(si)) == sizeof(si)) {
+		if (si.ssi_signo == SIGHUP)
+			serve_reload(srv);
+		else
+			srv->stop = 1;
+	}
+}
+
+static int serve_listen(const char *path)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: the socket path is too long: %s\n", path);
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		goto fail;
+
+	/* replace the socket of a server which is no longer running */
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+		int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+		if (probe >= 0) {
+			if (connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+				close(probe);
+				errno = EADDRINUSE;
+				goto fail;
+			}
+			close(probe);
+		}
+		unlink(path);
+	}
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(fd, SOMAXCONN) < 0)
+		goto fail;
+
+	return fd;
+ fail:
+	if (!beSilent)
+		fprintf(stderr, "ipcalc: cannot listen on %s: %s\n", path, strerror(errno));
+	if (fd >= 0)
+		close(fd);
+	return -1;
+}
+
+static int epoll_add(int epoll_fd, int fd, void *ptr)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = ptr;
+	return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/*!
+  \fn int serve(const char *path, const char *lpm_file, const char *set_file, unsigned flags, unsigned jobs)
+  \brief answers the queries of the clients of a Unix socket until SIGINT or SIGTERM
+
+  Every line of a request is answered with a line of JSON. A line is one
+  of "info ADDRESS", with the information of the address as printed with
+  --batch, "geo ADDRESS", which adds the GeoIP information, "lpm ADDRESS",
+  with the longest matching prefix of the address in the prefix table,
+  "contains NETWORK" or "overlaps NETWORK", with the network of the set
+  which contains or overlaps it, or just an address as "info" does.
+
+  \param path the path of the socket.
+  \param lpm_file the prefix table for "lpm", or NULL.
+  \param set_file the network set for "contains" and "overlaps", or NULL.
+  \param flags the flags specifying the information to print.
+  \param jobs the number of threads answering the requests.
+
+  \return 0 when stopped by a signal, or -1 on error.
+*/
+int serve(const char *path, const char *lpm_file, const char *set_file, unsigned flags, unsigned jobs)
+{
+	struct epoll_event events[MAX_EVENTS];
+	pthread_rwlockattr_t attr;
+	struct server srv;
+	pthread_t *threads = NULL;
+	unsigned i, started = 0;
+	sigset_t mask;
+	struct conn *c;
+	int n, ret = -1;
+
+	memset(&srv, 0, sizeof(srv));
+	srv.listen_fd = srv.signal_fd = srv.event_fd = srv.epoll_fd = -1;
+	srv.lpm_file = lpm_file;
+	srv.set_file = set_file;
+	srv.flags = flags;
+	srv.quiet = beSilent;
+	pthread_mutex_init(&srv.lock, NULL);
+	pthread_cond_init(&srv.cond, NULL);
+
+	/* a reload must not wait behind a steady stream of queries */
+	pthread_rwlockattr_init(&attr);
+	pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	pthread_rwlock_init(&srv.tables_lock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+
+	if (lpm_file && (srv.lpm = lpm_open(lpm_file, flags)) == NULL)
+		goto cleanup;
+	if (set_file && (srv.set = network_set_open(set_file, flags)) == NULL)
+		goto cleanup;
+	srv.geo = (geo_init() == 0);
+
+	/* the signals are only received through signal_fd, by all threads */
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGHUP);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+	srv.listen_fd = serve_listen(path);
+	if (srv.listen_fd < 0)
+		goto cleanup;
+
+	srv.signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	srv.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	srv.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (srv.signal_fd < 0 || srv.event_fd < 0 || srv.epoll_fd < 0 ||
+	    epoll_add(srv.epoll_fd, srv.listen_fd, &srv.listen_fd) < 0 ||
+	    epoll_add(srv.epoll_fd, srv.signal_fd, &srv.signal_fd) < 0 ||
+	    epoll_add(srv.epoll_fd, srv.event_fd, &srv.event_fd) < 0) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: cannot set up the server: %s\n", strerror(errno));
+		goto cleanup;
+	}
+
+	threads = calloc(jobs, sizeof(threads[0]));
+	if (threads == NULL) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: memory error\n");
+		goto cleanup;
+	}
+	beSilent = 1;
+	for (started = 0; started < jobs; started++) {
+		if (pthread_create(&threads[started], NULL, serve_worker, &srv) != 0) {
+			if (!srv.quiet)
+				fprintf(stderr, "ipcalc: could not create thread\n");
+			goto cleanup;
+		}
+	}
+
+	while (!srv.stop) {
+		n = epoll_wait(srv.epoll_fd, events, MAX_EVENTS, -1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (!srv.quiet)
+				fprintf(stderr, "ipcalc: epoll_wait: %s\n", strerror(errno));
+			goto cleanup;
+		}
+
+		for (i = 0; i < (unsigned)n; i++) {
+			void *p = events[i].data.ptr;
+
+			if (p == &srv.listen_fd)
+				serve_accept(&srv);
+			else if (p == &srv.signal_fd)
+				serve_signal(&srv);
+			else if (p == &srv.event_fd)
+				serve_done(&srv);
+			else
+				conn_event(&srv, p, events[i].events);
+		}
+
+		/* the closed connections may still have events in this round */
+		while ((c = srv.closed) != NULL) {
+			srv.closed = c->next;
+			conn_free(c);
+		}
+	}
+	ret = 0;
+
+ cleanup:
+	pthread_mutex_lock(&srv.lock);
+	srv.stop = 1;
+	pthread_cond_broadcast(&srv.cond);
+	pthread_mutex_unlock(&srv.lock);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	beSilent = srv.quiet;
+
+	while ((c = srv.open) != NULL) {
+		srv.open = c->next_open;
+		close(c->fd);
+		conn_free(c);
+	}
+	while ((c = srv.closed) != NULL) {
+		srv.closed = c->next;
+		conn_free(c);
+	}
+
+	if (srv.listen_fd >= 0) {
+		close(srv.listen_fd);
+		unlink(path);
+	}
+	if (srv.signal_fd >= 0)
+		close(srv.signal_fd);
+	if (srv.event_fd >= 0)
+		close(srv.event_fd);
+	if (srv.epoll_fd >= 0)
+		close(srv.epoll_fd);
+
+	lpm_close(srv.lpm);
+	network_set_close(srv.set);
+	pthread_rwlock_destroy(&srv.tables_lock);
+	pthread_cond_destroy(&srv.cond);
+	pthread_mutex_destroy(&srv.lock);
+
+	return ret;
+}
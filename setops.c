@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The subtraction, intersection and union of two lists of networks.
+ * Both lists are turned into sorted, disjoint and non adjacent address
+ * ranges as for --aggregate, and are then walked side by side once. The
+ * ranges of the result come out sorted and never adjacent, so that each
+ * one is printed as the minimal set of networks covering it.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "ipcalc.h"
+#include "ipv6.h"
+#include "range.h"
+
+static void subtract_ipv4(unsigned *jsonchain, const struct ipv4_range *a, size_t na,
+			  const struct ipv4_range *b, size_t nb)
+{
+	size_t i, j = 0;
+
+	for (i = 0; i < na; i++) {
+		uint32_t start = a[i].start;
+		unsigned covered = 0;
+
+		while (j < nb && b[j].end < start)
+			j++;
+
+		for (; j < nb && b[j].start <= a[i].end; j++) {
+			if (b[j].start > start)
+				deaggregate_ipv4_range(jsonchain, start, b[j].start - 1);
+			/* the range of b may cover the next ones of a too */
+			if (b[j].end >= a[i].end) {
+				covered = 1;
+				break;
+			}
+			start = b[j].end + 1;
+		}
+
+		if (!covered)
+			deaggregate_ipv4_range(jsonchain, start, a[i].end);
+	}
+}
+
+static void intersect_ipv4(unsigned *jsonchain, const struct ipv4_range *a, size_t na,
+			   const struct ipv4_range *b, size_t nb)
+{
+	size_t i = 0, j = 0;
+
+	while (i < na && j < nb) {
+		uint32_t start = a[i].start > b[j].start ? a[i].start : b[j].start;
+		uint32_t end = a[i].end < b[j].end ? a[i].end : b[j].end;
+
+		if (start <= end)
+			deaggregate_ipv4_range(jsonchain, start, end);
+
+		if (a[i].end < b[j].end)
+			i++;
+		else
+			j++;
+	}
+}
+
+static void union_ipv4(unsigned *jsonchain, const struct ipv4_range *a, size_t na,
+		       const struct ipv4_range *b, size_t nb)
+{
+	struct ipv4_range cur, next;
+	size_t i = 0, j = 0;
+
+	if (na + nb == 0)
+		return;
+
+	cur = (nb == 0 || (na > 0 && a[0].start <= b[0].start)) ? a[i++] : b[j++];
+	while (i < na || j < nb) {
+		next = (j == nb || (i < na && a[i].start <= b[j].start)) ? a[i++] : b[j++];
+
+		if (cur.end == UINT32_MAX || next.start <= cur.end + 1) {
+			if (next.end > cur.end)
+				cur.end = next.end;
+			continue;
+		}
+
+		deaggregate_ipv4_range(jsonchain, cur.start, cur.end);
+		cur = next;
+	}
+	deaggregate_ipv4_range(jsonchain, cur.start, cur.end);
+}
+
+static void subtract_ipv6(unsigned *jsonchain, const struct ipv6_range *a, size_t na,
+			  const struct ipv6_range *b, size_t nb)
+{
+	const struct ipv6_num one = ipv6_bit(0);
+	size_t i, j = 0;
+
+	for (i = 0; i < na; i++) {
+		struct ipv6_num start = a[i].start, last;
+		unsigned covered = 0;
+
+		while (j < nb && ipv6_cmp(b[j].end, start) < 0)
+			j++;
+
+		for (; j < nb && ipv6_cmp(b[j].start, a[i].end) <= 0; j++) {
+			if (ipv6_cmp(b[j].start, start) > 0) {
+				last = ipv6_sub(b[j].start, one);
+				deaggregate_ipv6_range(jsonchain, &start, &last);
+			}
+			if (ipv6_cmp(b[j].end, a[i].end) >= 0) {
+				covered = 1;
+				break;
+			}
+			start = ipv6_add(b[j].end, one);
+		}
+
+		if (!covered)
+			deaggregate_ipv6_range(jsonchain, &start, &a[i].end);
+	}
+}
+
+static void intersect_ipv6(unsigned *jsonchain, const struct ipv6_range *a, size_t na,
+			   const struct ipv6_range *b, size_t nb)
+{
+	size_t i = 0, j = 0;
+
+	while (i < na && j < nb) {
+		const struct ipv6_num *start, *end;
+
+		start = ipv6_cmp(a[i].start, b[j].start) > 0 ? &a[i].start : &b[j].start;
+		end = ipv6_cmp(a[i].end, b[j].end) < 0 ? &a[i].end : &b[j].end;
+
+		if (ipv6_cmp(*start, *end) <= 0)
+			deaggregate_ipv6_range(jsonchain, start, end);
+
+		if (ipv6_cmp(a[i].end, b[j].end) < 0)
+			i++;
+		else
+			j++;
+	}
+}
+
+static void union_ipv6(unsigned *jsonchain, const struct ipv6_range *a, size_t na,
+		       const struct ipv6_range *b, size_t nb)
+{
+	const struct ipv6_num all = ipv6_low_mask(128);
+	struct ipv6_range cur, next;
+	size_t i = 0, j = 0;
+
+	if (na + nb == 0)
+		return;
+
+	cur = (nb == 0 || (na > 0 && ipv6_cmp(a[0].start, b[0].start) <= 0)) ? a[i++] : b[j++];
+	while (i < na || j < nb) {
+		next = (j == nb || (i < na && ipv6_cmp(a[i].start, b[j].start) <= 0)) ? a[i++] : b[j++];
+
+		if (ipv6_cmp(cur.end, all) == 0 ||
+		    ipv6_cmp(next.start, ipv6_add(cur.end, ipv6_bit(0))) <= 0) {
+			if (ipv6_cmp(next.end, cur.end) > 0)
+				cur.end = next.end;
+			continue;
+		}
+
+		deaggregate_ipv6_range(jsonchain, &cur.start, &cur.end);
+		cur = next;
+	}
+	deaggregate_ipv6_range(jsonchain, &cur.start, &cur.end);
+}
+
+/*!
+  \fn int combine_networks(const char *set_file, FILE *fp, unsigned app, unsigned flags)
+  \brief prints the minimal set of networks of a combination of two lists of networks
+
+  The set file and the input contain a network in the ADDRESS[/PREFIX]
+  form per line; IPv4 and IPv6 networks may be mixed, and the IPv4
+  networks are printed first. Empty lines and lines starting with '#'
+  are ignored. Invalid lines of the input are reported on standard
+  error and skipped.
+
+  \param set_file the file with the first list of networks.
+  \param fp the input stream, with the second list.
+  \param app APP_SUBTRACT for the addresses of the first list which are
+  not in the second one, APP_INTERSECT for those in both lists, or
+  APP_UNION for those in either list.
+  \param flags the output flags.
+
+  \return 0 if all lines were processed, or 1 if any errors were found.
+*/
+int combine_networks(const char *set_file, FILE *fp, unsigned app, unsigned flags)
+{
+	struct range_list a4 = {NULL, 0, 0}, a6 = {NULL, 0, 0};
+	struct range_list b4 = {NULL, 0, 0}, b6 = {NULL, 0, 0};
+	size_t na4, na6, nb4, nb6;
+	unsigned jsonchain;
+	FILE *set_fp;
+	int ret;
+
+	set_fp = fopen(set_file, "r");
+	if (set_fp == NULL) {
+		if (!beSilent)
+			fprintf(stderr, "ipcalc: cannot open %s\n", set_file);
+		return 1;
+	}
+
+	ret = range_read(set_fp, flags, &a4, &a6);
+	fclose(set_fp);
+	if (ret != 0) {
+		range_free(&a4);
+		range_free(&a6);
+		return 1;
+	}
+
+	ret = range_read(fp, flags, &b4, &b6);
+
+	na4 = range_merge_ipv4(a4.data, a4.count);
+	na6 = range_merge_ipv6(a6.data, a6.count);
+	nb4 = range_merge_ipv4(b4.data, b4.count);
+	nb6 = range_merge_ipv6(b6.data, b6.count);
+
+	output_start(&jsonchain);
+
+	if (app == APP_SUBTRACT) {
+		array_start(&jsonchain, "Remaining networks", "REMAININGNETWORK");
+		subtract_ipv4(&jsonchain, a4.data, na4, b4.data, nb4);
+		subtract_ipv6(&jsonchain, a6.data, na6, b6.data, nb6);
+	} else if (app == APP_INTERSECT) {
+		array_start(&jsonchain, "Common networks", "COMMONNETWORK");
+		intersect_ipv4(&jsonchain, a4.data, na4, b4.data, nb4);
+		intersect_ipv6(&jsonchain, a6.data, na6, b6.data, nb6);
+	} else {
+		array_start(&jsonchain, "Combined networks", "COMBINEDNETWORK");
+		union_ipv4(&jsonchain, a4.data, na4, b4.data, nb4);
+		union_ipv6(&jsonchain, a6.data, na6, b6.data, nb6);
+	}
+
+	array_stop(&jsonchain);
+	output_stop(&jsonchain);
+
+	range_free(&a4);
+	range_free(&a6);
+	range_free(&b4);
+	range_free(&b6);
+
+	return ret;
+}
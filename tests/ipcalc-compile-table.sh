@@ -0,0 +1,47 @@
+#!/bin/sh
+
+# Copyright (c) 2026 ipcalc contributors
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation; either version 2 of the License, or (at
+# your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+# Checks that a compiled prefix table gives the same matches as the
+# text one, and that a damaged one is rejected.
+
+IPCALC="${IPCALC:-build/ipcalc}"
+SRCDIR="${SRCDIR:-tests}"
+
+TMPFILE=$(mktemp)
+trap 'rm -f "${TMPFILE}"' EXIT
+
+set -e
+
+${IPCALC} --compile-table "${SRCDIR}/lpm-table" "${TMPFILE}"
+TEXT=$(${IPCALC} -s --lpm-table "${SRCDIR}/lpm-table" "${SRCDIR}/lpm-addresses" || true)
+COMPILED=$(${IPCALC} -s --lpm-table "${TMPFILE}" "${SRCDIR}/lpm-addresses" || true)
+
+set +e
+
+if test -z "${TEXT}" || test "${TEXT}" != "${COMPILED}";then
+	echo "The compiled table gives different matches"
+	exit 1
+fi
+
+head -c 100 "${TMPFILE}" > "${TMPFILE}.short"
+mv "${TMPFILE}.short" "${TMPFILE}"
+if echo 10.1.2.3 | ${IPCALC} -s --lpm-table "${TMPFILE}" >/dev/null;then
+	echo "A truncated compiled table was accepted"
+	exit 1
+fi
+
+exit 0
@@ -0,0 +1,107 @@
+#!/bin/sh
+
+# Copyright (c) 2026 ipcalc contributors
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation; either version 2 of the License, or (at
+# your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+# Checks the replies of --serve, that the errors of the requests are
+# not printed by the server, that SIGHUP loads the prefix table again,
+# that SIGTERM removes the socket and that a too long path is rejected. Python is used as the client, and the test is skipped
+# without it.
+
+IPCALC="${IPCALC:-build/ipcalc}"
+SRCDIR="${SRCDIR:-tests}"
+
+PYTHON=$(command -v python3) || exit 77
+
+TMPDIR=$(mktemp -d)
+SOCKET="${TMPDIR}/ipcalc.sock"
+PID=
+trap 'test -n "${PID}" && kill "${PID}" 2>/dev/null; rm -rf "${TMPDIR}"' EXIT
+
+# Sends every argument as a request and prints the replies
+query() {
+	"${PYTHON}" -c '
+import socket, sys
+s = socket.socket(socket.AF_UNIX)
+s.connect(sys.argv[1])
+f = s.makefile("rwb")
+for line in sys.argv[2:]:
+	f.write(line.encode() + b"\n")
+	f.flush()
+	sys.stdout.write(f.readline().decode())
+' "${SOCKET}" "$@"
+}
+
+if ${IPCALC} -s --serve "${TMPDIR}/$(printf '%0120d' 0)";then
+	echo "A socket path longer than the address allows was accepted"
+	exit 1
+fi
+
+cp "${SRCDIR}/lpm-table" "${TMPDIR}/lpm-table"
+${IPCALC} --serve "${SOCKET}" --lpm-table "${TMPDIR}/lpm-table" \
+	--contains "${SRCDIR}/network-set" --jobs 2 2>"${TMPDIR}/stderr" &
+PID=$!
+
+i=0
+while ! test -S "${SOCKET}";do
+	i=$((i+1))
+	if test $i -gt 50;then
+		echo "The server did not start"
+		exit 1
+	fi
+	sleep 0.1
+done
+
+EXPECTED='{"NETWORK":"192.168.1.0","NETMASK":"255.255.255.0","PREFIX":"24","BROADCAST":"192.168.1.255","ADDRSPACE":"Private Use","MINADDR":"192.168.1.1","MAXADDR":"192.168.1.254","ADDRESSES":"254"}
+{"ADDRESS":"10.1.2.3","PREFIX":"10.1.2.0/24"}
+{"NETWORK":"10.0.0.0/24","MATCH":"10.0.0.0/8"}
+{"INPUT":"not-an-address","ERROR":"invalid address"}'
+REPLIES=$(query "info 192.168.1.0/24" "lpm 10.1.2.3" "contains 10.0.0.0/24" "lpm not-an-address")
+if test "${REPLIES}" != "${EXPECTED}";then
+	echo "Unexpected replies:"
+	echo "${REPLIES}"
+	exit 1
+fi
+
+echo "10.1.2.0/28 reloaded" >> "${TMPDIR}/lpm-table"
+kill -HUP "${PID}"
+
+EXPECTED='{"ADDRESS":"10.1.2.3","PREFIX":"10.1.2.0/28","LABEL":"reloaded"}'
+i=0
+while test "$(query "lpm 10.1.2.3")" != "${EXPECTED}";do
+	i=$((i+1))
+	if test $i -gt 50;then
+		echo "The prefix table was not reloaded"
+		exit 1
+	fi
+	sleep 0.1
+done
+
+kill -TERM "${PID}"
+wait "${PID}"
+RET=$?
+PID=
+if test ${RET} != 0 || test -e "${SOCKET}";then
+	echo "The server did not stop cleanly"
+	exit 1
+fi
+
+if test -s "${TMPDIR}/stderr";then
+	echo "The server printed errors:"
+	cat "${TMPDIR}/stderr"
+	exit 1
+fi
+
+exit 0
@@ -0,0 +1,77 @@
+#!/bin/sh
+
+# Copyright (c) 2026 ipcalc contributors
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation; either version 2 of the License, or (at
+# your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+# Checks the counters of --stats, and that the statistics do not change
+# the rest of the output.
+
+IPCALC="${IPCALC:-build/ipcalc}"
+
+TMPFILE=$(mktemp)
+trap 'rm -f "${TMPFILE}"' EXIT
+
+INPUT="10.0.0.1/24
+bad
+192.168.1.1/33
+2001:db8::1/64"
+
+PLAIN=$(echo "${INPUT}" | ${IPCALC} -s --batch -n)
+WITH_STATS=$(echo "${INPUT}" | ${IPCALC} -s --batch -n --stats 2>"${TMPFILE}")
+
+if test "${PLAIN}" != "${WITH_STATS}";then
+	echo "--stats changes the output"
+	exit 1
+fi
+
+if ! grep -q "^Records:	4$" "${TMPFILE}" || ! grep -q "^Parse failures:	2$" "${TMPFILE}";then
+	echo "Wrong counters of --batch:"
+	cat "${TMPFILE}"
+	exit 1
+fi
+
+for phase in Parse Compute DNS GeoIP Output Write;do
+	if ! grep -q "^${phase} time:	[0-9.]* s$" "${TMPFILE}";then
+		echo "No ${phase} time:"
+		cat "${TMPFILE}"
+		exit 1
+	fi
+done
+
+if ! grep -q "^Peak RSS:	[1-9][0-9]* kB$" "${TMPFILE}";then
+	echo "No peak RSS:"
+	cat "${TMPFILE}"
+	exit 1
+fi
+
+${IPCALC} -s -S 26 10.0.0.0/24 --stats 2>"${TMPFILE}" >/dev/null
+if ! grep -q "^Networks:	4$" "${TMPFILE}";then
+	echo "Wrong counters of --split:"
+	cat "${TMPFILE}"
+	exit 1
+fi
+
+# in JSON output the statistics are the last object
+LAST=$(${IPCALC} -s --ndjson -d 10.0.0.1-10.0.0.9 --stats | tail -n 1)
+case "${LAST}" in
+	'{"RECORDS":"0","PARSEFAILURES":"0","NETWORKS":"4",'*'"PEAKRSS":"'*'"}')
+		;;
+	*)
+		echo "Wrong JSON statistics: ${LAST}"
+		exit 1
+		;;
+esac
+
+exit 0
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2026 ipcalc contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Checks the iterations, their callbacks and the error codes of
+ * libipcalc through its public header only, linked with the shared
+ * library.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "libipcalc.h"
+
+#define MAX_NETS 64
+
+static unsigned failures;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+static ipcalc_net_st parse(const char *str)
+{
+	ipcalc_net_st net;
+
+	if (ipcalc_parse_net(str, NULL, &net) != IPCALC_OK) {
+		fprintf(stderr, "cannot parse %s\n", str);
+		failures++;
+	}
+	return net;
+}
+
+static unsigned same_nets(const ipcalc_net_st *a, const ipcalc_net_st *b, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (a[i].family != b[i].family || a[i].prefix != b[i].prefix ||
+		    memcmp(&a[i].addr, &b[i].addr, a[i].family == AF_INET6 ?
+			   sizeof(struct in6_addr) : sizeof(struct in_addr)) != 0)
+			return 0;
+	}
+	return 1;
+}
+
+static size_t split_by_next(const char *str, unsigned prefix, ipcalc_net_st *nets)
+{
+	ipcalc_net_st net = parse(str);
+	ipcalc_split_st it;
+	size_t n = 0;
+
+	CHECK(ipcalc_split_init(&it, &net, prefix) == IPCALC_OK);
+	while (n < MAX_NETS && ipcalc_split_next(&it, &nets[n]))
+		n++;
+	CHECK(ipcalc_split_next(&it, &net) == 0);
+	return n;
+}
+
+/* Fills the networks a few at a time, so that the fills resume where
+ * the previous ones stopped */
+static size_t split_by_fill(const char *str, unsigned prefix, ipcalc_net_st *nets)
+{
+	ipcalc_net_st net = parse(str);
+	ipcalc_split_st it;
+	size_t n = 0, r;
+
+	CHECK(ipcalc_split_init(&it, &net, prefix) == IPCALC_OK);
+	do {
+		r = ipcalc_split_fill(&it, &nets[n], 3);
+		n += r;
+	} while (r == 3 && n + 3 <= MAX_NETS);
+	CHECK(ipcalc_split_fill(&it, &net, 1) == 0);
+	return n;
+}
+
+/* The networks passed to the callback of a foreach, which stops the
+ * iteration after stop_at of them when it is non-zero */
+struct collect {
+	ipcalc_net_st nets[MAX_NETS];
+	size_t n;
+	size_t stop_at;
+};
+
+#define STOP_VALUE 7
+
+static int collect_cb(const ipcalc_net_st *net, void *arg)
+{
+	struct collect *c = arg;
+
+	if (c->n == MAX_NETS)
+		return -1;
+	c->nets[c->n++] = *net;
+	return c->n == c->stop_at ? STOP_VALUE : 0;
+}
+
+/* Checks that foreach gives the networks of next, and that a stop by
+ * the callback returns its value and leaves the iteration at the
+ * following network */
+static void check_split_foreach(const char *str, unsigned prefix, const ipcalc_net_st *nets, size_t count)
+{
+	ipcalc_net_st net = parse(str), after;
+	ipcalc_split_st it;
+	struct collect c;
+
+	memset(&c, 0, sizeof(c));
+	CHECK(ipcalc_split_init(&it, &net, prefix) == IPCALC_OK);
+	CHECK(ipcalc_split_foreach(&it, collect_cb, &c) == 0);
+	CHECK(c.n == count);
+	CHECK(same_nets(c.nets, nets, count));
+	CHECK(ipcalc_split_next(&it, &after) == 0);
+
+	if (count < 3)
+		return;
+
+	memset(&c, 0, sizeof(c));
+	c.stop_at = 2;
+	CHECK(ipcalc_split_init(&it, &net, prefix) == IPCALC_OK);
+	CHECK(ipcalc_split_foreach(&it, collect_cb, &c) == STOP_VALUE);
+	CHECK(c.n == 2);
+	CHECK(ipcalc_split_next(&it, &after) == 1);
+	CHECK(same_nets(&after, &nets[2], 1));
+}
+
+static void check_split(const char *str, unsigned prefix, size_t count, const char *last)
+{
+	ipcalc_net_st a[MAX_NETS], b[MAX_NETS];
+	char buf[IPCALC_NET_SIZE];
+	size_t na, nb;
+
+	na = split_by_next(str, prefix, a);
+	nb = split_by_fill(str, prefix, b);
+	CHECK(na == count);
+	CHECK(nb == count);
+	CHECK(same_nets(a, b, na));
+	check_split_foreach(str, prefix, a, na);
+
+	CHECK(ipcalc_format_net(&a[na - 1], buf, sizeof(buf)) > 0);
+	CHECK(strcmp(buf, last) == 0);
+}
+
+static size_t deagg_init(ipcalc_deagg_st *it, int family, const char *first, const char *last)
+{
+	ipcalc_addr_un a, b;
+
+	CHECK(inet_pton(family, first, &a) > 0);
+	CHECK(inet_pton(family, last, &b) > 0);
+	CHECK(ipcalc_deagg_init(it, family, &a, &b) == IPCALC_OK);
+	return ipcalc_deagg_count(it);
+}
+
+static void check_deagg(int family, const char *first, const char *last, const char *expected)
+{
+	ipcalc_net_st a[MAX_NETS], b[MAX_NETS], net;
+	char buf[IPCALC_NET_SIZE], list[1024] = "";
+	ipcalc_deagg_st it;
+	struct collect c;
+	size_t count, na = 0, nb = 0, r, i;
+
+	count = deagg_init(&it, family, first, last);
+	while (na < MAX_NETS && ipcalc_deagg_next(&it, &a[na]))
+		na++;
+	CHECK(ipcalc_deagg_next(&it, &net) == 0);
+	CHECK(ipcalc_deagg_count(&it) == 0);
+
+	deagg_init(&it, family, first, last);
+	do {
+		r = ipcalc_deagg_fill(&it, &b[nb], 2);
+		nb += r;
+	} while (r == 2 && nb + 2 <= MAX_NETS);
+
+	CHECK(na == count);
+	CHECK(nb == count);
+	CHECK(same_nets(a, b, na));
+
+	memset(&c, 0, sizeof(c));
+	deagg_init(&it, family, first, last);
+	CHECK(ipcalc_deagg_foreach(&it, collect_cb, &c) == 0);
+	CHECK(c.n == count);
+	CHECK(same_nets(c.nets, a, na));
+
+	if (count >= 3) {
+		memset(&c, 0, sizeof(c));
+		c.stop_at = 2;
+		deagg_init(&it, family, first, last);
+		CHECK(ipcalc_deagg_foreach(&it, collect_cb, &c) == STOP_VALUE);
+		CHECK(c.n == 2);
+		CHECK(ipcalc_deagg_count(&it) == (int)count - 2);
+		CHECK(ipcalc_deagg_next(&it, &net) == 1);
+		CHECK(same_nets(&net, &a[2], 1));
+	}
+
+	for (i = 0; i < na; i++) {
+		CHECK(ipcalc_format_net(&a[i], buf, sizeof(buf)) > 0);
+		if (i > 0)
+			strcat(list, " ");
+		strcat(list, buf);
+	}
+	if (strcmp(list, expected) != 0) {
+		fprintf(stderr, "deaggregation of %s-%s: %s\n", first, last, list);
+		failures++;
+	}
+}
+
+static void check_errors(void)
+{
+	ipcalc_net_st net;
+	ipcalc_split_st split;
+	ipcalc_deagg_st deagg;
+	struct in_addr a, b;
+	char buf[8];
+	const char *s;
+	int codes[] = {IPCALC_OK, IPCALC_E_INVALID_ADDRESS, IPCALC_E_INVALID_PREFIX,
+		IPCALC_E_INVALID_RANGE, IPCALC_E_BUFFER_TOO_SMALL, IPCALC_E_INVALID_ARGUMENT};
+	unsigned i, j;
+
+	CHECK(ipcalc_parse_net("10.0.0.256", NULL, &net) == IPCALC_E_INVALID_ADDRESS);
+	CHECK(ipcalc_parse_net("2001:db8::g", NULL, &net) == IPCALC_E_INVALID_ADDRESS);
+	CHECK(ipcalc_parse_net("10.0.0.0/33", NULL, &net) == IPCALC_E_INVALID_PREFIX);
+	CHECK(ipcalc_parse_net("2001:db8::/129", NULL, &net) == IPCALC_E_INVALID_PREFIX);
+	CHECK(ipcalc_parse_prefix("24", AF_UNSPEC) == IPCALC_E_INVALID_ARGUMENT);
+
+	net = parse("10.0.0.0/24");
+	CHECK(ipcalc_split_init(&split, &net, 16) == IPCALC_E_INVALID_PREFIX);
+	CHECK(ipcalc_split_init(&split, &net, 33) == IPCALC_E_INVALID_PREFIX);
+	CHECK(ipcalc_split_init(&split, &net, 26) == IPCALC_OK);
+	CHECK(ipcalc_split_slice(&split, 4, 0) == IPCALC_E_INVALID_RANGE);
+	CHECK(ipcalc_split_shard(&split, 0, 2) == IPCALC_E_INVALID_ARGUMENT);
+	CHECK(ipcalc_split_shard(&split, 3, 2) == IPCALC_E_INVALID_ARGUMENT);
+	net.family = AF_UNSPEC;
+	CHECK(ipcalc_split_init(&split, &net, 26) == IPCALC_E_INVALID_ARGUMENT);
+
+	inet_pton(AF_INET, "10.0.0.2", &a);
+	inet_pton(AF_INET, "10.0.0.1", &b);
+	CHECK(ipcalc_deagg_init(&deagg, AF_INET, &a, &b) == IPCALC_E_INVALID_RANGE);
+	CHECK(ipcalc_deagg_init(&deagg, AF_UNSPEC, &b, &a) == IPCALC_E_INVALID_ARGUMENT);
+
+	net = parse("192.168.100.0/24");
+	CHECK(ipcalc_format_net(&net, buf, sizeof(buf)) == IPCALC_E_BUFFER_TOO_SMALL);
+	CHECK(ipcalc_hosts(AF_INET6, 0, buf, sizeof(buf)) == IPCALC_E_BUFFER_TOO_SMALL);
+
+	for (i = 0; i < sizeof(codes) / sizeof(codes[0]); i++) {
+		s = ipcalc_strerror(codes[i]);
+		CHECK(strcmp(s, "unknown error") != 0);
+		for (j = 0; j < i; j++)
+			CHECK(strcmp(s, ipcalc_strerror(codes[j])) != 0);
+	}
+	CHECK(strcmp(ipcalc_strerror(42), "unknown error") == 0);
+}
+
+int main(void)
+{
+	check_split("10.0.0.0/24", 26, 4, "10.0.0.192/26");
+	check_split("10.0.0.0/24", 24, 1, "10.0.0.0/24");
+	check_split("10.0.0.0/26", 31, 32, "10.0.0.62/31");
+	check_split("2001:db8::/60", 64, 16, "2001:db8:0:f::/64");
+	check_split("::/0", 4, 16, "f000::/4");
+
+	check_deagg(AF_INET, "10.0.0.1", "10.0.0.10",
+		    "10.0.0.1/32 10.0.0.2/31 10.0.0.4/30 10.0.0.8/31 10.0.0.10/32");
+	check_deagg(AF_INET, "0.0.0.0", "255.255.255.255", "0.0.0.0/0");
+	check_deagg(AF_INET6, "2001:db8::1", "2001:db8::6",
+		    "2001:db8::1/128 2001:db8::2/127 2001:db8::4/127 2001:db8::6/128");
+
+	check_errors();
+
+	if (failures) {
+		fprintf(stderr, "%u checks failed\n", failures);
+		return 1;
+	}
+	return 0;
+}